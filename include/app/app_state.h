@@ -1,5 +1,5 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
 
 struct AppReadings {
   float tC = NAN;
@@ -13,4 +13,6 @@ struct AppReadings {
   bool mq7Calibrated = false;
   bool mq7WarmupDone = false;
   uint8_t mq7Level = 0; // 0=UNKNOWN, 1=OK, 2=WARN, 3=DANGER
+  uint64_t atUs = 0; // acquisizione più recente fra i sensori (hal::monoUs(), 0 = nessuna)
+  uint64_t alarmUs = 0; // valutazione d'allarme che l'ha pubblicata (hal::monoUs(), 0 = nessuna)
 };
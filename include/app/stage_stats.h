@@ -0,0 +1,111 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Limiti superiori dei bucket dell'istogramma (microsecondi); l'ultimo
+// bucket raccoglie tutto quello che supera STAGE_HIST_EDGES_US[...-1].
+static constexpr uint32_t STAGE_HIST_EDGES_US[] = {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000};
+static constexpr uint8_t STAGE_HIST_BUCKETS = sizeof(STAGE_HIST_EDGES_US) / sizeof(STAGE_HIST_EDGES_US[0]) + 1;
+
+// Acquisizione -> ack del server (DeliveryStats), millisecondi: una lettura
+// aspetta in coda fino a SEND_MAX_LATENCY_MS e oltre, se la rete è giù.
+static constexpr uint32_t DELIVERY_HIST_EDGES_MS[] = {100, 250, 500, 1000, 2500, 5000, 10000, 15000, 30000, 60000, 300000};
+static constexpr uint8_t DELIVERY_HIST_BUCKETS = sizeof(DELIVERY_HIST_EDGES_MS) / sizeof(DELIVERY_HIST_EDGES_MS[0]) + 1;
+
+namespace histutil {
+
+// Bucket di v: primo limite >= v, N = oltre l'ultimo.
+template <size_t N>
+uint8_t bucketOf(const uint32_t (&edges)[N], uint32_t v) {
+  uint8_t i = 0;
+  while (i < N && v > edges[i]) i++;
+  return i;
+}
+
+// Percentile stimato dall'istogramma (N + 1 bucket): limite superiore del
+// bucket che lo contiene, limitato a maxSeen. pct in 1..100.
+template <size_t N>
+uint32_t percentile(const uint32_t (&edges)[N], const std::atomic<uint32_t>* hist, uint32_t n, uint32_t maxSeen,
+                    uint8_t pct) {
+  if (n == 0) return 0;
+  const uint64_t rank = ((uint64_t)n * pct + 99) / 100;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < N; i++) {
+    seen += hist[i].load(std::memory_order_relaxed);
+    if (seen >= rank) return edges[i] < maxSeen ? edges[i] : maxSeen;
+  }
+  return maxSeen;
+}
+
+// Incremento di un contatore con un solo scrittore (niente RMW atomico).
+inline void bump(std::atomic<uint32_t>& c) { c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+} // namespace histutil
+
+// Contatori di latenza per uno stadio della pipeline (microsecondi).
+// Scritti da un solo task, letti da chiunque: una record() costa qualche
+// load/store relaxed e una ricerca lineare su 11 limiti.
+struct StageStats {
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> lastUs{0};
+  std::atomic<uint32_t> maxUs{0};
+  std::atomic<uint64_t> totalUs{0};
+  std::atomic<uint32_t> overruns{0}; // esecuzioni oltre budgetUs
+  std::atomic<uint32_t> hist[STAGE_HIST_BUCKETS] = {};
+  uint32_t budgetUs = 0;             // 0 = nessun budget
+
+  void record(uint32_t us) {
+    histutil::bump(count);
+    lastUs.store(us, std::memory_order_relaxed);
+    if (us > maxUs.load(std::memory_order_relaxed)) maxUs.store(us, std::memory_order_relaxed);
+    totalUs.store(totalUs.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    if (budgetUs && us > budgetUs) histutil::bump(overruns);
+    histutil::bump(hist[bucketOf(us)]);
+  }
+
+  uint32_t avgUs() const {
+    const uint32_t n = count.load(std::memory_order_relaxed);
+    return n ? (uint32_t)(totalUs.load(std::memory_order_relaxed) / n) : 0;
+  }
+
+  // Percentile stimato dall'istogramma: limite superiore del bucket che lo
+  // contiene, limitato a maxUs. pct in 1..100.
+  uint32_t percentileUs(uint8_t pct) const {
+    return histutil::percentile(STAGE_HIST_EDGES_US, hist, count.load(std::memory_order_relaxed),
+                                maxUs.load(std::memory_order_relaxed), pct);
+  }
+
+  static uint8_t bucketOf(uint32_t us) { return histutil::bucketOf(STAGE_HIST_EDGES_US, us); }
+};
+
+// Come StageStats, in millisecondi e coi limiti DELIVERY_HIST_EDGES_MS: per
+// le latenze che attraversano coda e rete.
+struct DeliveryStats {
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> lastMs{0};
+  std::atomic<uint32_t> maxMs{0};
+  std::atomic<uint64_t> totalMs{0};
+  std::atomic<uint32_t> overruns{0}; // letture oltre budgetMs
+  std::atomic<uint32_t> hist[DELIVERY_HIST_BUCKETS] = {};
+  uint32_t budgetMs = 0;             // 0 = nessun budget
+
+  void record(uint32_t ms) {
+    histutil::bump(count);
+    lastMs.store(ms, std::memory_order_relaxed);
+    if (ms > maxMs.load(std::memory_order_relaxed)) maxMs.store(ms, std::memory_order_relaxed);
+    totalMs.store(totalMs.load(std::memory_order_relaxed) + ms, std::memory_order_relaxed);
+    if (budgetMs && ms > budgetMs) histutil::bump(overruns);
+    histutil::bump(hist[histutil::bucketOf(DELIVERY_HIST_EDGES_MS, ms)]);
+  }
+
+  uint32_t avgMs() const {
+    const uint32_t n = count.load(std::memory_order_relaxed);
+    return n ? (uint32_t)(totalMs.load(std::memory_order_relaxed) / n) : 0;
+  }
+
+  uint32_t percentileMs(uint8_t pct) const {
+    return histutil::percentile(DELIVERY_HIST_EDGES_MS, hist, count.load(std::memory_order_relaxed),
+                                maxMs.load(std::memory_order_relaxed), pct);
+  }
+};
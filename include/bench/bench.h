@@ -0,0 +1,44 @@
+#pragma once
+#include "hal/hal.h"
+
+#ifndef FW_VERSION
+#define FW_VERSION "dev"
+#endif
+#ifndef BENCH_MIN_BATCH_US
+#define BENCH_MIN_BATCH_US 100000 // durata minima del batch misurato
+#endif
+
+class OledDisplay;
+
+// Microbenchmark dei percorsi caldi del firmware (conversione MQ-7, JSON e
+// binario di telemetria, riga CSV, log, OLED).
+// Output JSON Lines: una riga "meta" e poi una per caso, ad esempio
+//   {"bench":"csv_row","iters":4096,"ns":812.4,"cycles":195,"allocs":0,"alloc_bytes":0,"out_bytes":72}
+// cycles: contatore ciclo CPU (ESP32) o TSC (host x86), null se non disponibile.
+// allocs/alloc_bytes per operazione, null senza BENCH_ALLOC_HOOKS (vedi alloc_hooks.cpp).
+// Confronto tra release: tools/bench/compare.js.
+namespace bench {
+
+// Tutti i casi; oled nullptr = salta i casi OLED (display non inizializzato o in uso).
+void runAll(Print& out, OledDisplay* oled = nullptr);
+
+// Misura op() finché un batch dura almeno BENCH_MIN_BATCH_US e stampa la riga JSON.
+// op restituisce i byte prodotti (campo out_bytes, 0 = non applicabile).
+using OpFn = size_t (*)(void* ctx);
+void measure(Print& out, const char* name, OpFn fn, void* ctx);
+
+template <typename F>
+void run(Print& out, const char* name, F& op) {
+  measure(out, name, [](void* ctx) -> size_t { return (*static_cast<F*>(ctx))(); }, &op);
+}
+
+// Contatori allocazioni (validi solo con BENCH_ALLOC_HOOKS).
+struct AllocCount {
+  uint32_t allocs;
+  uint32_t bytes;
+};
+bool allocHooksEnabled();
+void allocCountStart();
+AllocCount allocCountStop();
+
+} // namespace bench
@@ -0,0 +1,72 @@
+#pragma once
+// HAL sottile tra firmware e piattaforma: tempo, GPIO/tono, NVS.
+// Implementazioni: src/hal/hal_esp32.cpp (Arduino) e src/hal/hal_native.cpp
+// (host, tempo virtuale, vedi hal/hal_native.h). File: hal/hal_fs.h.
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include "hal/native_compat.h"
+#endif
+
+namespace hal {
+
+// Orologio di riferimento: µs dal boot a 64 bit, monotono, non si riavvolge.
+// millis()/micros() ne sono le viste a 32 bit (wrap a 49,7 giorni / 71 minuti):
+// vanno bene per intervalli e scadenze vicine con confronto (int32_t)(a - b).
+uint64_t monoUs();
+uint32_t millis();
+uint32_t micros();
+void delayMs(uint32_t ms);
+// Cede la CPU anche ai task di priorità più bassa sullo stesso core (un tick
+// di vTaskDelay: taskYIELD() non basterebbe). Thread yield su host.
+void yieldLower();
+
+void gpioOutput(uint8_t pin);
+void gpioWrite(uint8_t pin, bool high);
+
+// Tono PWM: toneBegin() collega il pin al canale, toneWrite(ch, 0) spegne.
+void toneBegin(uint8_t pin, uint8_t channel, uint32_t freqHz);
+void toneWrite(uint8_t channel, uint32_t freqHz);
+
+// Timer one-shot: fn gira fuori dal task che lo arma (task esp_timer su
+// ESP32, dentro advanceMs()/delayMs() sul tempo virtuale dell'host).
+// timerStartOnce() riarma anche un timer già attivo; us = 0 scatta subito.
+// Stop e riarmo sono un'unica operazione anche tra task diversi: vince
+// l'ultima chiamata. false se il timer non si è armato.
+using TimerFn = void (*)(void* arg);
+using TimerHandle = void*;
+TimerHandle timerCreate(TimerFn fn, void* arg, const char* name);
+bool timerStartOnce(TimerHandle t, uint32_t us);
+void timerStop(TimerHandle t);
+
+// Vincolo contro il light sleep automatico, per le periferiche che devono
+// restare clockate (PWM del buzzer, cattura RMT). awakeHold() non conta:
+// due hold di fila equivalgono a uno. No-op su host e senza CONFIG_PM_ENABLE.
+using AwakeHandle = void*;
+AwakeHandle awakeCreate(const char* name);
+void awakeHold(AwakeHandle h, bool hold);
+
+// Heap (byte): libero, blocco contiguo più grande, minimo dal boot. Zero su host.
+struct HeapInfo {
+  uint32_t freeBytes;
+  uint32_t largestBlock;
+  uint32_t minFreeBytes;
+};
+HeapInfo heapInfo();
+
+// Buffer grandi e di lunga vita: PSRAM se la scheda ce l'ha (hasPsram()),
+// altrimenti heap interno. nullptr se non c'è memoria.
+bool hasPsram();
+void* allocLarge(size_t bytes);
+
+// NVS (namespace "envmon")
+bool nvsBegin();
+bool nvsHas(const char* key);
+float nvsGetFloat(const char* key, float fallback);
+void nvsPutFloat(const char* key, float value);
+// Blob: byte letti (0 se la chiave manca o ha un'altra lunghezza).
+size_t nvsGetBytes(const char* key, void* out, size_t len);
+void nvsPutBytes(const char* key, const void* data, size_t len);
+void nvsRemove(const char* key);
+
+} // namespace hal
@@ -0,0 +1,42 @@
+#pragma once
+#include "hal/hal.h"
+#include <stdio.h>
+
+// File su SD tramite stdio: su ESP32 la SD è montata in VFS sotto "/sd",
+// su host i percorsi finiscono sotto una directory radice (hal/hal_native.h).
+namespace hal {
+
+// Monta la SD (ESP32: pin PIN_SD_*, clock con fallback) / prepara la radice (host).
+bool fsBegin();
+bool fsExists(const char* path);
+bool fsMkdir(const char* path);
+bool fsRemove(const char* path);
+// to non deve esistere (FAT non sovrascrive).
+bool fsRename(const char* from, const char* to);
+// Prefisso dei percorsi ("/sd" su ESP32, directory radice su host).
+const char* fsRoot();
+
+class File {
+public:
+  File() = default;
+  ~File() { close(); }
+  File(const File&) = delete;
+  File& operator=(const File&) = delete;
+
+  // mode come fopen(): "r", "w", "a", "r+". Niente buffer stdio: decide il chiamante.
+  bool open(const char* path, const char* mode);
+  void close();
+  explicit operator bool() const { return f_ != nullptr; }
+
+  size_t write(const void* data, size_t n);
+  size_t read(void* data, size_t n);
+  bool seek(size_t pos);
+  size_t size();
+  // fflush + fsync: i dati sono sulla scheda quando ritorna.
+  void flush();
+
+private:
+  FILE* f_ = nullptr;
+};
+
+} // namespace hal
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+// Controllo della HAL host (tempo virtuale, stato GPIO/tono, radice file).
+// Solo build native.
+namespace hal {
+namespace native {
+
+void setMillis(uint64_t ms);
+void advanceMs(uint32_t ms); // fa scattare i timer hal::timerStartOnce() scaduti
+uint64_t nowMs64();
+
+bool gpioLevel(uint8_t pin);
+uint32_t toneFreq(uint8_t channel);
+
+void setFsRoot(const char* dir);
+void nvsClear();
+
+} // namespace native
+} // namespace hal
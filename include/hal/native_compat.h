@@ -0,0 +1,68 @@
+#pragma once
+// Sostituti minimi dei tipi Arduino usati dai moduli portabili (solo build host).
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#include <stdlib.h>
+
+// Come l'Arduino Print: tutto passa da write(), printf() formatta in un buffer
+// da 64 byte sullo stack e va in heap solo per righe più lunghe.
+class Print {
+public:
+  virtual ~Print() = default;
+  virtual size_t write(const uint8_t* data, size_t n) = 0;
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const char* s, size_t n) { return write(reinterpret_cast<const uint8_t*>(s), n); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char small[64];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(small)) return write(small, n);
+
+    char* big = static_cast<char*>(malloc(n + 1));
+    if (!big) return 0;
+    va_start(ap, fmt);
+    vsnprintf(big, n + 1, fmt, ap);
+    va_end(ap);
+    size_t w = write(big, n);
+    free(big);
+    return w;
+  }
+  size_t print(const char* s) { return write(s, strlen(s)); }
+  size_t print(char c) { return write(&c, 1); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned v) { return printf("%u", v); }
+  size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+  size_t println() { return print("\r\n"); }
+  template <typename T>
+  size_t println(T v) {
+    size_t n = print(v);
+    return n + println();
+  }
+};
+
+// Serial su host: stdout.
+class FilePrint : public Print {
+public:
+  explicit FilePrint(FILE* out) : out_(out) {}
+  size_t write(const uint8_t* data, size_t n) override { return fwrite(data, 1, n, out_); }
+
+private:
+  FILE* out_;
+};
+
+extern FilePrint Serial;
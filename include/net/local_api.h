@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "app/stage_stats.h"
+
+#ifndef LOCAL_API_ENABLED
+#define LOCAL_API_ENABLED 1
+#endif
+#ifndef LOCAL_API_PORT
+#define LOCAL_API_PORT 80
+#endif
+#ifndef LOCAL_API_MAX_CLIENTS
+#define LOCAL_API_MAX_CLIENTS 3 // socket aperti al massimo; oltre si chiude il meno recente
+#endif
+#ifndef LOCAL_API_HISTORY_MAX_MINUTES
+#define LOCAL_API_HISTORY_MAX_MINUTES (12 * 60) // come il server Node
+#endif
+
+// API HTTP locale (esp_http_server) con le stesse forme JSON del server Node:
+//   GET /api/v1/latest              ultima lettura, {"ok":false} se non ce n'è
+//   GET /api/v1/history?minutes=N   {minutes, count, points}: campioni grezzi
+//                                   se la finestra sta nel ring, altrimenti
+//                                   medie per minuto
+// Le risposte escono a chunk da un buffer sullo stack del task del server
+// (core 0, priorità minima), lette dagli snapshot della pipeline: nessun
+// documento JSON in heap e nessun lock sul percorso sensori -> allarme.
+namespace net {
+
+// Avvia il server (idempotente). Da chiamare con la rete su.
+bool localApiBegin();
+bool localApiRunning();
+
+// Tempo di servizio per richiesta (dall'ingresso nell'handler all'ultimo chunk).
+const StageStats& localApiStats();
+void printLocalApiStats(Print& out);
+
+} // namespace net
@@ -1,14 +1,61 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
 #include "app/app_state.h"
 
+#ifndef TELEMETRY_BATCH_URL
+#define TELEMETRY_BATCH_URL TELEMETRY_URL "/batch"
+#endif
+#ifndef TELEMETRY_METRICS_URL
+#define TELEMETRY_METRICS_URL TELEMETRY_URL "/metrics"
+#endif
+#ifndef TELEMETRY_BATCH_MAX
+#define TELEMETRY_BATCH_MAX 20
+#endif
+#ifndef TELEMETRY_BINARY
+#define TELEMETRY_BINARY 1 // usa il formato binario se il server lo annuncia (Accept-Post)
+#endif
+#ifndef TELEMETRY_REQUEST_BUDGET_MS
+#define TELEMETRY_REQUEST_BUDGET_MS 3000 // connect + invio + risposta
+#endif
+
 namespace net {
 
 struct TelemetryPayload {
   AppReadings readings;
-  uint32_t ts; // epoch seconds (0 se non disponibile)
+  uint32_t ts; // epoch seconds dell'acquisizione (0 se non disponibile)
+  uint64_t queuedUs = 0; // ingresso nella coda di telemetria (hal::monoUs(), 0 = lettura senza tracce)
+};
+
+// Contatori della connessione persistente verso il server.
+struct ConnectionStats {
+  uint32_t requests = 0;
+  uint32_t failures = 0;
+  uint32_t connects = 0; // nuovi handshake TCP (il resto è riuso keep-alive)
+  uint32_t lastRttMs = 0;
+  uint32_t maxRttMs = 0;
+  uint64_t totalRttMs = 0;
+  uint64_t bytesSent = 0; // byte di body inviati
 };
 
+// Bloccanti (fino a TELEMETRY_REQUEST_BUDGET_MS): chiamare solo dal task di invio.
 bool postTelemetry(const TelemetryPayload& p);
 
-} // namespace net
\ No newline at end of file
+// Esito di un batch. RETRY: rete, 5xx o ack parziale, lo stesso batch può
+// passare più tardi. REJECTED: il server lo rifiuta (4xx che non dipende da
+// rete, token o formato) o non entra nel buffer di codifica: rimandarlo
+// uguale non serve.
+enum class BatchResult : uint8_t { OK, RETRY, REJECTED };
+
+// POST di n letture in un'unica richiesta (ordinate per ts).
+// accepted = quante il server ha confermato; OK solo se tutte.
+BatchResult postTelemetryBatch(const TelemetryPayload* items, size_t n, size_t& accepted);
+
+// Metriche runtime (JSON di pipeline::encodeMetricsJson) verso TELEMETRY_METRICS_URL.
+bool postMetrics(const char* json, size_t len);
+
+bool binaryNegotiated();
+
+ConnectionStats connectionStats();
+void printConnectionStats(Print& out);
+
+} // namespace net
@@ -0,0 +1,64 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "net/telemetry_client.h"
+
+// Formato binario compatto per la telemetria (Content-Type TELEMETRY_BIN_CONTENT_TYPE).
+// Tutti i campi little-endian. Decoder lato server: server/index.js.
+//
+//   header: 'E' 'M' | version u8 | count u8 | idLen u8 | deviceId[idLen] | baseTs u32
+//   record: dTs varint zigzag (ts - ts precedente, il primo rispetto a baseTs)
+//           flags u8    bit0 dhtOk, bit1 mq7Ok, bit2 calibrated, bit3 warmupDone, bit4-5 level
+//           tC    i16   x100  (INT16_MIN = NaN)
+//           rh    u16   x100  (0xFFFF = NaN)
+//           raw   u16
+//           ratio u16   x10000 (0xFFFF = NaN, saturato a 0xFFFE)
+//           ppm   u16   x10    (0xFFFF = NaN, saturato a 0xFFFE)
+//           r0    varint ohm   (0 = NaN)
+// I campi record vengono da WIRE_V1_FIELDS (src/sensors/board_sensors.h):
+// layout fisso anche su board con meno sensori.
+//
+// Tracce di latenza (opzionali, dopo l'ultimo record: un decoder che non le
+// conosce le ignora, la versione resta 1):
+//   trailer: 'T' | atMs u32 lo, u32 hi | prevSendUs varint | prevAckUs varint
+//   per record: varint 0 = lettura senza tracce, altrimenti 1 + (alarm - acq) us,
+//               poi (queue - alarm) us varint e (encode - queue) us varint
+// Nel JSON: "send": {atMs, prevSendUs, prevAckUs} nel batch e
+// "trace": {alarmUs, queueUs, encodeUs} nei punti tracciati, stessi valori.
+//
+// ~15 byte per lettura (+~6 di tracce) contro ~230 del JSON.
+namespace net {
+
+static constexpr uint8_t TELEMETRY_BIN_VERSION = 1;
+static constexpr const char* TELEMETRY_BIN_CONTENT_TYPE = "application/x-envmon-bin";
+static constexpr size_t TELEMETRY_BIN_MAX_HEADER = 5 + 255 + 4;
+static constexpr size_t TELEMETRY_BIN_MAX_RECORD = 21;
+static constexpr size_t TELEMETRY_BIN_MAX_TRACE = 1 + 8 + 5 + 5; // trailer delle tracce
+static constexpr size_t TELEMETRY_BIN_MAX_TRACE_RECORD = 15;
+// Limiti del JSON equivalente (un punto ~290 byte con le tracce, deviceId corto).
+static constexpr size_t TELEMETRY_JSON_MAX_HEADER = 160;
+static constexpr size_t TELEMETRY_JSON_MAX_POINT = 320;
+
+// Istanti di un batch per le tracce di latenza. I ritardi per lettura
+// (acquisizione -> allarme -> coda -> serializzazione) sono intervalli di
+// hal::monoUs(), esatti; solo atMs dipende dall'ora NTP: il server lo confronta
+// con l'istante di ricezione. Inizio POST e risposta arrivano col batch dopo.
+struct BatchTrace {
+  uint64_t encodeUs = 0;   // serializzazione (hal::monoUs())
+  uint64_t atMs = 0;       // lo stesso istante in UTC ms (0 = ora non valida)
+  uint32_t prevSendUs = 0; // batch precedente: serializzazione -> inizio POST (0 = nessuno)
+  uint32_t prevAckUs = 0;  // batch precedente: inizio POST -> risposta
+};
+
+// JSON di /api/v1/telemetry (un punto) e /api/v1/telemetry/batch, scritto in out
+// senza String. Restituiscono i byte scritti (senza terminatore), 0 se out non basta.
+// Con trace il batch porta anche le tracce di latenza.
+size_t encodeJsonPoint(const char* deviceId, const TelemetryPayload& p, char* out, size_t cap);
+size_t encodeJsonBatch(const char* deviceId, const TelemetryPayload* items, size_t n, char* out, size_t cap,
+                       const BatchTrace* trace = nullptr);
+
+// Restituisce i byte scritti, 0 se out non basta o n > 255.
+size_t encodeBinaryBatch(const char* deviceId, const TelemetryPayload* items, size_t n, uint8_t* out, size_t cap,
+                         const BatchTrace* trace = nullptr);
+
+} // namespace net
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include "net/telemetry_client.h"
+
+#ifndef TQ_RAM_CAPACITY
+#define TQ_RAM_CAPACITY 64          // record in RAM prima di riversare su SD
+#endif
+#ifndef TQ_SPILL_MAX_RECORDS
+#define TQ_SPILL_MAX_RECORDS 50000  // record vivi nel file di spill (~3 MB a 64 B l'uno)
+#endif
+#ifndef TQ_SPILL_COMPACT_MIN
+#define TQ_SPILL_COMPACT_MIN 1024   // record confermati in testa al file prima di compattarlo
+#endif
+#ifndef TQ_SPILL_PATH
+#define TQ_SPILL_PATH "/telemetry_queue.bin"
+#endif
+#ifndef TQ_SPILL_TMP_PATH
+#define TQ_SPILL_TMP_PATH "/telemetry_queue.tmp"
+#endif
+
+namespace net {
+
+// Coda store-and-forward delle letture di telemetria.
+// I record più vecchi stanno nel file di spill su SD, i più recenti in RAM:
+// peek() restituisce sempre i più vecchi, così l'ordine per ts è preservato.
+// Il file si svuota (rimosso) quando tutto è confermato e si compatta quando
+// la testa già confermata supera i record vivi: al massimo ~2 volte
+// TQ_SPILL_MAX_RECORDS su SD. I record ancora in RAM (fino a TQ_RAM_CAPACITY,
+// ~5 min a SEND_PERIOD_MS 5 s) si perdono a un riavvio: vanno su SD solo a
+// RAM piena, per non scrivere la scheda a ogni lettura.
+// Non thread-safe: va usata da un solo task (quello di rete).
+class TelemetryQueue {
+public:
+  // sdReady: SD già montata (da SdLogger). Senza SD la coda resta solo in RAM.
+  void begin(bool sdReady);
+
+  void push(const TelemetryPayload& p);
+  // Copia fino a maxN record più vecchi senza rimuoverli. I ts a 0 (letture
+  // prima di NTP) si ricostruiscono dall'istante di acquisizione, se la
+  // lettura è di questo boot e l'ora ora c'è.
+  size_t peek(TelemetryPayload* out, size_t maxN);
+  // Rimuove n record confermati dal server (quelli restituiti da peek()).
+  void ack(size_t n);
+  // Rimuove n record in testa che il server non accetterà mai (batch rifiutato).
+  void reject(size_t n);
+
+  size_t size() const { return ramCount_ + spillCount_; }
+  bool empty() const { return size() == 0; }
+  uint32_t dropped() const { return dropped_; }
+  // millis() d'ingresso del record più vecchio (spill: quello del primo
+  // riversamento, prudente; dopo un riavvio, il boot).
+  uint32_t oldestEnqueuedMs() const { return spillCount_ > 0 ? spillAtMs_ : ramAtMs_[ramHead_]; }
+
+private:
+  bool spillRam_();
+  bool writeSpillHeader_();
+  void clearSpill_();
+  bool compactSpill_();
+
+  TelemetryPayload ram_[TQ_RAM_CAPACITY];
+  uint32_t ramAtMs_[TQ_RAM_CAPACITY] = {}; // millis() di push() per record
+  size_t ramHead_ = 0; // indice del più vecchio
+  size_t ramCount_ = 0;
+
+  bool sdReady_ = false;
+  uint32_t spillRead_ = 0;  // indice (record) del prossimo da leggere nel file
+  uint32_t spillCount_ = 0; // record non ancora confermati nel file
+  uint32_t bootStart_ = 0;  // primo record di questo boot: i precedenti hanno istanti monotoni di un altro boot
+
+  uint32_t spillAtMs_ = 0;
+  uint32_t dropped_ = 0;
+};
+
+} // namespace net
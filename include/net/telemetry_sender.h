@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "net/telemetry_client.h"
+
+#ifndef METRICS_JSON_MAX
+#define METRICS_JSON_MAX 3072 // corpo JSON delle metriche runtime
+#endif
+
+namespace net {
+
+struct SendResult {
+  bool metrics = false; // esito di submitMetrics(), non di un batch
+  bool ok = false;
+  bool rejected = false; // BatchResult::REJECTED: niente retry dello stesso batch
+  size_t submitted = 0;
+  size_t accepted = 0;
+  uint32_t rttMs = 0;
+  uint64_t doneUs = 0; // hal::monoUs() alla fine della richiesta
+};
+
+// Invio asincrono: submit() copia il batch e ritorna subito, un task dedicato
+// esegue la POST sulla connessione persistente, poll() riporta l'esito.
+// Un solo invio in volo alla volta (batch o metriche); submit/poll dallo stesso task.
+class TelemetrySender {
+public:
+  void begin();
+  bool busy() const { return state_.load(std::memory_order_acquire) != IDLE; }
+  bool submit(const TelemetryPayload* items, size_t n);
+  // Metriche runtime (JSON già pronto) verso TELEMETRY_METRICS_URL.
+  bool submitMetrics(const char* json, size_t len);
+  bool poll(SendResult& out);
+
+private:
+  enum State : uint8_t { IDLE, PENDING, DONE };
+
+  static void taskEntry_(void* arg);
+  void run_();
+
+  bool start_();
+
+  TelemetryPayload items_[TELEMETRY_BATCH_MAX];
+  size_t count_ = 0;
+  char metrics_[METRICS_JSON_MAX];
+  size_t metricsLen_ = 0; // > 0: il job in corso sono le metriche
+  SendResult result_;
+  std::atomic<uint8_t> state_{IDLE};
+  void* task_ = nullptr;
+};
+
+} // namespace net
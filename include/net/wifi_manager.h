@@ -1,9 +1,42 @@
 #pragma once
 #include <Arduino.h>
 
+#ifndef WIFI_MODEM_SLEEP
+#define WIFI_MODEM_SLEEP 1 // modem sleep fra i beacon (0 = radio sempre accesa)
+#endif
+#ifndef WIFI_FAST_CONNECT
+#define WIFI_FAST_CONNECT 1 // riusa BSSID e canale dell'ultimo AP (NVS): niente scansione completa
+#endif
+#ifndef WIFI_CACHE_IP
+#define WIFI_CACHE_IP 0 // 1 = riusa anche l'ultimo lease come IP statico (niente DHCP; serve un IP riservato sul router)
+#endif
+#ifndef WIFI_RETRY_MIN_MS
+#define WIFI_RETRY_MIN_MS 3000 // primo ritentativo, poi raddoppia
+#endif
+#ifndef WIFI_RETRY_MAX_MS
+#define WIFI_RETRY_MAX_MS 60000
+#endif
+
 namespace net {
-  void wifiBegin();
-  void wifiEnsureConnected(uint32_t nowMs);
-  bool wifiIsConnected();
-  String wifiIp();
-}
\ No newline at end of file
+
+struct WifiStats {
+  uint32_t attempts = 0;      // WiFi.begin() chiamati
+  uint32_t fastAttempts = 0;  // di cui con BSSID/canale in cache
+  uint32_t connects = 0;
+  uint32_t fastConnects = 0;
+  uint32_t lastConnectMs = 0; // dall'ultimo begin() all'IP
+  uint32_t firstUpMs = 0;     // millis() del primo IP dal boot (0 = mai)
+};
+
+// Avvia subito l'associazione: prosegue nel driver mentre il boot continua.
+void wifiBegin();
+void wifiEnsureConnected(uint32_t nowMs);
+uint32_t wifiNextTryMs(); // prossimo tentativo di wifiEnsureConnected() se disconnesso
+bool wifiIsConnected();
+String wifiIp();
+// fn gira nel task eventi del WiFi appena c'è l'IP (es. notify del task rete).
+void wifiOnConnected(void (*fn)());
+WifiStats wifiStats();
+void printWifiStats(Print& out);
+
+} // namespace net
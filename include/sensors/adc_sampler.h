@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "util/spsc_ring.h"
+
+// Sorgente di campioni ADC (12 bit) acquisiti in background.
+// Mq7Sensor legge solo da qui: su ESP32 c'è il backend DMA, su host si può
+// alimentare con stream sintetici tramite BufferedAdcSampler::feed().
+class AdcSampler {
+public:
+  virtual ~AdcSampler() = default;
+  virtual bool begin() = 0;
+  // Acquisisce per ms e poi ferma la conversione fino alla prossima chiamata
+  // (0 = continua senza fermarsi). Le sorgenti sempre attive lo ignorano.
+  virtual void startBurst(uint32_t ms) { (void)ms; }
+  // Copia in out fino a maxN campioni accumulati, restituisce quanti.
+  virtual size_t drain(uint16_t* out, size_t maxN) = 0;
+  virtual size_t available() const = 0;
+  virtual uint32_t dropped() const = 0;
+};
+
+// Backend generico su ring buffer: il produttore chiama feed(), il consumatore drain().
+// RING_SIZE: 1024 campioni = 4,1 s a 250 Hz (DmaAdcSampler), 2 KB di RAM.
+// Il consumatore (Mq7Sensor) svuota ogni MQ7_PERIOD_MS: il margine copre un
+// task sensori in ritardo di qualche periodo prima di scartare campioni
+// (controllo statico in mq7_sensor.cpp).
+class BufferedAdcSampler : public AdcSampler {
+public:
+  static constexpr size_t RING_SIZE = 1024;
+
+  bool begin() override { return true; }
+
+  size_t feed(const uint16_t* samples, size_t n) {
+    size_t pushed = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (ring_.push(samples[i])) pushed++;
+    }
+    return pushed;
+  }
+
+  size_t drain(uint16_t* out, size_t maxN) override {
+    size_t n = 0;
+    while (n < maxN && ring_.pop(out[n])) n++;
+    return n;
+  }
+
+  size_t available() const override { return ring_.size(); }
+  uint32_t dropped() const override { return ring_.dropped(); }
+
+protected:
+  SpscRing<uint16_t, RING_SIZE> ring_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h" // DHT_TYPE può arrivare da qui: prima del default
+
+#ifndef DHT_TYPE
+#define DHT_TYPE 11 // 11 = DHT11, 22 = DHT22/AM2302
+#endif
+
+// Esito di una lettura DHT (PENDING solo dalle sorgenti asincrone).
+enum class DhtStatus : uint8_t { OK = 0, PENDING, NO_RESPONSE, SHORT_FRAME, BAD_TIMING, CHECKSUM };
+
+// Protocollo one-wire DHT11/DHT22, senza hardware: decodifica del treno di
+// impulsi catturato (RMT su ESP32, fronti registrati su host) e conversione.
+//   risposta:  basso ~80 us, alto ~80 us
+//   40 bit:    basso ~50 us, poi alto ~26 us (0) o ~70 us (1), MSB prima
+//   byte:      RH int, RH dec, T int, T dec, checksum (somma dei primi 4)
+namespace dhtproto {
+
+static constexpr size_t FRAME_BYTES = 5;
+// Impulsi di un frame completo: risposta + 40 bit + basso finale, più margine
+// per il resto dello start all'inizio della cattura.
+static constexpr size_t MAX_PULSES = 2 + 80 + 1 + 5;
+
+// pulsesUs: durate consecutive a livelli alterni, la prima a firstLevel.
+// Cerca la risposta del sensore e decodifica i 40 bit in out.
+DhtStatus decode(const uint16_t* pulsesUs, size_t n, uint8_t firstLevel, uint8_t out[FRAME_BYTES]);
+
+// Frame valido -> gradi C e %RH (type: 11 o 22).
+void convert(const uint8_t frame[FRAME_BYTES], uint8_t type, float& tC, float& rh);
+
+const char* statusText(DhtStatus s);
+
+} // namespace dhtproto
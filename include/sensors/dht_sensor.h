@@ -1,19 +1,90 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
+#include "sensors/sensor_schema.h"
+#include "sensors/dht_decode.h"
+
+#ifndef DHT_USE_RMT
+#define DHT_USE_RMT 1 // cattura RMT non bloccante (0 = libreria Adafruit, bit-bang a interrupt spenti)
+#endif
+#ifndef DHT_RETRY_MIN_MS
+#define DHT_RETRY_MIN_MS 1000 // primo retry dopo un errore: il DHT non regge letture più fitte
+#endif
+#ifndef DHT_RETRY_MAX_MS
+#define DHT_RETRY_MAX_MS 30000 // backoff raddoppiato a ogni errore fino a qui
+#endif
+#ifndef DHT_MAX_FAILS
+#define DHT_MAX_FAILS 3 // errori di fila prima di invalidare l'ultima lettura buona
+#endif
 
 struct DhtReading {
-  float tC;
-  float rh;
-  bool ok;
+  float tC = NAN;
+  float rh = NAN;
+  bool ok = false;
+  DhtStatus status = DhtStatus::NO_RESPONSE; // esito dell'ultimo tentativo
+  uint64_t atUs = 0; // hal::monoUs() dell'avvio della misura valida (0 = mai)
+};
+
+// Sorgente delle misure DHT: su ESP32 la cattura RMT (o la libreria
+// Adafruit), su host una sorgente fornita dal chiamante (es. replay di log).
+// Asincrona: start() avvia la lettura, poll() dà PENDING finché non è finita.
+class DhtSource {
+public:
+  virtual ~DhtSource() = default;
+  virtual void begin() {}
+  virtual void start(uint32_t nowMs) { (void)nowMs; }
+  virtual DhtStatus poll(uint32_t nowMs, float& tC, float& rh) = 0;
+};
+
+struct DhtStats {
+  uint32_t reads = 0;
+  uint32_t ok = 0;
+  uint32_t noResponse = 0;
+  uint32_t badFrames = 0; // SHORT_FRAME / BAD_TIMING
+  uint32_t checksum = 0;
+  uint32_t retries = 0;   // tentativi dopo un errore
 };
 
 class DhtSensor {
 public:
+  using Reading = DhtReading;
+  static constexpr FieldDesc FIELDS[] = {
+      {"tC", "t", FieldType::F32, offsetof(AppReadings, tC), 2, BinEnc::I16, 0, 100.0f, FIELD_HISTORY},
+      {"rh", "rh", FieldType::F32, offsetof(AppReadings, rh), 2, BinEnc::U16, 0, 100.0f, FIELD_HISTORY},
+      {"dhtOk", "dhtOk", FieldType::BOOL, offsetof(AppReadings, dhtOk), 0, BinEnc::FLAG, 0, 1.0f, FIELD_HISTORY},
+  };
+  static void fill(const DhtReading& d, AppReadings& r) {
+    r.tC = d.tC;
+    r.rh = d.rh;
+    r.dhtOk = d.ok;
+  }
+
+  // Va impostata prima di begin(); di default il DHT su PIN_DHT (solo ESP32).
+  void setSource(DhtSource* source) { source_ = source; }
   void begin();
+  // Non blocca: avvia una lettura ogni DHT_PERIOD_MS e ne raccoglie l'esito
+  // a una chiamata successiva. Dopo un errore riprova con backoff
+  // (DHT_RETRY_MIN_MS..DHT_RETRY_MAX_MS); l'ultima lettura buona resta valida
+  // fino a DHT_MAX_FAILS errori di fila.
   void update(uint32_t nowMs);
   DhtReading get() const { return last_; }
+  // Lettura in corso: prossimo poll; altrimenti prossimo avvio.
+  uint32_t nextDeadlineMs() const { return busy_ ? pollAtMs_ : nextRead_; }
+
+  const DhtStats& stats() const { return stats_; }
+  void printStats(Print& out) const;
 
 private:
+  static constexpr uint32_t POLL_MS = 5; // frame DHT: ~5 ms dopo lo start
+
+  void finish_(uint32_t nowMs, DhtStatus st, float tC, float rh);
+
+  DhtSource* source_ = nullptr;
+  bool busy_ = false;
   uint32_t nextRead_ = 0;
-  DhtReading last_{NAN, NAN, false};
-};
\ No newline at end of file
+  uint32_t pollAtMs_ = 0;
+  uint64_t startUs_ = 0; // avvio della lettura in corso
+  uint32_t backoffMs_ = DHT_RETRY_MIN_MS;
+  uint8_t fails_ = 0;
+  DhtReading last_;
+  DhtStats stats_;
+};
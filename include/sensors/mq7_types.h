@@ -1,5 +1,5 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
 
 struct Mq7Reading {
   uint16_t raw = 0;     // ADC raw 0..4095 (nodo)
@@ -10,6 +10,9 @@ struct Mq7Reading {
   bool calibrated = false;
   bool warmupDone = false;
   float ratio = NAN;    // Rs/R0
+  float ratioMedian = NAN; // ratio dopo la sola mediana (spike via, nessun ritardo): guida l'allarme
+  float ratioSmooth = NAN; // mediana + EMA: più liscio ma in ritardo, per la visualizzazione
   float ppm = NAN;      // stima CO ppm
   bool ok = false;
+  uint64_t atUs = 0;    // hal::monoUs() al centro della finestra mediata (0 = mai letto)
 };
@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include "sensors/sensor_schema.h"
+
+// Registro dei sensori di una board, risolto a compile time: ogni chiamata è
+// un fold sui tipi (niente virtual, niente puntatori a sensore). Un sensore S:
+//   using Reading = ...;                        lettura copiabile (snapshot) con
+//                                               uint64_t atUs (hal::monoUs() dell'acquisizione)
+//   void begin();  void update(uint32_t nowMs);  Reading get() const;
+//   uint32_t nextDeadlineMs() const;             prossimo update() con lavoro da fare
+//   static constexpr FieldDesc FIELDS[] = {...}; campi in AppReadings
+//   static void fill(const Reading&, AppReadings&);
+// Un tipo compare al massimo una volta (le letture si cercano per tipo).
+template <typename... S>
+class SensorRegistry {
+public:
+  using Readings = std::tuple<typename S::Reading...>;
+  static constexpr size_t COUNT = sizeof...(S);
+  static constexpr auto FIELDS = fieldsOf<S...>();
+
+  template <typename T>
+  static constexpr bool has() {
+    return (std::is_same<T, S>::value || ...);
+  }
+
+  void begin() { (std::get<S>(sensors_).begin(), ...); }
+  void update(uint32_t nowMs) { (std::get<S>(sensors_).update(nowMs), ...); }
+  Readings get() const { return Readings{std::get<S>(sensors_).get()...}; }
+
+  // f(scadenza) per ogni sensore: chi dorme fino alla prima non perde update.
+  template <typename F>
+  void forEachDeadline(F&& f) const {
+    (f(std::get<S>(sensors_).nextDeadlineMs()), ...);
+  }
+
+  // f(sensore&) per ogni sensore, in ordine (es. per misurarne l'update).
+  template <typename F>
+  void forEach(F&& f) {
+    (f(std::get<S>(sensors_)), ...);
+  }
+
+  template <typename T>
+  T& sensor() {
+    return std::get<T>(sensors_);
+  }
+  template <typename T>
+  const T& sensor() const {
+    return std::get<T>(sensors_);
+  }
+
+  // Copia le letture nei campi di AppReadings (quelli dei sensori assenti
+  // restano ai default); atUs = l'acquisizione più recente.
+  static void fill(const Readings& in, AppReadings& out) {
+    (S::fill(std::get<typename S::Reading>(in), out), ...);
+    const uint64_t atUs[] = {0, std::get<typename S::Reading>(in).atUs...};
+    for (uint64_t t : atUs) {
+      if (t > out.atUs) out.atUs = t;
+    }
+    (void)in;
+    (void)out;
+  }
+
+private:
+  std::tuple<S...> sensors_;
+};
+
+namespace detail {
+template <typename R, typename... S>
+struct RegistryBuilder {
+  using type = R;
+};
+template <typename... A, typename H, typename... T>
+struct RegistryBuilder<SensorRegistry<A...>, H, T...> {
+  using type = typename RegistryBuilder<
+      std::conditional_t<std::is_void<H>::value, SensorRegistry<A...>, SensorRegistry<A..., H>>, T...>::type;
+};
+} // namespace detail
+
+// Come SensorRegistry ma salta i void: SensorRegistryOf<std::conditional_t<HAS_X, X, void>, ...>.
+template <typename... S>
+using SensorRegistryOf = typename detail::RegistryBuilder<SensorRegistry<>, S...>::type;
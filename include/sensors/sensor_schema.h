@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <array>
+#include <iterator>
+#include "app/app_state.h"
+
+// Descrittore di un campo di AppReadings: da qui escono colonne CSV, chiavi
+// JSON e record binario. Ogni sensore dichiara i suoi in FIELDS[], il
+// registro (sensor_registry.h) li concatena nell'ordine della board.
+enum class FieldType : uint8_t { F32, U16, U8, BOOL };
+
+// Codifica nel record telemetria v1 (telemetry_codec.h): i FLAG vanno nel
+// byte flags dal bit binArg in su, gli altri in ordine di schema.
+enum class BinEnc : uint8_t { NONE, FLAG, I16, U16, VARINT };
+
+enum FieldFlags : uint8_t {
+  FIELD_HISTORY = 0x01, // presente in HistSample (API locale: null negli storici se manca)
+};
+
+struct FieldDesc {
+  const char* csv = nullptr;  // colonna CSV
+  const char* json = nullptr; // chiave JSON (come normalizePoint() del server)
+  FieldType type = FieldType::F32;
+  uint16_t offset = 0;        // offsetof(AppReadings, ...)
+  uint8_t decimals = 0;       // testo: CSV e API locale
+  BinEnc bin = BinEnc::NONE;
+  uint8_t binArg = 0;         // FLAG: primo bit nel byte flags
+  float binScale = 1.0f;      // I16/U16: valore * scala
+  uint8_t flags = 0;          // FieldFlags
+};
+
+// Valore del campo come float (bool -> 0/1); NaN passa così com'è.
+inline float fieldFloat(const FieldDesc& f, const AppReadings& r) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&r) + f.offset;
+  switch (f.type) {
+  case FieldType::F32: {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  case FieldType::U16: {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  case FieldType::U8:
+    return *p;
+  case FieldType::BOOL:
+    return *reinterpret_cast<const bool*>(p) ? 1.0f : 0.0f;
+  }
+  return NAN;
+}
+
+// Valore intero per U16/U8/BOOL (0 per F32).
+inline uint32_t fieldUint(const FieldDesc& f, const AppReadings& r) {
+  return f.type == FieldType::F32 ? 0 : (uint32_t)fieldFloat(f, r);
+}
+
+// Byte flags del record binario: OR dei campi BinEnc::FLAG.
+template <size_t N>
+uint8_t packFlags(const std::array<FieldDesc, N>& fields, const AppReadings& r) {
+  uint8_t flags = 0;
+  for (const FieldDesc& f : fields) {
+    if (f.bin == BinEnc::FLAG) flags |= (uint8_t)(fieldUint(f, r) << f.binArg);
+  }
+  return flags;
+}
+
+template <size_t M, size_t N>
+constexpr void appendFields(std::array<FieldDesc, M>& out, size_t& i, const FieldDesc (&in)[N]) {
+  for (size_t k = 0; k < N; k++) out[i++] = in[k];
+}
+
+// FIELDS dei tipi T..., concatenati in ordine.
+template <typename... T>
+constexpr auto fieldsOf() {
+  std::array<FieldDesc, (std::size(T::FIELDS) + ... + 0)> out{};
+  size_t i = 0;
+  (appendFields(out, i, T::FIELDS), ...);
+  (void)i;
+  return out;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Formato del log binario su SD, condiviso tra firmware (BinLogger) e
+// strumenti host (tools/envlog). Schema logico = colonne del CSV.
+//
+// /log/AAAAMMGG-NN.bin : FileHeader (32 B) + Record (32 B) in append
+// /log/AAAAMMGG-NN.idx : IndexEntry ogni INDEX_STRIDE record con ts valido
+//
+// Header e record sono da 32 byte: 16 slot per settore da 512.
+namespace envlog {
+
+static constexpr uint32_t FILE_MAGIC = 0x474C4E45; // "ENLG"
+static constexpr uint16_t FILE_VERSION = 1;
+static constexpr uint32_t INDEX_STRIDE = 64;
+
+static constexpr const char* CSV_HEADER =
+    "ts,millis,tC,rh,dhtOk,mq7Raw,mq7Ratio,mq7Ppm,mq7R0,mq7Ok,mq7Calibrated,mq7WarmupDone,mq7Level";
+
+enum RecordFlags : uint8_t {
+  FLAG_DHT_OK = 0x01,
+  FLAG_MQ7_OK = 0x02,
+  FLAG_MQ7_CALIBRATED = 0x04,
+  FLAG_MQ7_WARMUP_DONE = 0x08,
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t createdTs; // epoch del primo record (0 se ora non valida)
+  uint8_t reserved[20];
+};
+
+struct Record {
+  uint32_t ts;     // epoch seconds (0 se non disponibile)
+  uint32_t millis;
+  float tC;
+  float rh;
+  float mq7Ratio;
+  float mq7Ppm;
+  float mq7R0;
+  uint16_t mq7Raw;
+  uint8_t flags;   // RecordFlags
+  uint8_t mq7Level;
+};
+
+struct IndexEntry {
+  uint32_t ts;
+  uint32_t recordNo;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader must be 32 bytes");
+static_assert(sizeof(Record) == 32, "Record must be 32 bytes");
+
+} // namespace envlog
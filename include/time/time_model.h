@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+#ifndef TIME_DRIFT_MIN_SPAN_S
+#define TIME_DRIFT_MIN_SPAN_S 600 // sync più vicine di così non aggiornano la deriva
+#endif
+#ifndef TIME_DRIFT_MAX_PPM
+#define TIME_DRIFT_MAX_PPM 500 // oltre è un salto d'ora, non deriva del quarzo
+#endif
+
+// Mappa il tempo monotono (hal::monoUs()) su UTC. Ogni sync NTP dà una coppia
+// (mono, utc): l'ultima fa da origine, la deriva del quarzo (ppm) si stima fra
+// sync distanti almeno TIME_DRIFT_MIN_SPAN_S e si media. Vale anche
+// all'indietro: una lettura presa prima della prima sync ha il suo istante
+// UTC appena la sync arriva. Copiabile banalmente (SeqLock).
+class TimeModel {
+public:
+  void sync(uint64_t monoUs, uint64_t utcUs);
+  bool valid() const { return syncs_ > 0; }
+  // UTC in µs dell'istante monotono monoUs (0 se !valid()).
+  uint64_t utcUs(uint64_t monoUs) const;
+  float driftPpm() const { return driftPpm_; }
+  uint32_t syncs() const { return syncs_; }
+  int64_t lastErrorUs() const { return lastErrorUs_; } // utc vero - previsto, all'ultima sync
+
+private:
+  uint64_t monoRef_ = 0; // ultima sync: origine della mappa
+  uint64_t utcRef_ = 0;
+  uint64_t monoAnchor_ = 0; // sync da cui si misura la deriva
+  uint64_t utcAnchor_ = 0;
+  float driftPpm_ = 0.0f;
+  bool driftKnown_ = false;
+  uint32_t syncs_ = 0;
+  int64_t lastErrorUs_ = 0;
+};
@@ -5,4 +5,11 @@ namespace timeutil {
   void beginNtp();              // chiama configTime
   bool isTimeValid();           // true quando time() è “sensato”
   uint32_t unixTime();          // epoch seconds (0 se non valido)
-}
\ No newline at end of file
+
+  // Istante monotono (hal::monoUs()) -> UTC, dal modello offset + deriva
+  // aggiornato a ogni sync NTP; vale anche per istanti prima della sync.
+  uint64_t unixUsAt(uint64_t monoUs); // 0 se mai sincronizzato
+  // epoch seconds (0 se mai sincronizzato); monoUs 0 (istante ignoto) = unixTime()
+  uint32_t unixAt(uint64_t monoUs);
+  void printStats(Print& out);
+}
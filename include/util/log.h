@@ -0,0 +1,186 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+#include "hal/hal.h"
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3 // livello massimo compilato: 1 error, 2 warn, 3 info, 4 debug
+#endif
+#ifndef LOG_DEFAULT_LEVEL
+#define LOG_DEFAULT_LEVEL 3 // livello iniziale di ogni modulo (setLevel() a runtime)
+#endif
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 32 // messaggi in attesa del task di scarico (potenza di 2)
+#endif
+#ifndef LOG_RATE_MAX
+#define LOG_RATE_MAX 20 // messaggi per modulo per finestra, oltre si scartano
+#endif
+#ifndef LOG_RATE_WINDOW_MS
+#define LOG_RATE_WINDOW_MS 1000
+#endif
+#ifndef LOG_BINARY
+#define LOG_BINARY 0 // 1 = frame binari sulla seriale (tools/logdecode), 0 = testo
+#endif
+
+// Log strutturato: livelli, moduli, rate limit per modulo. Chi logga non
+// formatta e non tocca la UART: copia formato (puntatore) e argomenti in uno
+// slot di un ring lock-free e torna; un task a bassa priorità formatta e
+// scrive. Ring pieno = messaggio scartato e contato, mai attesa.
+// Prima di begin() (e sull'host) lo scarico avviene subito, nel chiamante.
+// Il formato resta un puntatore: solo stringhe letterali (le macro LOGx).
+namespace logging {
+
+enum class Level : uint8_t { NONE = 0, ERROR = 1, WARN = 2, INFO = 3, DEBUG = 4 };
+enum class Mod : uint8_t { SYS = 0, SENSOR, ALARM, STORAGE, NET, DISPLAY, COUNT };
+
+static constexpr size_t PAYLOAD = 112; // argomenti codificati
+
+// Argomenti: tag + valore; le stringhe si copiano (troncate allo spazio che resta).
+enum ArgTag : uint8_t { ARG_I32 = 0, ARG_U32, ARG_I64, ARG_U64, ARG_F32, ARG_STR };
+
+struct Record {
+  uint32_t ms;
+  const char* fmt;
+  uint8_t level;
+  uint8_t mod;
+  uint8_t len; // byte usati in data
+  uint8_t nargs;
+  uint8_t data[PAYLOAD];
+};
+
+struct Stats {
+  uint32_t written;
+  uint32_t droppedFull; // ring pieno
+  uint32_t droppedRate; // oltre LOG_RATE_MAX
+  uint32_t truncated;   // argomenti tagliati (non stavano in PAYLOAD)
+};
+
+// Avvia il task di scarico verso out (ESP32); senza, lo scarico è sincrono.
+void begin(Print& out);
+void setSink(Print& out);
+void setLevel(Mod m, Level l);
+Level level(Mod m);
+void setBinary(bool on);
+// Messaggi per modulo per finestra (0 = nessun limite); all'avvio LOG_RATE_MAX.
+void setRateLimit(uint16_t perWindow);
+// Scarica il ring nel chiamante (sull'host, o prima di reset e deep sleep);
+// se lo sta già scaricando il task, aspetta che finisca.
+void flush();
+Stats stats();
+void printStats(Print& out);
+
+const char* levelName(Level l);
+const char* modName(Mod m);
+// Testo di un record (senza prefisso né "\n"); byte scritti, troncati a cap - 1.
+size_t formatRecord(const Record& r, char* out, size_t cap);
+// Riga completa come sulla seriale: "[s.ms] LIV mod: testo\n"; byte scritti.
+size_t formatLine(const Record& r, char* out, size_t cap);
+// Corpo di un frame MSG (senza tipo e lunghezza) col formato id; byte scritti,
+// 0 se cap < 8 + r.len.
+size_t encodeMsg(const Record& r, uint16_t id, uint8_t* out, size_t cap);
+
+namespace detail {
+
+struct Writer {
+  uint8_t* p;
+  uint8_t* end;
+  bool cut;
+  void raw(uint8_t tag, const void* v, size_t n) {
+    if ((size_t)(end - p) < n + 1) {
+      cut = true;
+      return;
+    }
+    *p++ = tag;
+    memcpy(p, v, n);
+    p += n;
+  }
+  void str(const char* s) {
+    if (!s) s = "(null)";
+    if (end - p < 2) {
+      cut = true;
+      return;
+    }
+    size_t n = strlen(s);
+    const size_t room = (size_t)(end - p) - 2;
+    if (n > room) {
+      n = room;
+      cut = true;
+    }
+    if (n > 255) n = 255;
+    *p++ = ARG_STR;
+    *p++ = (uint8_t)n;
+    memcpy(p, s, n);
+    p += n;
+  }
+};
+
+template <typename T>
+void put(Writer& w, const T& v) {
+  using U = std::decay_t<T>;
+  if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) {
+    w.str(v);
+  } else if constexpr (std::is_floating_point_v<U>) {
+    const float f = (float)v;
+    w.raw(ARG_F32, &f, 4);
+  } else if constexpr (std::is_integral_v<U> || std::is_enum_v<U>) {
+    if constexpr (sizeof(U) <= 4) {
+      if constexpr (std::is_signed_v<U>) {
+        const int32_t x = (int32_t)v;
+        w.raw(ARG_I32, &x, 4);
+      } else {
+        const uint32_t x = (uint32_t)v;
+        w.raw(ARG_U32, &x, 4);
+      }
+    } else if constexpr (std::is_signed_v<U>) {
+      const int64_t x = (int64_t)v;
+      w.raw(ARG_I64, &x, 8);
+    } else {
+      const uint64_t x = (uint64_t)v;
+      w.raw(ARG_U64, &x, 8);
+    }
+  } else {
+    static_assert(std::is_pointer_v<U>, "logging: unsupported argument type");
+    const uint64_t x = (uint64_t)(uintptr_t)v;
+    w.raw(ARG_U64, &x, 8);
+  }
+}
+
+using EncodeFn = void (*)(Writer& w, const void* args);
+bool allow(Level l, Mod m);
+void push(Level l, Mod m, const char* fmt, uint8_t nargs, EncodeFn enc, const void* args);
+
+// Solo per il controllo dei formati a compile time (mai chiamata).
+inline void check(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void check(const char*, ...) {}
+
+} // namespace detail
+
+template <typename... A>
+void write(Level l, Mod m, const char* fmt, const A&... args) {
+  if (!detail::allow(l, m)) return;
+  using Args = std::tuple<const A&...>;
+  const Args tup(args...);
+  detail::push(
+      l, m, fmt, (uint8_t)sizeof...(A),
+      [](detail::Writer& w, const void* p) {
+        std::apply([&w](const auto&... a) { (detail::put(w, a), ...); }, *static_cast<const Args*>(p));
+      },
+      &tup);
+}
+
+} // namespace logging
+
+#define LOG_AT(lv, mod, ...)                                                                \
+  do {                                                                                      \
+    if ((int)(lv) <= LOG_LEVEL) {                                                           \
+      if (false) ::logging::detail::check(__VA_ARGS__);                                     \
+      ::logging::write(lv, mod, __VA_ARGS__);                                               \
+    }                                                                                       \
+  } while (0)
+#define LOGE(mod, ...) LOG_AT(::logging::Level::ERROR, ::logging::Mod::mod, __VA_ARGS__)
+#define LOGW(mod, ...) LOG_AT(::logging::Level::WARN, ::logging::Mod::mod, __VA_ARGS__)
+#define LOGI(mod, ...) LOG_AT(::logging::Level::INFO, ::logging::Mod::mod, __VA_ARGS__)
+#define LOGD(mod, ...) LOG_AT(::logging::Level::DEBUG, ::logging::Mod::mod, __VA_ARGS__)
@@ -0,0 +1,66 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Ring buffer lock-free multi-producer / single-consumer a slot fissi (schema
+// di Vyukov: un numero di sequenza per slot). I produttori si contendono la
+// testa con una CAS e riempiono lo slot sul posto; ring pieno = push() false,
+// mai attesa. N deve essere potenza di 2. Non da ISR.
+template <typename T, size_t N>
+class MpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRing: N must be a power of two");
+
+public:
+  MpscRing() {
+    for (size_t i = 0; i < N; i++) seq_[i].store((uint32_t)i, std::memory_order_relaxed);
+  }
+
+  // fill(T&) riempie lo slot riservato.
+  template <typename F>
+  bool push(F&& fill) {
+    uint32_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      const uint32_t seq = seq_[pos & (N - 1)].load(std::memory_order_acquire);
+      const int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    fill(buf_[pos & (N - 1)]);
+    seq_[pos & (N - 1)].store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // use(const T&) sul più vecchio; false se vuoto o se il suo produttore
+  // non ha ancora finito di scriverlo.
+  template <typename F>
+  bool pop(F&& use) {
+    const uint32_t pos = tail_.load(std::memory_order_relaxed);
+    const uint32_t seq = seq_[pos & (N - 1)].load(std::memory_order_acquire);
+    if ((int32_t)(seq - (pos + 1)) < 0) return false;
+    use(static_cast<const T&>(buf_[pos & (N - 1)]));
+    seq_[pos & (N - 1)].store(pos + N, std::memory_order_release);
+    tail_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  static constexpr size_t capacity() { return N; }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  T buf_[N];
+  std::atomic<uint32_t> seq_[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
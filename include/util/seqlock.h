@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include "hal/hal.h"
+
+// Contatore di sequenza di un seqlock (un solo scrittore), per i dati che non
+// stanno in un solo T (es. History, ring copiati a pezzi). Dispari = scrittura
+// in corso. Un lettore a priorità più alta sullo stesso core può interrompere
+// lo scrittore a metà (es. task allarme 5 sul task sensori 4, core 1): se
+// girasse a vuoto lo scrittore non ripartirebbe più. Per questo, a scrittura
+// in corso, readBegin() cede la CPU (hal::yieldLower()) invece di ripetere subito.
+//
+//   do { s = seq.readBegin(); ...copia... } while (seq.readRetry(s));
+class SeqCount {
+public:
+  void writeBegin() {
+    seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  void writeEnd() { seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  uint32_t readBegin() const {
+    uint32_t s;
+    while ((s = seq_.load(std::memory_order_acquire)) & 1u) hal::yieldLower();
+    return s;
+  }
+  // true se nel frattempo è arrivata una scrittura: la copia va rifatta.
+  bool readRetry(uint32_t s) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq_.load(std::memory_order_relaxed) != s;
+  }
+
+  uint32_t load() const { return seq_.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<uint32_t> seq_{0};
+};
+
+// Snapshot condiviso tra task senza mutex (seqlock, un solo scrittore).
+// Lo scrittore non aspetta mai; il lettore ripete la copia se nel frattempo
+// è arrivata una scrittura. T deve essere copiabile banalmente.
+template <typename T>
+class SeqLock {
+public:
+  void write(const T& v) {
+    seq_.writeBegin();
+    data_ = v;
+    seq_.writeEnd();
+  }
+
+  // Restituisce la versione letta (0 = mai scritto).
+  uint32_t read(T& out) const {
+    uint32_t s;
+    do {
+      s = seq_.readBegin();
+      out = data_;
+    } while (seq_.readRetry(s));
+    return s / 2;
+  }
+
+  uint32_t version() const { return seq_.load() / 2; }
+
+private:
+  T data_{};
+  SeqCount seq_;
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+
+// Statistiche in streaming, O(1) memoria per campione e nessuna allocazione.
+// Pensate per un solo task proprietario: niente atomici.
+
+// Media e varianza di Welford (stabile anche con valori grandi e vicini tra
+// loro, es. Rs ~10k ohm), più min/max.
+class RunningStats {
+public:
+  void add(float x) {
+    n_++;
+    const float d = x - mean_;
+    mean_ += d / n_;
+    m2_ += d * (x - mean_);
+    if (n_ == 1 || x < min_) min_ = x;
+    if (n_ == 1 || x > max_) max_ = x;
+  }
+
+  void reset() { *this = RunningStats(); }
+
+  uint32_t count() const { return n_; }
+  float mean() const { return n_ ? mean_ : NAN; }
+  float variance() const { return n_ ? m2_ / n_ : NAN; } // di popolazione
+  float stddev() const { return sqrtf(variance()); }
+  float relStddev() const { return (n_ && mean_ != 0.0f) ? stddev() / fabsf(mean_) : NAN; }
+  float min() const { return n_ ? min_ : NAN; }
+  float max() const { return n_ ? max_ : NAN; }
+
+private:
+  uint32_t n_ = 0;
+  float mean_ = 0.0f;
+  float m2_ = 0.0f;
+  float min_ = NAN;
+  float max_ = NAN;
+};
+
+// Media mobile esponenziale: alpha in (0, 1], 1 = nessun filtro.
+// Il primo campione inizializza il valore (niente rampa da zero).
+class Ema {
+public:
+  explicit Ema(float alpha = 1.0f) : alpha_(alpha) {}
+
+  float add(float x) {
+    value_ = isnan(value_) ? x : value_ + alpha_ * (x - value_);
+    return value_;
+  }
+
+  void reset() { value_ = NAN; }
+  float value() const { return value_; }
+
+private:
+  float alpha_;
+  float value_ = NAN;
+};
+
+// Mediana sugli ultimi N campioni: scarta gli spike isolati (fino a N/2
+// consecutivi). Finché la finestra non è piena usa quelli che ha.
+template <size_t N>
+class MedianWindow {
+  static_assert(N >= 1 && N <= 15, "MedianWindow: N in 1..15 (ordinamento per inserzione)");
+
+public:
+  float add(float x) {
+    buf_[head_] = x;
+    head_ = (head_ + 1) % N;
+    if (count_ < N) count_++;
+    return median();
+  }
+
+  float median() const {
+    if (count_ == 0) return NAN;
+    float s[N];
+    for (size_t i = 0; i < count_; i++) {
+      const float v = buf_[i];
+      size_t j = i;
+      for (; j > 0 && s[j - 1] > v; j--) s[j] = s[j - 1];
+      s[j] = v;
+    }
+    return (count_ & 1) ? s[count_ / 2] : 0.5f * (s[count_ / 2 - 1] + s[count_ / 2]);
+  }
+
+  void reset() {
+    count_ = 0;
+    head_ = 0;
+  }
+
+  size_t count() const { return count_; }
+
+private:
+  float buf_[N];
+  size_t count_ = 0;
+  size_t head_ = 0;
+};
+
+// Catena completa: mediana (spike) -> EMA (rumore) + Welford/min/max sui
+// valori filtrati dalla mediana. I NaN non entrano e non sporcano lo stato.
+template <size_t MEDIAN_N>
+class StreamStats {
+public:
+  explicit StreamStats(float emaAlpha = 1.0f) : ema_(emaAlpha) {}
+
+  // Restituisce il valore smussato (NaN finché non arriva un campione valido).
+  float add(float x) {
+    if (isnan(x)) return ema_.value();
+    const float m = median_.add(x);
+    stats_.add(m);
+    return ema_.add(m);
+  }
+
+  void reset() {
+    median_.reset();
+    ema_.reset();
+    stats_.reset();
+  }
+
+  float value() const { return ema_.value(); }
+  float median() const { return median_.median(); }
+  const RunningStats& stats() const { return stats_; }
+  // Riparte con media/varianza ma tiene mediana ed EMA (finestre successive).
+  void resetStats() { stats_.reset(); }
+
+private:
+  MedianWindow<MEDIAN_N> median_;
+  Ema ema_;
+  RunningStats stats_;
+};
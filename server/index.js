@@ -4,7 +4,16 @@ import { fileURLToPath } from "url";
 import https from "https";
 
 const app = express();
+const BIN_CONTENT_TYPE = "application/x-envmon-bin";
+const ACCEPT_POST = `application/json, ${BIN_CONTENT_TYPE}`;
+
+// Istante d'arrivo prima della lettura del corpo: termine delle tracce di latenza.
+app.use((req, _res, next) => {
+  req.receivedAt = Date.now();
+  next();
+});
 app.use(express.json({ limit: "64kb" }));
+app.use(express.raw({ type: BIN_CONTENT_TYPE, limit: "64kb" }));
 
 const __filename = fileURLToPath(import.meta.url);
 const __dirname = path.dirname(__filename);
@@ -108,11 +117,196 @@ function startTelegramNotifier() {
   }, TELEGRAM_PERIOD_MS);
 }
 
-app.post("/api/v1/telemetry", (req, res) => {
+// Decoder del formato binario del firmware (vedi include/net/telemetry_codec.h).
+// Dopo i record puo seguire il trailer 'T' con le tracce di latenza.
+function decodeBinaryBatch(buf) {
+  let off = 0;
+  const need = (n) => {
+    if (off + n > buf.length) throw new Error("truncated payload");
+  };
+  const u8 = () => {
+    need(1);
+    return buf.readUInt8(off++);
+  };
+  const u16 = () => {
+    need(2);
+    const v = buf.readUInt16LE(off);
+    off += 2;
+    return v;
+  };
+  const varint = () => {
+    let v = 0;
+    for (let shift = 0; shift < 35; shift += 7) {
+      const b = u8();
+      v += (b & 0x7f) * 2 ** shift;
+      if (!(b & 0x80)) return v;
+    }
+    throw new Error("bad varint");
+  };
+
+  if (u8() !== 0x45 || u8() !== 0x4d) throw new Error("bad magic");
+  const version = u8();
+  if (version !== 1) throw new Error(`unsupported version ${version}`);
+  const count = u8();
+  const idLen = u8();
+  need(idLen);
+  const deviceId = buf.toString("utf8", off, off + idLen);
+  off += idLen;
+  need(4);
+  let ts = buf.readUInt32LE(off);
+  off += 4;
+
+  const points = [];
+  for (let i = 0; i < count; i++) {
+    const z = varint();
+    ts += z % 2 ? -(z + 1) / 2 : z / 2;
+    const flags = u8();
+    const tC = u16();
+    const rh = u16();
+    const raw = u16();
+    const ratio = u16();
+    const ppm = u16();
+    const r0 = varint();
+    const tSigned = tC >= 0x8000 ? tC - 0x10000 : tC;
+    points.push({
+      ts,
+      t: tSigned === -0x8000 ? null : tSigned / 100,
+      rh: rh === 0xffff ? null : rh / 100,
+      dhtOk: Boolean(flags & 0x01),
+      mq7Raw: raw,
+      mq7Ratio: ratio === 0xffff ? null : ratio / 10000,
+      mq7Ppm: ppm === 0xffff ? null : ppm / 10,
+      mq7R0: r0 === 0 ? null : r0,
+      mq7Ok: Boolean(flags & 0x02),
+      mq7Calibrated: Boolean(flags & 0x04),
+      mq7WarmupDone: Boolean(flags & 0x08),
+      mq7Level: (flags >> 4) & 0x03
+    });
+  }
+
+  let send = null;
+  if (off < buf.length && buf[off] === 0x54) {
+    off++;
+    need(8);
+    const atMs = buf.readUInt32LE(off) + buf.readUInt32LE(off + 4) * 2 ** 32;
+    off += 8;
+    send = { atMs, prevSendUs: varint(), prevAckUs: varint() };
+    for (const p of points) {
+      const alarm = varint();
+      if (alarm === 0) continue;
+      p.trace = { alarmUs: alarm - 1, queueUs: varint(), encodeUs: varint() };
+    }
+  }
+  return { deviceId, points, send };
+}
+
+// Corpo della richiesta come { deviceId, points, send } indipendentemente dal formato.
+function readTelemetryBody(req) {
+  if (Buffer.isBuffer(req.body)) return decodeBinaryBatch(req.body);
   const b = req.body || {};
-  const point = {
-    deviceId: String(b.deviceId || "unknown"),
-    ts: Number(b.ts || Math.floor(Date.now() / 1000)), // fallback
+  if (Array.isArray(b.points)) return { deviceId: b.deviceId, points: b.points, send: b.send ?? null };
+  return { deviceId: b.deviceId, points: [b], send: null };
+}
+
+// ====== Latenze end-to-end ======
+// Per device, ultimi LATENCY_WINDOW campioni di ogni segmento (ms). I segmenti
+// sul device sono intervalli del suo orologio monotono; quelli che finiscono
+// in "receive" confrontano l'ora NTP del device con quella del server.
+// serializeToSend e sendToAck arrivano col batch successivo.
+const LATENCY_WINDOW = Number(process.env.LATENCY_WINDOW || 1000);
+const LATENCY_SEGMENTS = [
+  "acquireToAlarm",
+  "alarmToQueue",
+  "queueToSerialize",
+  "serializeToSend",
+  "sendToAck",
+  "serializeToReceive",
+  "acquireToReceive"
+];
+const TRACE_SATURATED = 0xfffffffe; // intervallo oltre ~71 min
+const latencyByDevice = new Map();
+
+function latencyFor(deviceId) {
+  let d = latencyByDevice.get(deviceId);
+  if (!d) {
+    d = { deviceId, updatedAt: 0, segments: {} };
+    for (const name of LATENCY_SEGMENTS) d.segments[name] = { values: [], next: 0 };
+    latencyByDevice.set(deviceId, d);
+  }
+  return d;
+}
+
+function addLatency(d, name, ms) {
+  if (!Number.isFinite(ms)) return;
+  const seg = d.segments[name];
+  if (seg.values.length < LATENCY_WINDOW) {
+    seg.values.push(ms);
+  } else {
+    seg.values[seg.next] = ms;
+    seg.next = (seg.next + 1) % LATENCY_WINDOW;
+  }
+}
+
+const traceUs = (v) => {
+  const n = Number(v);
+  return Number.isFinite(n) && n >= 0 && n < TRACE_SATURATED ? n : null;
+};
+
+function recordLatency(body, receivedAt) {
+  const send = body.send;
+  const traced = body.points.filter((p) => p && p.trace);
+  if (!send && traced.length === 0) return;
+
+  const d = latencyFor(String(body.deviceId || "unknown"));
+  d.updatedAt = receivedAt;
+  const atMs = Number(send?.atMs) || 0; // 0 = ora del device non valida
+  if (send) {
+    const sendUs = traceUs(send.prevSendUs);
+    const ackUs = traceUs(send.prevAckUs);
+    if (sendUs) addLatency(d, "serializeToSend", sendUs / 1000);
+    if (ackUs) addLatency(d, "sendToAck", ackUs / 1000);
+    if (atMs) addLatency(d, "serializeToReceive", receivedAt - atMs);
+  }
+  for (const p of traced) {
+    const alarmUs = traceUs(p.trace.alarmUs);
+    const queueUs = traceUs(p.trace.queueUs);
+    const encodeUs = traceUs(p.trace.encodeUs);
+    if (alarmUs !== null) addLatency(d, "acquireToAlarm", alarmUs / 1000);
+    if (queueUs !== null) addLatency(d, "alarmToQueue", queueUs / 1000);
+    if (encodeUs !== null) addLatency(d, "queueToSerialize", encodeUs / 1000);
+    if (atMs && alarmUs !== null && queueUs !== null && encodeUs !== null) {
+      addLatency(d, "acquireToReceive", receivedAt - atMs + (alarmUs + queueUs + encodeUs) / 1000);
+    }
+  }
+}
+
+// Percentile nearest-rank su valori ordinati.
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.max(0, Math.ceil((p / 100) * sorted.length) - 1))];
+}
+
+function summarizeLatency(d) {
+  const round = (v) => Math.round(v * 1000) / 1000;
+  const segments = {};
+  for (const name of LATENCY_SEGMENTS) {
+    const sorted = [...d.segments[name].values].sort((a, c) => a - c);
+    segments[name] = sorted.length
+      ? {
+          count: sorted.length,
+          p50: round(percentile(sorted, 50)),
+          p90: round(percentile(sorted, 90)),
+          p99: round(percentile(sorted, 99)),
+          max: round(sorted[sorted.length - 1])
+        }
+      : { count: 0 };
+  }
+  return { deviceId: d.deviceId, updatedAt: d.updatedAt, window: LATENCY_WINDOW, unit: "ms", segments };
+}
+
+function normalizePoint(b, deviceId, receivedAt) {
+  return {
+    deviceId: String(deviceId || "unknown"),
+    ts: Number(b.ts || Math.floor(receivedAt / 1000)), // fallback
     t: toFiniteOrNull(b.t),
     rh: toFiniteOrNull(b.rh),
     dhtOk: Boolean(b.dhtOk ?? true),
@@ -124,16 +318,111 @@ app.post("/api/v1/telemetry", (req, res) => {
     mq7Calibrated: Boolean(b.mq7Calibrated ?? false),
     mq7WarmupDone: Boolean(b.mq7WarmupDone ?? false),
     mq7Level: Number.isFinite(Number(b.mq7Level)) ? Number(b.mq7Level) : 0,
-    receivedAt: Date.now()
+    receivedAt
   };
+}
+
+// history resta ordinata per ts: i punti recuperati dopo un'interruzione
+// vengono inseriti al loro posto. Duplicati (stesso device + ts) ignorati,
+// cosi un batch ritrasmesso dopo un ack perso non raddoppia i dati.
+function insertPoint(point) {
+  let i = history.length;
+  while (i > 0 && history[i - 1].ts > point.ts) i--;
+
+  for (let j = i - 1; j >= 0 && history[j].ts === point.ts; j--) {
+    if (history[j].deviceId === point.deviceId) return false;
+  }
+
+  history.splice(i, 0, point);
+  if (!latest || point.ts >= latest.ts) latest = point;
+  return true;
+}
 
-  latest = point;
-  history.push(point);
+// Accept-Post annuncia i formati accettati: il firmware passa al binario se lo trova.
+app.post("/api/v1/telemetry", (req, res) => {
+  res.set("Accept-Post", ACCEPT_POST);
+  let body;
+  try {
+    body = readTelemetryBody(req);
+  } catch (err) {
+    res.status(400).json({ ok: false, error: err.message });
+    return;
+  }
+
+  const receivedAt = req.receivedAt;
+  for (const p of body.points) insertPoint(normalizePoint(p || {}, body.deviceId, receivedAt));
   pruneHistory();
+  recordLatency(body, receivedAt);
 
   res.status(200).json({ ok: true });
 });
 
+// Batch: { deviceId, points: [ {ts, t, rh, ...}, ... ] } oppure binario.
+// Risponde con accepted = numero di punti presi in carico (ack per il device).
+app.post("/api/v1/telemetry/batch", (req, res) => {
+  res.set("Accept-Post", ACCEPT_POST);
+  let body;
+  try {
+    body = readTelemetryBody(req);
+  } catch (err) {
+    res.status(400).json({ ok: false, error: err.message });
+    return;
+  }
+  if (!Array.isArray(req.body?.points) && !Buffer.isBuffer(req.body)) {
+    res.status(400).json({ ok: false, error: "points must be an array" });
+    return;
+  }
+
+  const receivedAt = req.receivedAt;
+  const points = body.points
+    .map((p) => normalizePoint(p || {}, body.deviceId, receivedAt))
+    .sort((a, c) => a.ts - c.ts);
+
+  let inserted = 0;
+  for (const p of points) {
+    if (insertPoint(p)) inserted++;
+  }
+  pruneHistory();
+  recordLatency(body, receivedAt);
+
+  res.status(200).json({ ok: true, accepted: body.points.length, inserted });
+});
+
+// Metriche runtime del firmware (latenze per stadio, heap), ogni METRICS_PERIOD_MS.
+// Si tiene solo l'ultimo snapshot per device.
+const metricsByDevice = new Map();
+
+app.post("/api/v1/telemetry/metrics", (req, res) => {
+  const b = req.body;
+  if (!b || typeof b !== "object" || Buffer.isBuffer(b) || !Array.isArray(b.stages)) {
+    res.status(400).json({ ok: false, error: "stages must be an array" });
+    return;
+  }
+  const deviceId = String(b.deviceId || "unknown");
+  metricsByDevice.set(deviceId, { ...b, deviceId, receivedAt: Date.now() });
+  res.status(200).json({ ok: true });
+});
+
+// /api/v1/metrics oppure /api/v1/metrics?deviceId=esp32-1
+app.get("/api/v1/metrics", (req, res) => {
+  if (req.query.deviceId) {
+    res.json(metricsByDevice.get(String(req.query.deviceId)) ?? { ok: false });
+    return;
+  }
+  res.json({ devices: [...metricsByDevice.values()] });
+});
+
+// /api/v1/latency oppure /api/v1/latency?deviceId=esp32-1
+// Percentili per segmento, dall'acquisizione sul device alla ricezione qui.
+app.get("/api/v1/latency", (req, res) => {
+  if (req.query.deviceId) {
+    const d = latencyByDevice.get(String(req.query.deviceId));
+    res.json(d ? summarizeLatency(d) : { ok: false });
+    return;
+  }
+  res.json({ devices: [...latencyByDevice.values()].map(summarizeLatency) });
+});
+
 app.get("/api/v1/latest", (req, res) => {
   res.json(latest ?? { ok: false });
 });
@@ -141,8 +430,8 @@ app.get("/api/v1/latest", (req, res) => {
 // /api/v1/history?minutes=30
 app.get("/api/v1/history", (req, res) => {
   const minutes = Math.max(1, Math.min(12 * 60, Number(req.query.minutes || 30)));
-  const sinceMs = Date.now() - minutes * 60 * 1000;
-  const out = history.filter(p => p.receivedAt >= sinceMs);
+  const sinceTs = Math.floor(Date.now() / 1000) - minutes * 60;
+  const out = history.filter(p => p.ts >= sinceTs);
   res.json({ minutes, count: out.length, points: out });
 });
 
@@ -0,0 +1,72 @@
+#include "app/alarm.h"
+#include "config.h"
+#include "util/log.h"
+
+static constexpr int BUZZER_PWM_CHANNEL = 1;
+
+const char* alarmLevelText(AlarmLevel level) {
+  switch (level) {
+    case AlarmLevel::DANGER: return "DANGER";
+    case AlarmLevel::WARN: return "WARN";
+    case AlarmLevel::OK: return "OK";
+    default: return "UNKNOWN";
+  }
+}
+
+// Pattern come dati: durata di ogni passo dal timer, non dalla cadenza di chi chiama update().
+static constexpr PatternStep WARN_STEPS[] = {
+    {BUZZER_WARN_FREQ_HZ, BUZZER_WARN_ON_MS},
+    {0, BUZZER_WARN_PERIOD_MS - BUZZER_WARN_ON_MS},
+};
+static constexpr PatternStep DANGER_STEPS[] = {
+    {BUZZER_DANGER_FREQ_HZ, BUZZER_DANGER_ON_MS},
+    {0, BUZZER_DANGER_OFF_MS},
+};
+static constexpr PatternStep SELF_TEST_STEPS[] = {{BUZZER_WARN_FREQ_HZ, 500}};
+
+static constexpr Pattern WARN_PATTERN = {WARN_STEPS, 2, 0};
+static constexpr Pattern DANGER_PATTERN = {DANGER_STEPS, 2, 0};
+static constexpr Pattern SELF_TEST_PATTERN = {SELF_TEST_STEPS, 1, 1};
+
+void AlarmOutput::begin() {
+  if (BUZZER_USE_TONE) {
+    hal::toneBegin(PIN_BUZZER, BUZZER_PWM_CHANNEL, BUZZER_WARN_FREQ_HZ);
+  } else {
+    hal::gpioOutput(PIN_BUZZER);
+  }
+  hal::gpioOutput(PIN_ALARM_LED);
+  if (BUZZER_USE_TONE) awake_ = hal::awakeCreate("buzzer");
+  output_(this, 0);
+  if (!player_.begin(&AlarmOutput::output_, this)) LOGE(ALARM, "Alarm: pattern timer failed");
+}
+
+void AlarmOutput::selfTest() { play_(&SELF_TEST_PATTERN); }
+
+void AlarmOutput::play_(const Pattern* p) {
+  if (!player_.play(p)) LOGW(ALARM, "Alarm: pattern timer not armed");
+}
+
+// Un passo del pattern su buzzer e LED (contesto del timer).
+void AlarmOutput::output_(void* ctx, uint16_t freqHz) {
+  const bool on = freqHz > 0;
+  hal::gpioWrite(PIN_ALARM_LED, ALARM_LED_ACTIVE_HIGH ? on : !on);
+
+  if (BUZZER_USE_TONE) {
+    // il PWM LEDC si ferma in light sleep: sveglio solo mentre suona
+    hal::awakeHold(static_cast<AlarmOutput*>(ctx)->awake_, on);
+    hal::toneWrite(BUZZER_PWM_CHANNEL, freqHz);
+    return;
+  }
+
+  bool out = BUZZER_ACTIVE_HIGH ? on : !on;
+  hal::gpioWrite(PIN_BUZZER, out);
+}
+
+void AlarmOutput::update(uint32_t nowMs, AlarmLevel level) {
+  (void)nowMs;
+  if (level == level_) return;
+  level_ = level;
+  if (level_ == AlarmLevel::DANGER) play_(&DANGER_PATTERN);
+  else if (level_ == AlarmLevel::WARN) play_(&WARN_PATTERN);
+  else play_(nullptr);
+}
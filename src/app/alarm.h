@@ -0,0 +1,27 @@
+#pragma once
+#include "hal/hal.h"
+#include "app/pattern_player.h"
+
+enum class AlarmLevel : uint8_t { UNKNOWN = 0, OK = 1, WARN = 2, DANGER = 3 };
+
+const char* alarmLevelText(AlarmLevel level);
+
+// Buzzer + LED di allarme con i pattern WARN/DANGER (BUZZER_* in config.h),
+// temporizzati da PatternPlayer: update() cambia solo pattern.
+class AlarmOutput {
+public:
+  void begin();
+  // Beep di 500 ms; non blocca.
+  void selfTest();
+  void update(uint32_t nowMs, AlarmLevel level);
+  AlarmLevel level() const { return level_; }
+  const PatternStats& patternStats() const { return player_.stats(); }
+
+private:
+  static void output_(void* ctx, uint16_t freqHz);
+  void play_(const Pattern* p);
+
+  AlarmLevel level_ = AlarmLevel::UNKNOWN;
+  PatternPlayer player_;
+  hal::AwakeHandle awake_ = nullptr;
+};
@@ -0,0 +1,192 @@
+#include "app/alarm_rules.h"
+
+// Colonne: tipo, livello, segnale, enter, exit, enterMs, exitMs, finestra, a, b.
+// L'isteresi separa le soglie d'ingresso e d'uscita, il dwell filtra il rumore
+// che resta: un ratio che balla intorno a 0.85 non fa più lampeggiare WARN.
+static const AlarmRuleSpec DEFAULT_RULES[] = {
+    {RuleKind::BELOW, AlarmLevel::WARN, AlarmSignal::MQ7_RATIO, MQ7_RATIO_WARN_LT,
+     MQ7_RATIO_WARN_LT + ALARM_RATIO_HYST, ALARM_ENTER_MS, ALARM_EXIT_MS, 0, 0, 0},
+    {RuleKind::BELOW, AlarmLevel::DANGER, AlarmSignal::MQ7_RATIO, MQ7_RATIO_DANGER_LT,
+     MQ7_RATIO_DANGER_LT + ALARM_RATIO_HYST, ALARM_ENTER_MS, ALARM_EXIT_MS, 0, 0, 0},
+    // CO in salita rapida: WARN prima di arrivare alla soglia
+    {RuleKind::SLOPE_BELOW, AlarmLevel::WARN, AlarmSignal::MQ7_RATIO, ALARM_SLOPE_WARN_PER_MIN,
+     ALARM_SLOPE_WARN_PER_MIN / 3, ALARM_ENTER_MS, ALARM_EXIT_MS, ALARM_SLOPE_WINDOW_MS, 0, 0},
+    {RuleKind::ABOVE, AlarmLevel::UNKNOWN, AlarmSignal::TEMP_C, ALARM_HEAT_TEMP_C, ALARM_HEAT_TEMP_C - 2.0f,
+     ALARM_ENTER_MS, ALARM_EXIT_MS, 0, 0, 0},
+    // caldo + CO da WARN: gli ingressi hanno già il loro dwell
+    {RuleKind::ALL, AlarmLevel::DANGER, AlarmSignal::MQ7_RATIO, 0, 0, 0, 0, 0, 3, 0},
+};
+
+static const AlarmRuleSet DEFAULT_SET = {DEFAULT_RULES, sizeof(DEFAULT_RULES) / sizeof(DEFAULT_RULES[0]),
+                                         AlarmSignal::MQ7_RATIO};
+
+const AlarmRuleSet& defaultAlarmRules() { return DEFAULT_SET; }
+
+bool AlarmEngine::fail_(const char* why) {
+  count_ = 0;
+  slopeCount_ = 0;
+  error_ = why;
+  return false;
+}
+
+bool AlarmEngine::compile(const AlarmRuleSet& set) {
+  count_ = 0;
+  slopeCount_ = 0;
+  error_ = nullptr;
+  if (set.count > MAX_RULES) return fail_("too many rules");
+  if (set.required >= AlarmSignal::COUNT) return fail_("bad required signal");
+  required_ = (uint8_t)set.required;
+
+  for (uint8_t i = 0; i < set.count; i++) {
+    const AlarmRuleSpec& s = set.rules[i];
+    Rule& r = rules_[i];
+    r.kind = s.kind;
+    r.level = (uint8_t)s.level;
+    r.signal = (uint8_t)s.signal;
+    r.a = s.a;
+    r.b = s.b;
+    r.enter = s.enter;
+    r.exit = s.exit;
+    r.enterMs = s.enterMs;
+    r.exitMs = s.exitMs;
+    if (s.signal >= AlarmSignal::COUNT || s.level > AlarmLevel::DANGER) return fail_("bad signal/level");
+
+    switch (s.kind) {
+    case RuleKind::BELOW:
+    case RuleKind::SLOPE_BELOW:
+      if (!(s.exit >= s.enter)) return fail_("exit below enter");
+      break;
+    case RuleKind::ABOVE:
+    case RuleKind::SLOPE_ABOVE:
+      if (!(s.exit <= s.enter)) return fail_("exit above enter");
+      break;
+    case RuleKind::ALL:
+      // solo regole già valutate in questo giro: niente cicli
+      if (s.a >= i || s.b >= i) return fail_("ALL must reference earlier rules");
+      continue;
+    default:
+      return fail_("bad rule kind");
+    }
+    if (s.kind != RuleKind::SLOPE_BELOW && s.kind != RuleKind::SLOPE_ABOVE) continue;
+
+    // un ring per coppia (segnale, finestra), condiviso fra le regole
+    if (s.windowMs < SLOPE_POINTS) return fail_("slope window too short");
+    uint8_t k = 0;
+    while (k < slopeCount_ && !(slopes_[k].signal == r.signal && slopes_[k].windowMs == s.windowMs)) k++;
+    if (k == slopeCount_) {
+      if (slopeCount_ >= MAX_SLOPES) return fail_("too many slope windows");
+      Slope& sl = slopes_[slopeCount_++];
+      sl.signal = r.signal;
+      sl.windowMs = s.windowMs;
+      sl.stepMs = s.windowMs / (SLOPE_POINTS - 1);
+      sl.head = 0;
+    }
+    r.a = k;
+  }
+  count_ = set.count;
+  reset();
+  return true;
+}
+
+void AlarmEngine::reset() {
+  for (uint8_t i = 0; i < count_; i++) state_[i] = State{false, false, 0};
+  for (uint8_t k = 0; k < slopeCount_; k++) slopes_[k].n = 0;
+}
+
+void AlarmEngine::sample_(Slope& s, uint32_t nowMs, float v) {
+  if (!isfinite(v)) {
+    s.n = 0;
+    return;
+  }
+  if (s.n > 0 && (int32_t)(nowMs - s.nextMs) < 0) return;
+  s.head = (uint8_t)((s.head + 1) % SLOPE_POINTS);
+  s.v[s.head] = v;
+  s.t[s.head] = nowMs;
+  if (s.n < SLOPE_POINTS) s.n++;
+  s.nextMs = nowMs + s.stepMs;
+}
+
+// Dal punto più vecchio al più recente; NAN finché il ring non copre mezza finestra.
+float AlarmEngine::slopePerMin_(const Slope& s) {
+  if (s.n < 2) return NAN;
+  const uint8_t oldest = (uint8_t)((s.head + SLOPE_POINTS + 1 - s.n) % SLOPE_POINTS);
+  const uint32_t span = s.t[s.head] - s.t[oldest];
+  if (span < s.windowMs / 2) return NAN;
+  return (s.v[s.head] - s.v[oldest]) * 60000.0f / (float)span;
+}
+
+bool AlarmEngine::cond_(const Rule& r, const State& st, const AlarmInputs& in) const {
+  float v;
+  switch (r.kind) {
+  case RuleKind::ALL:
+    return state_[r.a].active && state_[r.b].active;
+  case RuleKind::SLOPE_BELOW:
+  case RuleKind::SLOPE_ABOVE:
+    v = slopePerMin_(slopes_[r.a]);
+    break;
+  default:
+    v = in.v[r.signal];
+    break;
+  }
+  if (!isfinite(v)) return false;
+  const bool below = r.kind == RuleKind::BELOW || r.kind == RuleKind::SLOPE_BELOW;
+  // isteresi: attiva sotto enter, resta attiva finché non supera exit
+  if (below) return st.cond ? v < r.exit : v < r.enter;
+  return st.cond ? v > r.exit : v > r.enter;
+}
+
+AlarmLevel AlarmEngine::evaluate(uint32_t nowMs, const AlarmInputs& in) {
+  AlarmLevel level = AlarmLevel::UNKNOWN;
+  if (!isfinite(in.v[required_])) {
+    // niente dato di base (warmup, calibrazione): si riparte da zero
+    reset();
+  } else {
+    for (uint8_t k = 0; k < slopeCount_; k++) sample_(slopes_[k], nowMs, in.v[slopes_[k].signal]);
+
+    uint8_t top = (uint8_t)AlarmLevel::OK;
+    for (uint8_t i = 0; i < count_; i++) {
+      const Rule& r = rules_[i];
+      State& st = state_[i];
+      const bool c = cond_(r, st, in);
+      if (c != st.cond) {
+        st.cond = c;
+        st.sinceMs = nowMs;
+      }
+      const uint32_t held = nowMs - st.sinceMs;
+      if (c && !st.active && held >= r.enterMs) st.active = true;
+      if (!c && st.active && held >= r.exitMs) st.active = false;
+      if (st.active && r.level > top) top = r.level;
+    }
+    level = (AlarmLevel)top;
+  }
+  if (level != last_) {
+    last_ = level;
+    changes_++;
+  }
+  return level;
+}
+
+uint32_t AlarmEngine::activeMask() const {
+  uint32_t mask = 0;
+  for (uint8_t i = 0; i < count_; i++) {
+    if (state_[i].active) mask |= 1u << i;
+  }
+  return mask;
+}
+
+uint32_t AlarmEngine::pendingMask() const {
+  uint32_t mask = 0;
+  for (uint8_t i = 0; i < count_; i++) {
+    if (state_[i].cond != state_[i].active) mask |= 1u << i;
+  }
+  return mask;
+}
+
+void AlarmEngine::printStats(Print& out) const {
+  if (error_) {
+    out.printf("alarm rules: invalid (%s)\n", error_);
+    return;
+  }
+  out.printf("alarm rules: n=%u slopes=%u active=0x%04x changes=%u level=%s\n", (unsigned)count_,
+             (unsigned)slopeCount_, (unsigned)activeMask(), (unsigned)changes_, alarmLevelText(last_));
+}
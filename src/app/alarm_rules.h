@@ -0,0 +1,131 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "config.h"
+#include "app/alarm.h"
+
+// Soglie delle regole di default (config.h può ridefinirle).
+#ifndef ALARM_RATIO_HYST
+#define ALARM_RATIO_HYST 0.03f // isteresi sul ratio: si esce da un livello solo sopra soglia + HYST
+#endif
+#ifndef ALARM_ENTER_MS
+#define ALARM_ENTER_MS 2000 // la condizione deve durare tanto prima di alzare il livello
+#endif
+#ifndef ALARM_EXIT_MS
+#define ALARM_EXIT_MS 10000 // ... e restare falsa tanto prima di abbassarlo
+#endif
+#ifndef ALARM_SLOPE_WINDOW_MS
+#define ALARM_SLOPE_WINDOW_MS 20000
+#endif
+#ifndef ALARM_SLOPE_WARN_PER_MIN
+#define ALARM_SLOPE_WARN_PER_MIN -0.15f // ratio che scende più in fretta di così (al minuto) -> WARN
+#endif
+#ifndef ALARM_HEAT_TEMP_C
+#define ALARM_HEAT_TEMP_C 50.0f // sopra questa T un CO da WARN diventa DANGER (incendio)
+#endif
+
+// Ingressi delle regole, uno per grandezza; NAN = non disponibile.
+enum class AlarmSignal : uint8_t { MQ7_RATIO = 0, MQ7_PPM, TEMP_C, RH, COUNT };
+
+struct AlarmInputs {
+  float v[(size_t)AlarmSignal::COUNT];
+  AlarmInputs() {
+    for (float& x : v) x = NAN;
+  }
+  float& operator[](AlarmSignal s) { return v[(size_t)s]; }
+  float operator[](AlarmSignal s) const { return v[(size_t)s]; }
+};
+
+enum class RuleKind : uint8_t {
+  BELOW,       // valore < enter, rilascio sopra exit (exit >= enter)
+  ABOVE,       // valore > enter, rilascio sotto exit (exit <= enter)
+  SLOPE_BELOW, // pendenza al minuto su windowMs < enter, rilascio sopra exit
+  SLOPE_ABOVE, // pendenza al minuto su windowMs > enter, rilascio sotto exit
+  ALL,         // regole a e b entrambe attive (indici di regole precedenti)
+};
+
+// Regola dichiarativa. level = UNKNOWN: solo condizione, usata dalle ALL.
+struct AlarmRuleSpec {
+  RuleKind kind;
+  AlarmLevel level;
+  AlarmSignal signal;
+  float enter;
+  float exit;
+  uint32_t enterMs; // dwell prima di attivarsi
+  uint32_t exitMs;  // dwell prima di rilasciarsi
+  uint32_t windowMs;
+  uint8_t a;
+  uint8_t b;
+};
+
+struct AlarmRuleSet {
+  const AlarmRuleSpec* rules;
+  uint8_t count;
+  AlarmSignal required; // se manca (NAN) il livello è UNKNOWN
+};
+
+// Regole di default: soglie MQ7_RATIO_* con isteresi, discesa rapida del
+// ratio e CO + temperatura alta.
+const AlarmRuleSet& defaultAlarmRules();
+
+// Valuta le regole in modo incrementale, un campione per volta: ogni regola
+// tiene il suo stato (condizione, attiva, da quando), le pendenze hanno un
+// piccolo ring per segnale e finestra. compile() valida le regole e le porta
+// una volta sola in una tabella fissa; evaluate() non alloca.
+class AlarmEngine {
+public:
+  static constexpr size_t MAX_RULES = 16;
+  static constexpr size_t MAX_SLOPES = 4;
+  static constexpr size_t SLOPE_POINTS = 16;
+
+  // false (e nessuna regola) se la tabella non è valida; error() dice perché.
+  bool compile(const AlarmRuleSet& set);
+  AlarmLevel evaluate(uint32_t nowMs, const AlarmInputs& in);
+  void reset();
+
+  const char* error() const { return error_; }
+  size_t ruleCount() const { return count_; }
+  uint32_t activeMask() const; // bit i = regola i attiva
+  uint32_t pendingMask() const; // bit i = regola i in attesa del dwell (entrata o uscita)
+  void printStats(Print& out) const;
+
+private:
+  struct Rule {
+    RuleKind kind;
+    uint8_t level;
+    uint8_t signal;
+    uint8_t a, b; // ALL: regole; SLOPE_*: a = ring
+    float enter, exit;
+    uint32_t enterMs, exitMs;
+  };
+  struct State {
+    bool cond;
+    bool active;
+    uint32_t sinceMs;
+  };
+  struct Slope {
+    uint8_t signal;
+    uint32_t windowMs;
+    uint32_t stepMs;
+    uint32_t nextMs;
+    uint8_t head, n;
+    float v[SLOPE_POINTS];
+    uint32_t t[SLOPE_POINTS];
+  };
+
+  bool fail_(const char* why);
+  bool cond_(const Rule& r, const State& st, const AlarmInputs& in) const;
+  void sample_(Slope& s, uint32_t nowMs, float v);
+  static float slopePerMin_(const Slope& s);
+
+  Rule rules_[MAX_RULES];
+  State state_[MAX_RULES];
+  Slope slopes_[MAX_SLOPES];
+  uint8_t count_ = 0;
+  uint8_t slopeCount_ = 0;
+  uint8_t required_ = 0;
+  uint32_t changes_ = 0; // cambi di livello restituiti da evaluate()
+  AlarmLevel last_ = AlarmLevel::UNKNOWN;
+  const char* error_ = nullptr;
+};
@@ -0,0 +1,217 @@
+#include "app/duty_cycle.h"
+#include "app/alarm_rules.h"
+#include "app/readings.h"
+#include "app/scheduler.h"
+#include "config.h"
+#include "net/telemetry_client.h"
+#include "net/wifi_manager.h"
+#include "storage/bin_logger.h"
+#include "time/time_sync.h"
+#include "util/log.h"
+
+#include <WiFi.h>
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <new>
+#include <type_traits>
+
+namespace duty {
+
+static constexpr uint32_t RTC_MAGIC = 0x33545544; // "DUT3": layout di RtcState (clockMs a 64 bit, rejected)
+static constexpr uint32_t MIN_SLEEP_MS = 100;
+static constexpr uint32_t NTP_WAIT_MS = 2000;
+
+// Prima lettura MQ-7 dopo sensors.begin(): la finestra ADC parte subito o,
+// con l'ADC sempre acceso, il primo drain utile è dopo un periodo intero.
+static constexpr uint32_t MQ7_FIRST_SAMPLE_MS = MQ7_ADC_BURST_MS > 0 ? Mq7Sensor::FIRST_SAMPLE_MS : MQ7_PERIOD_MS;
+static_assert(!BoardSensors::has<Mq7Sensor>() || MQ7_FIRST_SAMPLE_MS < DEEP_SLEEP_SAMPLE_TIMEOUT_MS,
+              "DEEP_SLEEP_SAMPLE_TIMEOUT_MS troppo corto: l'MQ-7 non darebbe mai una lettura");
+
+// Stato che sopravvive al deep sleep (memoria RTC lenta). Solo tipi banali:
+// un costruttore globale girerebbe a ogni risveglio e lo azzererebbe, per
+// questo il motore d'allarme vive in byte grezzi, costruito al boot a freddo.
+struct RtcState {
+  uint32_t magic;
+  uint32_t cycles;
+  uint64_t clockMs; // ms dal boot a freddo, svegli + addormentati: a 32 bit tornerebbe a 0 dopo 49,7 giorni
+  uint32_t nextSendCycle; // dopo un invio fallito si aspetta un altro batch
+  uint8_t lastLevel;
+  uint16_t head;
+  uint16_t count;
+  uint32_t lost; // campioni persi a coda piena
+  uint32_t rejected; // campioni scartati perché il server li rifiuta
+  uint32_t sends;
+  uint32_t sendFails;
+  uint64_t awakeMs;
+  uint64_t wifiMs;
+  uint64_t sleepMs;
+  alignas(AlarmEngine) uint8_t engine[sizeof(AlarmEngine)];
+  envlog::Record queue[DEEP_SLEEP_BUFFER];
+};
+
+static_assert(std::is_trivially_default_constructible<RtcState>::value, "RtcState: no constructors in RTC memory");
+RTC_DATA_ATTR static RtcState rtc;
+
+static AlarmEngine& engine() { return *reinterpret_cast<AlarmEngine*>(rtc.engine); }
+
+static void coldStart() {
+  memset(&rtc, 0, sizeof(rtc));
+  AlarmEngine* e = new (rtc.engine) AlarmEngine();
+  if (!e->compile(defaultAlarmRules())) LOGE(ALARM, "Alarm rules: %s", e->error());
+  rtc.magic = RTC_MAGIC;
+}
+
+static void enqueue(const AppReadings& r, uint32_t unixTs, uint32_t clockMs) {
+  if (rtc.count == DEEP_SLEEP_BUFFER) { // il più vecchio lascia il posto
+    rtc.head = (rtc.head + 1) % DEEP_SLEEP_BUFFER;
+    rtc.count--;
+    rtc.lost++;
+  }
+  rtc.queue[(rtc.head + rtc.count) % DEEP_SLEEP_BUFFER] = toLogRecord(r, unixTs, clockMs);
+  rtc.count++;
+}
+
+// Una lettura da ogni sensore (o timeout), dormendo fra le scadenze dei sensori.
+static void sample(BoardSensors& sensors) {
+  const uint32_t t0 = millis();
+  auto done = [&]() {
+    bool ok = true;
+    if constexpr (BoardSensors::has<DhtSensor>()) ok = ok && sensors.sensor<DhtSensor>().get().ok;
+    if constexpr (BoardSensors::has<Mq7Sensor>()) ok = ok && sensors.sensor<Mq7Sensor>().get().raw > 0;
+    return ok;
+  };
+  while (!done() && millis() - t0 < DEEP_SLEEP_SAMPLE_TIMEOUT_MS) {
+    const uint32_t now = millis();
+    sensors.update(now);
+    sched::Deadline next(now, DEEP_SLEEP_SAMPLE_TIMEOUT_MS);
+    sensors.forEachDeadline([&](uint32_t ms) { next.at(ms); });
+    delay(next.waitMs() > 0 ? next.waitMs() : 1);
+  }
+}
+
+// WiFi su, coda al server a batch (ts mancanti ricostruiti dall'orologio RTC), WiFi giù.
+static bool flush(uint32_t clockNowMs) {
+  const uint32_t t0 = millis();
+  net::wifiBegin(); // BSSID e canale dal risveglio precedente: niente scansione
+  while (!net::wifiIsConnected() && millis() - t0 < DEEP_SLEEP_WIFI_TIMEOUT_MS) {
+    net::wifiEnsureConnected(millis()); // AP in cache non raggiungibile: scansione
+    delay(20);
+  }
+  if (net::wifiIsConnected()) net::wifiEnsureConnected(millis()); // statistiche e AP in cache
+
+  bool ok = net::wifiIsConnected();
+  if (ok && !timeutil::isTimeValid()) { // l'ora poi resta valida anche in deep sleep
+    timeutil::beginNtp();
+    const uint32_t ntp0 = millis();
+    while (!timeutil::isTimeValid() && millis() - ntp0 < NTP_WAIT_MS) delay(20);
+  }
+
+  const uint32_t unixNow = timeutil::unixTime();
+  net::TelemetryPayload items[TELEMETRY_BATCH_MAX];
+  size_t batchMax = TELEMETRY_BATCH_MAX; // 1 dopo un rifiuto: si scarta solo il campione colpevole
+  while (ok && rtc.count > 0) {
+    const size_t n = rtc.count < batchMax ? rtc.count : batchMax;
+    for (size_t i = 0; i < n; i++) {
+      const envlog::Record& rec = rtc.queue[(rtc.head + i) % DEEP_SLEEP_BUFFER];
+      items[i].readings = fromLogRecord(rec);
+      items[i].ts = rec.ts;
+      if (rec.ts == 0 && unixNow != 0) items[i].ts = unixNow - (clockNowMs + (millis() - t0) - rec.millis) / 1000;
+    }
+    size_t accepted = 0;
+    const net::BatchResult br = net::postTelemetryBatch(items, n, accepted);
+    if (br == net::BatchResult::REJECTED && n > 1) {
+      batchMax = 1;
+      continue;
+    }
+    if (br == net::BatchResult::REJECTED) { // rimandarlo non serve: fuori dal buffer RTC
+      accepted = 1;
+      rtc.rejected++;
+    }
+    ok = br != net::BatchResult::RETRY;
+    rtc.head = (rtc.head + accepted) % DEEP_SLEEP_BUFFER;
+    rtc.count -= accepted;
+  }
+
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  rtc.wifiMs += millis() - t0;
+  return ok;
+}
+
+void run(BoardSensors& sensors, AlarmOutput& alarm) {
+  const bool woke = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && rtc.magic == RTC_MAGIC;
+  if (!woke) coldStart();
+  const uint64_t wifiBefore = rtc.wifiMs;
+
+  alarm.begin();
+  if (!woke) {
+    alarm.selfTest(); // il beep solo al boot a freddo
+    LOGI(SYS, "Deep sleep mode: period %u ms, WiFi every %u samples", (unsigned)DEEP_SLEEP_PERIOD_MS,
+         (unsigned)DEEP_SLEEP_BATCH);
+  }
+
+  sensors.begin();
+  if constexpr (BoardSensors::has<Mq7Sensor>()) {
+    const uint64_t heated = rtc.clockMs < MQ7_WARMUP_MS ? rtc.clockMs : MQ7_WARMUP_MS; // saturato, niente troncamento
+    sensors.sensor<Mq7Sensor>().setWarmupElapsed((uint32_t)heated);
+  }
+  sample(sensors);
+
+  // regole e record lavorano a 32 bit con differenze sicure al wrap
+  const uint32_t clockNow = (uint32_t)(rtc.clockMs + millis());
+  const auto readings = sensors.get();
+  AlarmEngine& rules = engine();
+  const AlarmLevel level = rules.evaluate(clockNow, alarmInputs(readings));
+  const bool inAlarm = level >= AlarmLevel::WARN;
+  const bool wasAlarm = rtc.lastLevel >= (uint8_t)AlarmLevel::WARN;
+  const bool changed = (uint8_t)level != rtc.lastLevel && (inAlarm || wasAlarm);
+  rtc.lastLevel = (uint8_t)level;
+  rtc.cycles++;
+
+  enqueue(makeReadings(readings, level), timeutil::unixTime(), clockNow);
+  const uint32_t beepStart = millis();
+  if (inAlarm) alarm.update(beepStart, level);
+
+  // allarme che sale o rientra: subito; altrimenti a batch pieno
+  const bool batch = rtc.count >= DEEP_SLEEP_BATCH && rtc.cycles >= rtc.nextSendCycle;
+  if (changed || batch) {
+    if (flush(clockNow)) {
+      rtc.sends++;
+    } else {
+      rtc.sendFails++;
+      rtc.nextSendCycle = rtc.cycles + DEEP_SLEEP_BATCH;
+      LOGW(NET, "Deep sleep: send failed, %u samples queued", (unsigned)rtc.count);
+    }
+  }
+
+  if (inAlarm) {
+    while (millis() - beepStart < DEEP_SLEEP_ALARM_BEEP_MS) delay(10);
+    alarm.update(millis(), AlarmLevel::OK); // buzzer e LED spenti prima del deep sleep
+  }
+
+  const uint32_t period = inAlarm || rules.pendingMask() ? DEEP_SLEEP_ALARM_MS : DEEP_SLEEP_PERIOD_MS;
+  const uint32_t awake = millis();
+  const uint32_t sleepMs = period > awake + MIN_SLEEP_MS ? period - awake : MIN_SLEEP_MS;
+  const uint32_t wifi = (uint32_t)(rtc.wifiMs - wifiBefore);
+  rtc.awakeMs += awake;
+  rtc.sleepMs += sleepMs;
+
+  // consumo medio stimato sul ciclo e dal boot a freddo
+  const float cycleMa = ((awake - wifi) * DEEP_SLEEP_ACTIVE_MA + wifi * DEEP_SLEEP_WIFI_MA +
+                         sleepMs * (DEEP_SLEEP_IDLE_UA / 1000.0f)) / (awake + sleepMs);
+  const double totalMs = (double)(rtc.awakeMs + rtc.sleepMs);
+  const double avgMa = ((rtc.awakeMs - rtc.wifiMs) * DEEP_SLEEP_ACTIVE_MA + rtc.wifiMs * DEEP_SLEEP_WIFI_MA +
+                        rtc.sleepMs * (DEEP_SLEEP_IDLE_UA / 1000.0)) / totalMs;
+  LOGI(SYS,
+       "duty: cycle %u level %s awake %u ms (wifi %u) sleep %u ms, %.2f mA (avg %.3f mA) queued %u lost %u rejected %u",
+       (unsigned)rtc.cycles, alarmLevelText(level), (unsigned)awake, (unsigned)wifi, (unsigned)sleepMs, cycleMa,
+       avgMa, (unsigned)rtc.count, (unsigned)rtc.lost, (unsigned)rtc.rejected);
+
+  rtc.clockMs += millis() + sleepMs;
+  logging::flush();
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000u);
+  esp_deep_sleep_start();
+}
+
+} // namespace duty
@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include "sensors/board_sensors.h"
+#include "app/alarm.h"
+
+#ifndef POWER_DEEP_SLEEP
+#define POWER_DEEP_SLEEP 0 // 1 = modo a batteria: un campione per risveglio, poi deep sleep (niente pipeline)
+#endif
+#ifndef DEEP_SLEEP_PERIOD_MS
+#define DEEP_SLEEP_PERIOD_MS 60000 // da un risveglio al successivo
+#endif
+#ifndef DEEP_SLEEP_BATCH
+#define DEEP_SLEEP_BATCH 10 // campioni per connessione WiFi
+#endif
+#ifndef DEEP_SLEEP_BUFFER
+#define DEEP_SLEEP_BUFFER 64 // campioni in memoria RTC (32 B l'uno); pieno = si perde il più vecchio
+#endif
+#ifndef DEEP_SLEEP_ALARM_MS
+#define DEEP_SLEEP_ALARM_MS 5000 // periodo con allarme attivo o regola in attesa del dwell
+#endif
+#ifndef DEEP_SLEEP_ALARM_BEEP_MS
+#define DEEP_SLEEP_ALARM_BEEP_MS 400 // pattern d'allarme suonato a ogni risveglio in allarme
+#endif
+#ifndef DEEP_SLEEP_SAMPLE_TIMEOUT_MS
+#define DEEP_SLEEP_SAMPLE_TIMEOUT_MS 3000 // tempo massimo per avere una lettura da ogni sensore
+#endif
+#ifndef DEEP_SLEEP_WIFI_TIMEOUT_MS
+#define DEEP_SLEEP_WIFI_TIMEOUT_MS 10000 // associazione + DHCP
+#endif
+// Correnti della board per la stima del consumo medio (misurale e ridefiniscile).
+#ifndef DEEP_SLEEP_ACTIVE_MA
+#define DEEP_SLEEP_ACTIVE_MA 40.0f // CPU sveglia, radio spenta
+#endif
+#ifndef DEEP_SLEEP_WIFI_MA
+#define DEEP_SLEEP_WIFI_MA 120.0f // radio accesa (media su associazione + POST)
+#endif
+#ifndef DEEP_SLEEP_IDLE_UA
+#define DEEP_SLEEP_IDLE_UA 150.0f // deep sleep, sensori alimentati
+#endif
+
+// Modo a duty cycle per le unità a batteria: al posto della pipeline, ogni
+// risveglio legge i sensori, valuta l'allarme, accoda la lettura in memoria
+// RTC e torna in deep sleep. Il WiFi si accende solo ogni DEEP_SLEEP_BATCH
+// campioni, o subito se il livello d'allarme sale o rientra. Stato d'allarme
+// (dwell, pendenze), coda e un orologio in ms sopravvivono al deep sleep.
+// L'heater del MQ-7 resta alimentato: il warmup conta dal primo boot.
+namespace duty {
+
+// Un ciclo completo; non ritorna (al risveglio si riparte da setup()).
+[[noreturn]] void run(BoardSensors& sensors, AlarmOutput& alarm);
+
+} // namespace duty
@@ -0,0 +1,61 @@
+#include "app/pattern_player.h"
+
+bool PatternPlayer::begin(OutputFn out, void* ctx) {
+  out_ = out;
+  ctx_ = ctx;
+  if (!timer_) timer_ = hal::timerCreate(&PatternPlayer::tick_, this, "pattern");
+  return timer_ != nullptr;
+}
+
+// play() e step_() riarmano lo stesso timer da task diversi. Se il riarmo di
+// step_() arriva dopo quello di play(), step_() ricontrolla hasPending_ e
+// anticipa di nuovo il timer: il cambio non aspetta la fine del passo.
+bool PatternPlayer::play(const Pattern* p) {
+  pending_.store(p, std::memory_order_relaxed);
+  hasPending_.store(true);
+  return timer_ && hal::timerStartOnce(timer_, 0);
+}
+
+void PatternPlayer::tick_(void* arg) { static_cast<PatternPlayer*>(arg)->step_(); }
+
+void PatternPlayer::step_() {
+  const uint32_t now = hal::micros();
+  if (hasPending_.exchange(false)) {
+    cur_ = pending_.load(std::memory_order_relaxed);
+    index_ = 0;
+    loops_ = 0;
+    dueUs_ = now;
+    if (!cur_ || cur_->count == 0) {
+      cur_ = nullptr;
+      out_(ctx_, 0);
+      return;
+    }
+  }
+  if (!cur_) return;
+
+  const uint32_t late = now - dueUs_;
+  stats_.lastLateUs = late;
+  if (late > stats_.maxLateUs) stats_.maxLateUs = late;
+
+  if (index_ >= cur_->count) {
+    index_ = 0;
+    if (cur_->repeat && ++loops_ >= cur_->repeat) {
+      cur_ = nullptr;
+      out_(ctx_, 0);
+      return;
+    }
+  }
+
+  const PatternStep& s = cur_->steps[index_++];
+  out_(ctx_, s.freqHz);
+  stats_.steps++;
+  dueUs_ += (uint32_t)s.ms * 1000u;
+  const int32_t wait = (int32_t)(dueUs_ - hal::micros());
+  if (!hal::timerStartOnce(timer_, wait > 0 ? (uint32_t)wait : 0)) {
+    stats_.timerErrors++;
+    cur_ = nullptr;
+    out_(ctx_, 0); // meglio il silenzio di un tono bloccato
+    return;
+  }
+  if (hasPending_.load()) hal::timerStartOnce(timer_, 0);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include "hal/hal.h"
+
+// Un passo di pattern: frequenza del buzzer per ms millisecondi (0 = silenzio,
+// LED spento). Buzzer e LED seguono lo stesso passo.
+struct PatternStep {
+  uint16_t freqHz;
+  uint16_t ms;
+};
+
+// Sequenza di passi ripetuta repeat volte (0 = finché non la si sostituisce).
+struct Pattern {
+  const PatternStep* steps;
+  uint8_t count;
+  uint8_t repeat;
+};
+
+struct PatternStats {
+  uint32_t steps = 0;
+  uint32_t lastLateUs = 0; // ritardo del passo rispetto alla scadenza
+  uint32_t maxLateUs = 0;
+  uint32_t timerErrors = 0; // riarmo fallito: pattern interrotto in silenzio
+};
+
+// Esegue i pattern da un timer one-shot (hal::timerStartOnce), non dal loop
+// né dal task dell'allarme: la durata di ogni passo dipende solo dal timer.
+// Le scadenze sono assolute (somma delle durate), il ritardo di un passo non
+// si accumula sui successivi.
+class PatternPlayer {
+public:
+  // out(ctx, freqHz) applica un passo; gira nel contesto del timer.
+  using OutputFn = void (*)(void* ctx, uint16_t freqHz);
+
+  bool begin(OutputFn out, void* ctx);
+  // Sostituisce il pattern in corso dal passo 0 (nullptr = silenzio).
+  // Non blocca: il cambio lo applica il timer. false se il timer non parte.
+  bool play(const Pattern* p);
+  const PatternStats& stats() const { return stats_; }
+
+private:
+  static void tick_(void* arg);
+  void step_();
+
+  OutputFn out_ = nullptr;
+  void* ctx_ = nullptr;
+  hal::TimerHandle timer_ = nullptr;
+  std::atomic<const Pattern*> pending_{nullptr};
+  std::atomic<bool> hasPending_{false};
+
+  // solo nel contesto del timer
+  const Pattern* cur_ = nullptr;
+  uint8_t index_ = 0;
+  uint8_t loops_ = 0;
+  uint32_t dueUs_ = 0;
+  PatternStats stats_;
+};
@@ -0,0 +1,541 @@
+#include "app/pipeline.h"
+#include "app/readings.h"
+#include "app/scheduler.h"
+#include "config.h"
+#include "util/seqlock.h"
+#include "util/log.h"
+#include "net/wifi_manager.h"
+#include "net/telemetry_client.h"
+#include "net/telemetry_queue.h"
+#include "net/telemetry_sender.h"
+#include "net/local_api.h"
+#include "time/time_sync.h"
+
+#include <ArduinoJson.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace pipeline {
+
+// Core 1: sensori + allarme (priorità alte). Core 0: insieme allo stack WiFi.
+static constexpr BaseType_t CORE_FAST = 1;
+static constexpr BaseType_t CORE_IO = 0;
+
+// Budget di un giro per stadio (overrun oltre). I task non hanno più un tick
+// fisso: dormono fino alla prima scadenza dei loro componenti (sched::Task).
+static constexpr uint32_t SENSOR_BUDGET_MS = 50;
+static constexpr uint32_t ALARM_BUDGET_MS = 20;
+static constexpr uint32_t STORAGE_BUDGET_MS = 250;
+static constexpr uint32_t DISPLAY_BUDGET_MS = 250;
+static constexpr uint32_t NETWORK_BUDGET_MS = 250;
+static constexpr uint32_t SEND_POLL_MS = 50; // esito di un invio in corso
+
+// Invio a batch: si parte con SEND_BATCH_MIN letture in coda o quando la più
+// vecchia aspetta da SEND_MAX_LATENCY_MS (sotto il timeout offline della dashboard).
+static constexpr size_t SEND_BATCH_MIN = 3;
+static constexpr uint32_t SEND_MAX_LATENCY_MS = 10000;
+static constexpr uint32_t SEND_BACKOFF_MIN_MS = 1000;
+static constexpr uint32_t SEND_BACKOFF_MAX_MS = 60000;
+
+static Components comp{};
+static SeqLock<SensorSnapshot> sensorSnap;
+static SeqLock<AppReadings> readingsSnap;
+static StageStats stats[STAGE_COUNT];
+static StageStats alarmLat;
+static DeliveryStats deliveryLat; // acquisizione -> ack del server, per lettura
+static sched::Task sensorSched("sensor");
+static sched::Task alarmSched("alarm");
+static sched::Task storageSched("storage");
+static sched::Task displaySched("display");
+static sched::Task networkSched("network");
+static net::TelemetryQueue telemetryQueue;
+static net::TelemetrySender sender;
+static History hist;
+static AlarmEngine alarmRules; // solo il task allarme la valuta
+
+static std::atomic<uint8_t> calibRequest{0}; // 0 nessuna, >0 campioni richiesti
+static std::atomic<bool> resetRequest{false};
+static std::atomic<int8_t> calibResult{-1};
+static std::atomic<uint32_t> telemetryRejected{0}; // letture scartate perché il server (o l'encoder) le rifiuta
+static std::atomic<bool> storageReady{false}; // SD pronta (o assente) e coda di telemetria caricata
+
+// Tappe del boot in millis() (0 = non ancora).
+static std::atomic<uint32_t> bootSampleMs{0};
+static std::atomic<uint32_t> bootSentMs{0};
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {"sensor",  "dht",     "mq7",      "alarm", "storage",
+                                                      "display", "oled_i2c", "wifi", "telemetry"};
+
+// Stadio in cui misurare l'update di ciascun sensore.
+static Stage sensorStage(const DhtSensor&) { return STAGE_DHT; }
+static Stage sensorStage(const Mq7Sensor&) { return STAGE_MQ7; }
+
+// La calibrazione prosegue dentro update(): qui solo avvio ed esito.
+static void calibCommands(BoardSensors& sensors, bool& calibrating) {
+  if constexpr (BoardSensors::has<Mq7Sensor>()) {
+    Mq7Sensor& mq7 = sensors.sensor<Mq7Sensor>();
+    const uint8_t samples = calibRequest.exchange(0);
+    if (samples > 0) {
+      calibrating = mq7.startCalibration(samples);
+      if (!calibrating) calibResult.store(0);
+    }
+    if (resetRequest.exchange(false)) mq7.resetCalibration();
+  } else {
+    if (calibRequest.exchange(0) > 0) calibResult.store(0);
+    resetRequest.store(false);
+    (void)sensors;
+    (void)calibrating;
+  }
+}
+
+static void calibOutcome(const BoardSensors& sensors, bool& calibrating) {
+  if constexpr (BoardSensors::has<Mq7Sensor>()) {
+    const Mq7CalibState cs = sensors.sensor<Mq7Sensor>().calibState();
+    if (calibrating && cs != Mq7CalibState::COLLECTING) {
+      calibrating = false;
+      calibResult.store(cs == Mq7CalibState::DONE ? 1 : 0); // IDLE = annullata da reset
+    }
+  } else {
+    (void)sensors;
+    (void)calibrating;
+  }
+}
+
+static void sensorTask(void*) {
+  bool calibrating = false;
+  BoardSensors& sensors = *comp.sensors;
+  sensorSched.attach();
+  for (;;) {
+    const uint32_t t0 = micros();
+    const uint32_t now = millis();
+
+    calibCommands(sensors, calibrating);
+    sensors.forEach([now](auto& sensor) {
+      const uint32_t t = micros();
+      sensor.update(now);
+      stats[sensorStage(sensor)].record(micros() - t);
+    });
+    calibOutcome(sensors, calibrating);
+
+    SensorSnapshot s;
+    s.sensors = sensors.get();
+    s.atUs = hal::monoUs();
+    sensorSnap.write(s);
+    alarmSched.notify();
+
+    stats[STAGE_SENSOR].record(micros() - t0);
+
+    sched::Deadline next(millis());
+    sensors.forEachDeadline([&next](uint32_t ms) { next.at(ms); });
+    sensorSched.sleep(next); // notificato anche dai comandi di calibrazione
+  }
+}
+
+static void alarmTaskFn(void*) {
+  uint32_t seenVersion = 0;
+  alarmSched.attach();
+  for (;;) {
+    alarmSched.sleep(sched::Deadline(millis())); // notifica del task sensori; i pattern hanno il loro timer
+    const uint32_t t0 = micros();
+
+    SensorSnapshot s;
+    const uint32_t version = sensorSnap.read(s);
+    const uint32_t now = millis();
+    const AlarmLevel level = alarmRules.evaluate(now, alarmInputs(s.sensors));
+    comp.alarm->update(now, level);
+
+    if (version != seenVersion) {
+      const bool first = seenVersion == 0;
+      seenVersion = version;
+
+      AppReadings readings = makeReadings(s.sensors, level);
+      readings.alarmUs = hal::monoUs();
+      readingsSnap.write(readings);
+
+      alarmLat.record((uint32_t)(hal::monoUs() - s.atUs));
+      if (bootSampleMs.load() == 0 && (readings.dhtOk || readings.mq7Ok)) {
+        bootSampleMs.store(now);
+        LOGI(SYS, "Boot: first valid sample at %u ms", (unsigned)now);
+      }
+      if (first) { // chi aspettava la prima lettura non attende la sua rete di sicurezza
+        storageSched.notify();
+        displaySched.notify();
+        networkSched.notify();
+      }
+    }
+
+    stats[STAGE_ALARM].record(micros() - t0);
+  }
+}
+
+static void storageTask(void*) {
+  // SD (con i clock SPI di ripiego) qui, in parallelo al resto del boot
+  const bool sdOk = comp.sd->begin();
+  LOGI(STORAGE, "SD logger: %s", sdOk ? "OK" : "FAIL");
+  BinLogger* binlog = comp.binlog && sdOk && comp.binlog->begin() ? comp.binlog : nullptr;
+  telemetryQueue.begin(sdOk);
+  storageReady.store(true);
+  networkSched.notify();
+
+  storageSched.attach();
+  for (;;) {
+    if (readingsSnap.version() == 0) {
+      storageSched.sleep(sched::Deadline(millis()));
+      continue;
+    }
+    const uint32_t t0 = micros();
+
+    AppReadings r;
+    readingsSnap.read(r);
+    const uint32_t now = millis();
+    const uint32_t ts = timeutil::unixAt(r.atUs); // istante di acquisizione, non di scrittura
+    hist.add(now, ts, r);
+    comp.sd->update(now, r, ts);
+    if (binlog) binlog->update(now, r, ts);
+
+    stats[STAGE_STORAGE].record(micros() - t0);
+
+    sched::Deadline next(millis());
+    if (hist.isReady()) next.at(hist.nextDeadlineMs());
+    if (comp.sd->isReady()) next.at(comp.sd->nextDeadlineMs());
+    if (binlog && binlog->isReady()) next.at(binlog->nextDeadlineMs());
+    storageSched.sleep(next);
+  }
+}
+
+static void displayTask(void*) {
+  if (!comp.oled->begin()) { // display assente: niente task
+    LOGW(DISPLAY, "OLED not found, display off");
+    vTaskDelete(nullptr);
+  }
+  displaySched.attach();
+  for (;;) {
+    if (readingsSnap.version() == 0) {
+      displaySched.sleep(sched::Deadline(millis()));
+      continue;
+    }
+    const uint32_t t0 = micros();
+
+    AppReadings r;
+    readingsSnap.read(r);
+    if (comp.oled->update(OledView::from(r))) stats[STAGE_OLED_I2C].record(comp.oled->stats().lastPushUs);
+
+    stats[STAGE_DISPLAY].record(micros() - t0);
+
+    sched::Deadline next(millis());
+    next.at(comp.oled->nextDeadlineMs());
+    displaySched.sleep(next);
+  }
+}
+
+// Scadenza già passata -> adesso. Una scadenza ferma (WiFi giù, coda vuota)
+// dopo 24,8 giorni sembrerebbe futura con le differenze a 32 bit e
+// bloccherebbe invii e metriche per altrettanto; il task gira almeno ogni
+// SCHED_MAX_SLEEP_MS, quindi restano sempre vicine a now.
+static void catchUp(uint32_t& deadlineMs, uint32_t nowMs) {
+  if ((int32_t)(nowMs - deadlineMs) > 0) deadlineMs = nowMs;
+}
+
+static void networkTask(void*) {
+  static net::TelemetryPayload batch[TELEMETRY_BATCH_MAX];
+  static char metricsJson[METRICS_JSON_MAX];
+  uint32_t nextEnqueueMs = millis();
+  uint32_t nextAttemptMs = millis();
+  uint32_t nextMetricsMs = millis() + METRICS_PERIOD_MS;
+  uint32_t backoffMs = SEND_BACKOFF_MIN_MS;
+  // Letture di un batch rifiutato ancora da rimandare una alla volta: così
+  // si scarta solo quella che il server non accetta, non le altre del batch.
+  size_t isolateLeft = 0;
+
+  networkSched.attach();
+  // la coda di telemetria può riprendere dalla SD: si aspetta il task storage
+  while (!storageReady.load()) networkSched.sleep(sched::Deadline(millis()));
+  for (;;) {
+    const uint32_t t0 = micros();
+    const uint32_t now = millis();
+    catchUp(nextEnqueueMs, now);
+    catchUp(nextAttemptMs, now);
+    catchUp(nextMetricsMs, now);
+    net::wifiEnsureConnected(now);
+    if (LOCAL_API_ENABLED && !net::localApiRunning() && net::wifiIsConnected() && net::localApiBegin()) {
+      LOGI(NET, "Local API: http://%s:%u/api/v1/latest", net::wifiIp().c_str(), (unsigned)LOCAL_API_PORT);
+    }
+    const uint32_t t1 = micros();
+    stats[STAGE_WIFI].record(t1 - t0);
+
+    // Ogni lettura passa dalla coda: se la rete è giù resta lì (RAM, poi SD).
+    if ((int32_t)(now - nextEnqueueMs) >= 0 && readingsSnap.version() != 0) {
+      nextEnqueueMs = now + SEND_PERIOD_MS;
+      const AppReadings r = latestReadings();
+      telemetryQueue.push({r, timeutil::unixAt(r.atUs), hal::monoUs()}); // ts 0 prima di NTP: lo risolve peek()
+    }
+
+    // Esito dell'invio in corso (non bloccante): ack o backoff.
+    net::SendResult res;
+    if (sender.poll(res) && !res.metrics) { // metriche: best effort, nessun retry
+      telemetryQueue.ack(res.accepted);
+      for (size_t i = 0; i < res.accepted; i++) { // batch[] è ancora quello inviato
+        const net::TelemetryPayload& p = batch[i];
+        if (p.queuedUs == 0 || p.readings.atUs == 0 || res.doneUs <= p.readings.atUs) continue;
+        const uint64_t ms = (res.doneUs - p.readings.atUs) / 1000u;
+        deliveryLat.record(ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms);
+      }
+      if (res.ok && res.accepted > 0 && bootSentMs.load() == 0) {
+        bootSentMs.store(now);
+        LOGI(NET, "Boot: first telemetry sent at %u ms", (unsigned)now);
+      }
+      size_t settled = res.accepted;
+      if (res.rejected && res.submitted > 1) {
+        isolateLeft = res.submitted;
+        LOGW(NET, "Telemetry batch rejected, resending its %u points one by one", (unsigned)res.submitted);
+      } else if (res.rejected) {
+        telemetryQueue.reject(1); // fuori dalla coda o la bloccherebbe per sempre
+        settled = 1;
+        LOGW(NET, "Telemetry point rejected, dropped (%u so far)", (unsigned)(telemetryRejected.fetch_add(1) + 1));
+      }
+      isolateLeft -= settled < isolateLeft ? settled : isolateLeft;
+
+      if (res.ok || res.rejected) { // rifiuto: niente backoff, non è la rete
+        backoffMs = SEND_BACKOFF_MIN_MS;
+        nextAttemptMs = now;
+      } else {
+        LOGW(NET, "Telemetry batch failed, retry in %u ms (%u queued)", (unsigned)backoffMs,
+             (unsigned)telemetryQueue.size());
+        nextAttemptMs = now + backoffMs;
+        backoffMs = backoffMs * 2 > SEND_BACKOFF_MAX_MS ? SEND_BACKOFF_MAX_MS : backoffMs * 2;
+      }
+    }
+
+    const bool canSend = !sender.busy() && net::wifiIsConnected();
+    const bool batchDue = !telemetryQueue.empty() && (int32_t)(now - nextAttemptMs) >= 0 &&
+                          (telemetryQueue.size() >= SEND_BATCH_MIN ||
+                           (now - telemetryQueue.oldestEnqueuedMs()) >= SEND_MAX_LATENCY_MS);
+    if (canSend && batchDue) {
+      size_t n = telemetryQueue.peek(batch, isolateLeft > 0 ? 1 : TELEMETRY_BATCH_MAX);
+      sender.submit(batch, n);
+    } else if (canSend && METRICS_PERIOD_MS > 0 && (int32_t)(now - nextMetricsMs) >= 0) {
+      nextMetricsMs = now + METRICS_PERIOD_MS;
+      size_t len = encodeMetricsJson(metricsJson, sizeof(metricsJson));
+      if (len > 0) sender.submitMetrics(metricsJson, len);
+    }
+
+    stats[STAGE_TELEMETRY].record(micros() - t1);
+
+    // Scadenze: riconnessione, prossima lettura da accodare, esito dell'invio
+    // in corso, batch (backoff, batch pieno o latenza massima), metriche.
+    sched::Deadline next(millis());
+    const bool connected = net::wifiIsConnected();
+    if (!connected) next.at(net::wifiNextTryMs());
+    if (readingsSnap.version() != 0) next.at(nextEnqueueMs);
+    if (sender.busy()) {
+      next.in(SEND_POLL_MS);
+    } else if (connected && !telemetryQueue.empty()) {
+      uint32_t due = telemetryQueue.size() >= SEND_BATCH_MIN
+                         ? nextAttemptMs
+                         : telemetryQueue.oldestEnqueuedMs() + SEND_MAX_LATENCY_MS;
+      if ((int32_t)(nextAttemptMs - due) > 0) due = nextAttemptMs;
+      next.at(due);
+    }
+    if (connected && METRICS_PERIOD_MS > 0) next.at(nextMetricsMs);
+    networkSched.sleep(next);
+  }
+}
+
+void begin(const Components& c) {
+  comp = c;
+  // Budget = cadenza del task: oltre, lo stadio ha saltato almeno un giro.
+  stats[STAGE_SENSOR].budgetUs = SENSOR_BUDGET_MS * 1000;
+  stats[STAGE_DHT].budgetUs = SENSOR_BUDGET_MS * 1000;
+  stats[STAGE_MQ7].budgetUs = SENSOR_BUDGET_MS * 1000;
+  stats[STAGE_ALARM].budgetUs = ALARM_BUDGET_MS * 1000;
+  stats[STAGE_STORAGE].budgetUs = STORAGE_BUDGET_MS * 1000;
+  stats[STAGE_DISPLAY].budgetUs = DISPLAY_BUDGET_MS * 1000;
+  stats[STAGE_OLED_I2C].budgetUs = DISPLAY_BUDGET_MS * 1000;
+  stats[STAGE_WIFI].budgetUs = NETWORK_BUDGET_MS * 1000;
+  stats[STAGE_TELEMETRY].budgetUs = NETWORK_BUDGET_MS * 1000;
+  alarmLat.budgetUs = ALARM_BUDGET_MS * 1000;
+  deliveryLat.budgetMs = SEND_MAX_LATENCY_MS + TELEMETRY_REQUEST_BUDGET_MS;
+
+  if (!alarmRules.compile(defaultAlarmRules())) LOGE(ALARM, "Alarm rules: %s", alarmRules.error());
+  if (!hist.begin()) LOGW(SYS, "History: allocation failed, disabled");
+  sender.begin();
+  net::wifiOnConnected([] { networkSched.notify(); });
+  sched::beginPower();
+  xTaskCreatePinnedToCore(alarmTaskFn, "alarm", 3072, nullptr, 5, nullptr, CORE_FAST);
+  xTaskCreatePinnedToCore(sensorTask, "sensor", 4096, nullptr, 4, nullptr, CORE_FAST);
+  xTaskCreatePinnedToCore(displayTask, "display", 3072, nullptr, 2, nullptr, CORE_IO);
+  xTaskCreatePinnedToCore(storageTask, "storage", 4096, nullptr, 1, nullptr, CORE_IO);
+  xTaskCreatePinnedToCore(networkTask, "network", 4096, nullptr, 1, nullptr, CORE_IO);
+}
+
+SensorSnapshot latestSensors() {
+  SensorSnapshot s;
+  sensorSnap.read(s);
+  return s;
+}
+
+AppReadings latestReadings() {
+  AppReadings r;
+  readingsSnap.read(r);
+  return r;
+}
+
+bool hasReadings() { return readingsSnap.version() != 0; }
+
+void requestCalibration(uint8_t samples) {
+  calibResult.store(-1);
+  calibRequest.store(samples ? samples : 1);
+  sensorSched.notify();
+}
+
+void requestCalibrationReset() {
+  resetRequest.store(true);
+  sensorSched.notify();
+}
+
+int8_t takeCalibrationResult() {
+  return calibResult.exchange(-1);
+}
+
+const StageStats& stageStats(Stage s) { return stats[s]; }
+const StageStats& alarmLatency() { return alarmLat; }
+const DeliveryStats& deliveryLatency() { return deliveryLat; }
+const char* stageName(Stage s) { return s < STAGE_COUNT ? STAGE_NAMES[s] : "?"; }
+
+void printStats(Print& out) {
+  out.println("stage      runs      last_us   avg_us    p95_us    max_us   overruns");
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    const StageStats& st = stats[i];
+    out.printf("%-9s %9u %9u %9u %9u %9u %9u\n", STAGE_NAMES[i], st.count.load(), st.lastUs.load(), st.avgUs(),
+               st.percentileUs(95), st.maxUs.load(), st.overruns.load());
+  }
+  out.printf("%-9s %9u %9u %9u %9u %9u %9u\n", "sens->alm", alarmLat.count.load(), alarmLat.lastUs.load(),
+             alarmLat.avgUs(), alarmLat.percentileUs(95), alarmLat.maxUs.load(), alarmLat.overruns.load());
+  out.printf("acq->ack: n=%u last=%ums avg=%ums p95=%ums max=%ums over=%u\n", deliveryLat.count.load(),
+             deliveryLat.lastMs.load(), deliveryLat.avgMs(), deliveryLat.percentileMs(95), deliveryLat.maxMs.load(),
+             deliveryLat.overruns.load());
+  out.printf("telemetry: rejected=%u\n", (unsigned)telemetryRejected.load());
+  out.printf("boot: wifi=%ums sample=%ums telemetry=%ums\n", (unsigned)net::wifiStats().firstUpMs,
+             (unsigned)bootSampleMs.load(), (unsigned)bootSentMs.load());
+  net::printWifiStats(out);
+  timeutil::printStats(out);
+  net::printConnectionStats(out);
+  net::printLocalApiStats(out);
+  if constexpr (BoardSensors::has<DhtSensor>()) comp.sensors->sensor<DhtSensor>().printStats(out);
+  if (comp.sd) comp.sd->printStats(out);
+  if (comp.alarm) {
+    const PatternStats& ps = comp.alarm->patternStats();
+    out.printf("pattern: steps=%u late=%uus max=%uus timer_err=%u\n", (unsigned)ps.steps, (unsigned)ps.lastLateUs,
+               (unsigned)ps.maxLateUs, (unsigned)ps.timerErrors);
+  }
+  alarmRules.printStats(out);
+  sched::printStats(out);
+  if (comp.oled) comp.oled->printStats(out);
+  hist.printStats(out);
+  logging::printStats(out);
+}
+
+static void printHistRow(Print& out, const char* name, const StageStats& st) {
+  out.printf("%-9s", name);
+  for (uint8_t b = 0; b < STAGE_HIST_BUCKETS; b++) out.printf(" %6u", st.hist[b].load());
+  out.printf("  p50=%u p99=%u over=%u/%ums\n", st.percentileUs(50), st.percentileUs(99), st.overruns.load(),
+             st.budgetUs / 1000);
+}
+
+template <size_t N>
+static void printHistHeader(Print& out, const char* label, const uint32_t (&edges)[N], const char* unit) {
+  out.printf("%-9s", label);
+  for (size_t b = 0; b < N; b++) out.printf(" %6u", edges[b]);
+  out.printf("   more (%s, upper bound)\n", unit);
+}
+
+void printMetrics(Print& out) {
+  const hal::HeapInfo heap = hal::heapInfo();
+  out.printf("heap free=%u largest=%u min=%u uptime=%lus\n", heap.freeBytes, heap.largestBlock, heap.minFreeBytes,
+             (unsigned long)(millis() / 1000));
+  printHistHeader(out, "latency", STAGE_HIST_EDGES_US, "us");
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) printHistRow(out, STAGE_NAMES[i], stats[i]);
+  printHistRow(out, "sens->alm", alarmLat);
+  printHistRow(out, "http", net::localApiStats());
+  printHistHeader(out, "delivery", DELIVERY_HIST_EDGES_MS, "ms");
+  out.printf("%-9s", "acq->ack");
+  for (uint8_t b = 0; b < DELIVERY_HIST_BUCKETS; b++) out.printf(" %6u", deliveryLat.hist[b].load());
+  out.printf("  p50=%u p99=%u over=%u/%ums\n", deliveryLat.percentileMs(50), deliveryLat.percentileMs(99),
+             deliveryLat.overruns.load(), deliveryLat.budgetMs);
+}
+
+static void addStage(JsonObject o, const StageStats& st) {
+  o["count"] = st.count.load();
+  o["avgUs"] = st.avgUs();
+  o["p95Us"] = st.percentileUs(95);
+  o["maxUs"] = st.maxUs.load();
+  o["overruns"] = st.overruns.load();
+  o["budgetUs"] = st.budgetUs;
+  JsonArray hist = o["hist"].to<JsonArray>();
+  for (uint8_t b = 0; b < STAGE_HIST_BUCKETS; b++) hist.add(st.hist[b].load());
+}
+
+static void addDelivery(JsonObject o, const DeliveryStats& st) {
+  o["count"] = st.count.load();
+  o["avgMs"] = st.avgMs();
+  o["p95Ms"] = st.percentileMs(95);
+  o["maxMs"] = st.maxMs.load();
+  o["overruns"] = st.overruns.load();
+  o["budgetMs"] = st.budgetMs;
+  JsonArray edges = o["histEdgesMs"].to<JsonArray>();
+  for (uint32_t e : DELIVERY_HIST_EDGES_MS) edges.add(e);
+  JsonArray hist = o["hist"].to<JsonArray>();
+  for (uint8_t b = 0; b < DELIVERY_HIST_BUCKETS; b++) hist.add(st.hist[b].load());
+}
+
+size_t encodeMetricsJson(char* out, size_t cap) {
+  const hal::HeapInfo heap = hal::heapInfo();
+  JsonDocument doc;
+  doc["deviceId"] = DEVICE_ID;
+  doc["ts"] = timeutil::unixTime();
+  doc["uptimeMs"] = millis();
+  JsonObject h = doc["heap"].to<JsonObject>();
+  h["free"] = heap.freeBytes;
+  h["largest"] = heap.largestBlock;
+  h["minFree"] = heap.minFreeBytes;
+  doc["telemetryRejected"] = telemetryRejected.load();
+  JsonArray edges = doc["histEdgesUs"].to<JsonArray>();
+  for (uint8_t b = 0; b + 1 < STAGE_HIST_BUCKETS; b++) edges.add(STAGE_HIST_EDGES_US[b]);
+  JsonArray stages = doc["stages"].to<JsonArray>();
+  auto stage = [&stages](const char* name, const StageStats& st) {
+    JsonObject o = stages.add<JsonObject>();
+    o["name"] = name;
+    addStage(o, st);
+  };
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) stage(STAGE_NAMES[i], stats[i]);
+  stage("alarm_latency", alarmLat);
+  stage("http", net::localApiStats());
+  addDelivery(doc["deliveryLatencyMs"].to<JsonObject>(), deliveryLat);
+
+  if (measureJson(doc) >= cap) return 0;
+  return serializeJson(doc, out, cap);
+}
+
+const History& history() { return hist; }
+
+static void printRollup(Print& out, const HistRollup& r, uint32_t agoMin) {
+  out.printf("-%5um n=%4u T %5.1f/%5.1f/%5.1f  RH %3.0f/%3.0f/%3.0f  ratio %.2f/%.2f/%.2f  ppm %.0f/%.0f/%.0f\n",
+             (unsigned)agoMin, (unsigned)r.samples, r.tC.min(), r.tC.mean(), r.tC.max(), r.rh.min(), r.rh.mean(),
+             r.rh.max(), r.ratio.min(), r.ratio.mean(), r.ratio.max(), r.ppm.min(), r.ppm.mean(), r.ppm.max());
+}
+
+void printHistory(Print& out) {
+  static constexpr size_t SHOW = 10;
+  HistRollup rows[SHOW];
+  const uint32_t now = millis();
+  hist.printStats(out);
+  out.println("minutes (min/mean/max, oldest first)");
+  size_t n = hist.copyMinutes(rows, SHOW, now - SHOW * History::MINUTE_MS);
+  for (size_t i = 0; i < n; i++) printRollup(out, rows[i], (now - rows[i].startMs) / History::MINUTE_MS);
+  out.println("hours");
+  n = hist.copyHours(rows, SHOW, now - SHOW * History::HOUR_MS);
+  for (size_t i = 0; i < n; i++) printRollup(out, rows[i], (now - rows[i].startMs) / History::MINUTE_MS);
+}
+
+} // namespace pipeline
@@ -0,0 +1,80 @@
+#pragma once
+#include <Arduino.h>
+#include "app/app_state.h"
+#include "app/stage_stats.h"
+#include "sensors/board_sensors.h"
+#include "display/oled_display.h"
+#include "source/sd_logger.h"
+#include "storage/bin_logger.h"
+#include "storage/history.h"
+#include "app/alarm.h"
+
+#ifndef METRICS_PERIOD_MS
+#define METRICS_PERIOD_MS 60000 // invio metriche runtime al server (0 = mai)
+#endif
+
+// Pipeline a task: sensori -> allarme -> (storage, display, rete).
+// Gli stadi si scambiano l'ultima lettura tramite snapshot seqlock, così
+// uno stadio lento (rete, SD) non può ritardare il percorso dell'allarme.
+namespace pipeline {
+
+// Stadi misurati: task interi (sensor, alarm, storage, display, telemetry)
+// e passi interni che possono mangiarsi il budget (update di ogni sensore,
+// oled_i2c, wifi). Gli stadi dei sensori assenti dalla board restano a zero.
+enum Stage : uint8_t {
+  STAGE_SENSOR = 0,
+  STAGE_DHT,
+  STAGE_MQ7,
+  STAGE_ALARM,
+  STAGE_STORAGE,
+  STAGE_DISPLAY,
+  STAGE_OLED_I2C, // solo i frame che hanno inviato pagine
+  STAGE_WIFI,
+  STAGE_TELEMETRY,
+  STAGE_COUNT
+};
+
+struct SensorSnapshot {
+  BoardSensors::Readings sensors; // una lettura per sensore della board
+  uint64_t atUs = 0; // hal::monoUs() della pubblicazione
+};
+
+// oled, sd e binlog non ancora avviati: begin() lo fanno i task display e
+// storage, in parallelo al boot (display o SD assenti = stadio spento).
+struct Components {
+  BoardSensors* sensors;
+  OledDisplay* oled;
+  SdLogger* sd;
+  BinLogger* binlog; // opzionale (SD_LOG_BINARY)
+  AlarmOutput* alarm;
+};
+
+void begin(const Components& c);
+
+SensorSnapshot latestSensors();
+AppReadings latestReadings();
+bool hasReadings(); // false finché il task allarme non ha pubblicato la prima lettura
+
+// Comandi eseguiti dal task sensori (unico proprietario di Mq7Sensor);
+// ignorati se la board non ha l'MQ-7.
+void requestCalibration(uint8_t samples);
+void requestCalibrationReset();
+// -1 = nessun risultato pendente, 0 = fallita, 1 = ok
+int8_t takeCalibrationResult();
+
+const StageStats& stageStats(Stage s);
+const StageStats& alarmLatency(); // da pubblicazione sensori ad allarme applicato
+const DeliveryStats& deliveryLatency(); // da acquisizione ad ack del server, in ms
+const char* stageName(Stage s);
+void printStats(Print& out);
+// Istogrammi, percentili, overrun per stadio + heap (comando seriale 'm').
+void printMetrics(Print& out);
+// Stesse metriche in JSON per il server; 0 se out non basta.
+size_t encodeMetricsJson(char* out, size_t cap);
+
+// Storico on-device (alimentato dal task storage), leggibile da ogni task.
+const History& history();
+// Ultimi rollup per minuto e per ora (comando seriale 'h').
+void printHistory(Print& out);
+
+} // namespace pipeline
@@ -0,0 +1,41 @@
+#include "app/readings.h"
+#include "util/log.h"
+
+AppReadings makeReadings(const BoardSensors::Readings& sensors, AlarmLevel level) {
+  AppReadings readings;
+  BoardSensors::fill(sensors, readings);
+  readings.mq7Level = static_cast<uint8_t>(level);
+  return readings;
+}
+
+void addAlarmInputs(const DhtReading& dr, AlarmInputs& in) {
+  if (!dr.ok) return;
+  in[AlarmSignal::TEMP_C] = dr.tC;
+  in[AlarmSignal::RH] = dr.rh;
+}
+
+void addAlarmInputs(const Mq7Reading& mr, AlarmInputs& in) {
+  // ratio dopo la mediana: l'EMA aggiungerebbe secondi di ritardo; senza warmup o R0 non è un dato
+  if (!mr.warmupDone || !mr.calibrated) return;
+  in[AlarmSignal::MQ7_RATIO] = mr.ratioMedian;
+  if (mr.ok) in[AlarmSignal::MQ7_PPM] = mr.ppm;
+}
+
+void logStatus(const DhtReading& dr, AlarmLevel) {
+  if (dr.ok) {
+    LOGI(SENSOR, "DHT T=%.1fC RH=%.0f%%", dr.tC, dr.rh);
+  } else {
+    LOGI(SENSOR, "DHT fail (%s)", dhtproto::statusText(dr.status));
+  }
+}
+
+void logStatus(const Mq7Reading& mr, AlarmLevel level) {
+  if (mr.ok) {
+    LOGI(SENSOR, "MQ7 raw=%u vNode=%.3f Rs=%.0f R0=%.0f cal=%s warm=%s ratio=%.3f state=%s CO~%.0fppm",
+         mr.raw, mr.vNode, mr.rs, mr.r0, mr.calibrated ? "Y" : "N",
+         mr.warmupDone ? "Y" : "N", mr.ratio, alarmLevelText(level), mr.ppm);
+  } else {
+    LOGI(SENSOR, "MQ7 raw=%u vNode=%.3f R0=%.0f cal=%s warm=%s (warming/low signal)",
+         mr.raw, mr.vNode, mr.r0, mr.calibrated ? "Y" : "N", mr.warmupDone ? "Y" : "N");
+  }
+}
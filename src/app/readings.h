@@ -0,0 +1,35 @@
+#pragma once
+#include <tuple>
+#include "app/app_state.h"
+#include "app/alarm.h"
+#include "app/alarm_rules.h"
+#include "sensors/board_sensors.h"
+
+// Lettura applicativa dalle letture dei sensori della board + livello d'allarme.
+AppReadings makeReadings(const BoardSensors::Readings& sensors, AlarmLevel level);
+
+// Ingressi delle regole d'allarme dalle letture della board (overload per tipo).
+void addAlarmInputs(const DhtReading& dr, AlarmInputs& in);
+void addAlarmInputs(const Mq7Reading& mr, AlarmInputs& in);
+
+template <typename... R>
+AlarmInputs alarmInputs(const std::tuple<R...>& readings) {
+  AlarmInputs in;
+  (addAlarmInputs(std::get<R>(readings), in), ...);
+  (void)readings; // board senza sensori
+  return in;
+}
+
+// Stato di un sensore come record di log SENSOR (overload per tipo di lettura).
+void logStatus(const DhtReading& dr, AlarmLevel level);
+void logStatus(const Mq7Reading& mr, AlarmLevel level);
+
+// Stato periodico della console: una riga di log per sensore. Passa dal ring
+// del logger come il resto (niente printf sulla UART nel chiamante, rate
+// limit e modo binario compresi).
+template <typename... R>
+void logStatusLine(const std::tuple<R...>& readings, AlarmLevel level) {
+  (logStatus(std::get<R>(readings), level), ...);
+  (void)readings; // board senza sensori
+  (void)level;
+}
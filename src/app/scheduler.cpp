@@ -0,0 +1,76 @@
+#include "app/scheduler.h"
+#include "util/log.h"
+#include <sdkconfig.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+
+namespace sched {
+
+static constexpr uint8_t MAX_TASKS = 8;
+static std::atomic<Task*> tasks[MAX_TASKS];
+static std::atomic<uint8_t> taskCount{0};
+static const char* powerState = "off";
+
+void Task::attach() {
+  awakeSinceUs_ = micros();
+  handle_.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+  const uint8_t i = taskCount.fetch_add(1);
+  if (i < MAX_TASKS) tasks[i].store(this, std::memory_order_release);
+}
+
+bool Task::sleep(const Deadline& d) {
+  const uint32_t t0 = micros();
+  busyUs_.store(busyUs_.load(std::memory_order_relaxed) + (t0 - awakeSinceUs_), std::memory_order_relaxed);
+
+  // almeno un tick: una scadenza già passata non diventa un giro a vuoto
+  TickType_t ticks = pdMS_TO_TICKS(d.waitMs());
+  if (ticks == 0) ticks = 1;
+  const bool woken = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+
+  awakeSinceUs_ = micros();
+  idleUs_.store(idleUs_.load(std::memory_order_relaxed) + (awakeSinceUs_ - t0), std::memory_order_relaxed);
+  wakeups_.store(wakeups_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (woken) notified_.store(notified_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  return woken;
+}
+
+void Task::notify() {
+  TaskHandle_t h = handle_.load(std::memory_order_acquire);
+  if (h) xTaskNotifyGive(h);
+}
+
+void beginPower() {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = getCpuFrequencyMhz();
+  pm.min_freq_mhz = POWER_MIN_CPU_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  pm.light_sleep_enable = POWER_LIGHT_SLEEP;
+#endif
+  if (esp_pm_configure(&pm) == ESP_OK) {
+    powerState = pm.light_sleep_enable ? "dfs+light_sleep" : "dfs";
+  } else {
+    LOGW(SYS, "Power: esp_pm_configure failed");
+  }
+#else
+  LOGI(SYS, "Power: CONFIG_PM_ENABLE off, no DFS/light sleep (deadline wakeups only)");
+#endif
+}
+
+void printStats(Print& out) {
+  out.printf("sched: power=%s cpu=%uMHz\n", powerState, (unsigned)getCpuFrequencyMhz());
+  out.println("task       wakeups  notified   busy_ms    idle_ms  busy%");
+  const uint8_t n = taskCount.load() < MAX_TASKS ? taskCount.load() : MAX_TASKS;
+  for (uint8_t i = 0; i < n; i++) {
+    const Task* task = tasks[i].load(std::memory_order_acquire);
+    if (!task) continue; // attach() in corso
+    const Task& t = *task;
+    const uint64_t busy = t.busyUs();
+    const uint64_t total = busy + t.idleUs();
+    out.printf("%-9s %9u %9u %9u %9u %5.1f\n", t.name(), (unsigned)t.wakeups(), (unsigned)t.notified(),
+               (unsigned)(busy / 1000), (unsigned)(t.idleUs() / 1000), total ? 100.0 * busy / total : 0.0);
+  }
+}
+
+} // namespace sched
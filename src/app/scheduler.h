@@ -0,0 +1,76 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifndef SCHED_MAX_SLEEP_MS
+#define SCHED_MAX_SLEEP_MS 1000 // rete di sicurezza: nessun task dorme più di così
+#endif
+#ifndef POWER_LIGHT_SLEEP
+#define POWER_LIGHT_SLEEP 1 // light sleep automatico quando tutti i task dormono (serve CONFIG_PM_ENABLE)
+#endif
+#ifndef POWER_MIN_CPU_MHZ
+#define POWER_MIN_CPU_MHZ 80 // DFS: frequenza minima quando nessuno tiene un lock
+#endif
+
+// Scheduler a scadenze per i task della pipeline: ogni task raccoglie le
+// scadenze dei componenti che possiede (nextDeadlineMs()) e dorme fino alla
+// prima, o finché qualcuno lo notifica. Senza tick fissi, quando tutti
+// dormono FreeRTOS resta idle e con esp_pm entra in light sleep.
+namespace sched {
+
+// Prima fra più scadenze in ms (confronto con wrap di millis()), al più
+// nowMs + maxWaitMs.
+class Deadline {
+public:
+  Deadline(uint32_t nowMs, uint32_t maxWaitMs = SCHED_MAX_SLEEP_MS) : now_(nowMs), at_(nowMs + maxWaitMs) {}
+  void at(uint32_t ms) {
+    if ((int32_t)(ms - at_) < 0) at_ = ms;
+  }
+  void in(uint32_t ms) { at(now_ + ms); }
+  uint32_t waitMs() const {
+    const int32_t d = (int32_t)(at_ - now_);
+    return d > 0 ? (uint32_t)d : 0;
+  }
+
+private:
+  uint32_t now_;
+  uint32_t at_;
+};
+
+// Un task con i suoi conti: tempo sveglio (dal risveglio alla sleep
+// successiva) e tempo addormentato. Scritti dal task stesso, letti da tutti.
+class Task {
+public:
+  explicit Task(const char* name) : name_(name) {}
+
+  // Dal task stesso, prima della prima sleep(): lo registra nella tabella.
+  void attach();
+  // Dorme fino alla scadenza (almeno un tick) o a una notify(); true se notificato.
+  bool sleep(const Deadline& d);
+  // Sveglia il task (da un altro task); ignorata prima di attach().
+  void notify();
+
+  const char* name() const { return name_; }
+  uint32_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+  uint32_t notified() const { return notified_.load(std::memory_order_relaxed); }
+  uint64_t busyUs() const { return busyUs_.load(std::memory_order_relaxed); }
+  uint64_t idleUs() const { return idleUs_.load(std::memory_order_relaxed); }
+
+private:
+  const char* name_;
+  std::atomic<TaskHandle_t> handle_{nullptr};
+  uint32_t awakeSinceUs_ = 0;
+  std::atomic<uint32_t> wakeups_{0};
+  std::atomic<uint32_t> notified_{0};
+  std::atomic<uint64_t> busyUs_{0};
+  std::atomic<uint64_t> idleUs_{0};
+};
+
+// DFS + light sleep automatico (esp_pm), se il core Arduino lo consente.
+void beginPower();
+// Una riga per task (sveglio/addormentato, risvegli) + stato di esp_pm.
+void printStats(Print& out);
+
+} // namespace sched
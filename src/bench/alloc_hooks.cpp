@@ -0,0 +1,90 @@
+#include "bench/bench.h"
+
+#if defined(BENCH_ALLOC_HOOKS)
+// Conteggio allocazioni con il wrap del linker:
+//   -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+// (env esp32bench / native_bench in platformio.ini). free non si conta.
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+extern "C" {
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t n);
+}
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<uint32_t> allocs{0};
+std::atomic<uint32_t> bytes{0};
+
+inline void note(size_t n) {
+  if (!counting.load(std::memory_order_relaxed)) return;
+  allocs.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add((uint32_t)n, std::memory_order_relaxed);
+}
+
+} // namespace
+
+extern "C" {
+
+void* __wrap_malloc(size_t n) {
+  note(n);
+  return __real_malloc(n);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  note(n * size);
+  return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* p, size_t n) {
+  note(n);
+  return __real_realloc(p, n);
+}
+
+} // extern "C"
+
+// Su host libstdc++ è condivisa e il suo operator new non passa dal wrap:
+// lo si ridefinisce qui sopra malloc (su ESP32 è comunque equivalente).
+void* operator new(size_t n) {
+  void* p = malloc(n ? n : 1);
+  if (!p) abort();
+  return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace bench {
+
+bool allocHooksEnabled() { return true; }
+
+void allocCountStart() {
+  allocs.store(0, std::memory_order_relaxed);
+  bytes.store(0, std::memory_order_relaxed);
+  counting.store(true, std::memory_order_release);
+}
+
+AllocCount allocCountStop() {
+  counting.store(false, std::memory_order_release);
+  return {allocs.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed)};
+}
+
+} // namespace bench
+
+#else
+
+namespace bench {
+
+bool allocHooksEnabled() { return false; }
+void allocCountStart() {}
+AllocCount allocCountStop() { return {0, 0}; }
+
+} // namespace bench
+
+#endif
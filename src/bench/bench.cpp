@@ -0,0 +1,335 @@
+#include "bench/bench.h"
+#include "config.h"
+#include "app/alarm_rules.h"
+#include "app/readings.h"
+#include "net/telemetry_codec.h"
+#include "sensors/dht_decode.h"
+#include "sensors/mq7_convert.h"
+#include "sensors/mq7_sensor.h"
+#include "source/sd_logger.h"
+#include "util/log.h"
+#include "util/mpsc_ring.h"
+
+#if defined(ARDUINO)
+#include <esp_timer.h>
+#include "display/oled_display.h"
+#else
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace bench {
+
+namespace {
+
+#if defined(ARDUINO)
+constexpr bool HAS_CYCLES = true;
+constexpr const char* TARGET = "esp32";
+uint32_t cycleCount() { return ESP.getCycleCount(); }
+uint64_t nowNs() { return (uint64_t)esp_timer_get_time() * 1000u; }
+uint32_t cpuMhz() { return getCpuFrequencyMhz(); }
+#else
+#if defined(__x86_64__) || defined(__i386__)
+constexpr bool HAS_CYCLES = true;
+uint32_t cycleCount() { return (uint32_t)__rdtsc(); }
+#else
+constexpr bool HAS_CYCLES = false;
+uint32_t cycleCount() { return 0; }
+#endif
+constexpr const char* TARGET = "native";
+uint64_t nowNs() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+uint32_t cpuMhz() { return 0; }
+#endif
+
+// Destinazione di Print che scarta tutto: misura solo la formattazione.
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) override {
+    bytes++;
+    return 1;
+  }
+  size_t write(const uint8_t*, size_t n) override {
+    bytes += n;
+    return n;
+  }
+  size_t bytes = 0;
+};
+
+void fillSynthetic(net::TelemetryPayload* items, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    AppReadings& r = items[i].readings;
+    r.tC = 21.5f + 0.1f * i;
+    r.rh = 48.0f + 0.5f * i;
+    r.dhtOk = true;
+    r.mq7Raw = 1800 + i;
+    r.mq7Ratio = 0.9312f - 0.001f * i;
+    r.mq7Ppm = 12.4f + i;
+    r.mq7R0 = 10234.0f;
+    r.mq7Ok = true;
+    r.mq7Calibrated = true;
+    r.mq7WarmupDone = true;
+    r.mq7Level = 1;
+    items[i].ts = 1760000000u + 5u * i;
+    r.atUs = 1000000ull * (5 * i + 1); // acquisizione, allarme 80 us dopo, in coda entro 2 ms
+    r.alarmUs = r.atUs + 80;
+    items[i].queuedUs = r.alarmUs + 2000;
+  }
+}
+
+// Treno di impulsi DHT11 come lo consegna l'RMT (1 tick = 1 us, basso per
+// primo, dal resto dello start): 45.0 %RH 23.4 C. Stesso di test_dht_decode.
+const uint16_t DHT11_PULSES[] = {
+    14, 31, 81, 84, 53, 24, 54, 28, 48, 68, 56, 23, 53, 72, 48, 72, 51, 23, 49, 71, 54, 23, 51, 23, 56, 26,
+    48, 29, 49, 24, 48, 27, 54, 23, 51, 23, 56, 29, 50, 25, 54, 24, 56, 68, 52, 27, 50, 68, 51, 70, 49, 72,
+    49, 27, 48, 27, 51, 26, 56, 26, 53, 26, 55, 70, 52, 24, 50, 28, 51, 23, 52, 72, 55, 25, 55, 25, 49, 68,
+    56, 26, 50, 29, 53, 24, 53};
+constexpr size_t DHT_PULSES_N = sizeof(DHT11_PULSES) / sizeof(DHT11_PULSES[0]);
+
+// Un record del logger come lo riempie una LOGx.
+template <typename... A>
+void fillRecord(logging::Record& r, logging::Level l, logging::Mod m, const char* fmt, const A&... args) {
+  r.ms = hal::millis();
+  r.fmt = fmt;
+  r.level = (uint8_t)l;
+  r.mod = (uint8_t)m;
+  r.nargs = sizeof...(A);
+  logging::detail::Writer w{r.data, r.data + logging::PAYLOAD, false};
+  (logging::detail::put(w, args), ...);
+  r.len = (uint8_t)(w.p - r.data);
+}
+
+void printMeta(Print& out) {
+  out.printf("{\"meta\":\"envmon-bench\",\"version\":\"%s\",\"target\":\"%s\",\"build\":\"%s %s\",", FW_VERSION,
+             TARGET, __DATE__, __TIME__);
+  uint32_t mhz = cpuMhz();
+  if (mhz) {
+    out.printf("\"cpu_mhz\":%u,", (unsigned)mhz);
+  } else {
+    out.print("\"cpu_mhz\":null,");
+  }
+  out.printf("\"alloc_hooks\":%s}\n", allocHooksEnabled() ? "true" : "false");
+}
+
+} // namespace
+
+void measure(Print& out, const char* name, OpFn fn, void* ctx) {
+  static constexpr uint32_t MAX_ITERS = 1u << 24;
+  const uint64_t targetNs = (uint64_t)BENCH_MIN_BATCH_US * 1000u;
+
+  size_t outBytes = fn(ctx); // warm-up: cache e allocazioni del primo giro
+  uint32_t iters = 1;
+  for (;;) {
+    allocCountStart();
+    const uint64_t t0 = nowNs();
+    const uint32_t c0 = cycleCount();
+    for (uint32_t i = 0; i < iters; i++) outBytes = fn(ctx);
+    const uint32_t cycles = cycleCount() - c0;
+    const uint64_t ns = nowNs() - t0;
+    const AllocCount a = allocCountStop();
+
+    if (ns >= targetNs || iters >= MAX_ITERS) {
+      out.printf("{\"bench\":\"%s\",\"iters\":%u,\"ns\":%.1f,", name, (unsigned)iters, (double)ns / iters);
+      if (HAS_CYCLES) {
+        out.printf("\"cycles\":%.0f,", (double)cycles / iters);
+      } else {
+        out.print("\"cycles\":null,");
+      }
+      if (allocHooksEnabled()) {
+        out.printf("\"allocs\":%.2f,\"alloc_bytes\":%.1f,", (double)a.allocs / iters, (double)a.bytes / iters);
+      } else {
+        out.print("\"allocs\":null,\"alloc_bytes\":null,");
+      }
+      out.printf("\"out_bytes\":%u}\n", (unsigned)outBytes);
+      return;
+    }
+
+    // stima le iterazioni per arrivare al target con un margine del 20%
+    uint64_t next = ns > 0 ? (uint64_t)iters * targetNs * 6 / 5 / ns : (uint64_t)iters * 16;
+    if (next > (uint64_t)iters * 16) next = (uint64_t)iters * 16;
+    if (next <= iters) next = iters + 1;
+    iters = next > MAX_ITERS ? MAX_ITERS : (uint32_t)next;
+  }
+}
+
+void runAll(Print& out, OledDisplay* oled) {
+  printMeta(out);
+
+  // MQ-7: media dei campioni, Rs, ratio e ppm (powf), a warmup concluso
+  static BufferedAdcSampler sampler;
+  static Mq7Sensor mq7;
+  static const uint16_t samples[4] = {1790, 1810, 1805, 1795};
+  mq7.setSampler(&sampler);
+  mq7.begin();
+  mq7.setWarmupElapsed(MQ7_WARMUP_MS);
+  uint32_t now = hal::millis();
+  auto mq7Update = [&]() -> size_t {
+    sampler.feed(samples, 4);
+    now += MQ7_PERIOD_MS;
+    mq7.update(now);
+    return 0;
+  };
+  run(out, "mq7_update", mq7Update);
+
+  // Solo conversione raw Q.4 -> Rs, ratio, ppm: percorso float contro tabelle
+  static mq7conv::PpmTable table;
+  table.rebuild(MQ7_R0_DEFAULT);
+  uint32_t rawQ4 = 0;
+  auto nextRaw = [&]() {
+    rawQ4 = (rawQ4 + 7919) & 0xFFFF; // 64K valori Q.4 in ordine sparso
+    if (rawQ4 < (64u << mq7conv::FRAC_BITS)) rawQ4 += 64u << mq7conv::FRAC_BITS;
+    return rawQ4;
+  };
+  volatile float result;
+  auto convFloat = [&]() -> size_t {
+    const float rs = mq7conv::rawToRs(nextRaw() * (1.0f / (1u << mq7conv::FRAC_BITS)));
+    result = mq7conv::ratioToPpm(rs / MQ7_R0_DEFAULT);
+    return 0;
+  };
+  run(out, "mq7_conv_float", convFloat);
+  auto convLut = [&]() -> size_t {
+    uint32_t ratioQ16, ppmQ8;
+    const uint32_t q = nextRaw();
+    result = table.lookup(q, ratioQ16, ppmQ8) ? (float)ppmQ8 + mq7conv::rsQ4(q) : 0.0f;
+    return 0;
+  };
+  run(out, "mq7_conv_lut", convLut);
+
+  // Telemetria: stesso encoder della POST
+  static net::TelemetryPayload items[TELEMETRY_BATCH_MAX];
+  static char json[net::TELEMETRY_JSON_MAX_HEADER + net::TELEMETRY_JSON_MAX_POINT * TELEMETRY_BATCH_MAX];
+  static uint8_t bin[net::TELEMETRY_BIN_MAX_HEADER + net::TELEMETRY_BIN_MAX_TRACE +
+                     (net::TELEMETRY_BIN_MAX_RECORD + net::TELEMETRY_BIN_MAX_TRACE_RECORD) * TELEMETRY_BATCH_MAX];
+  fillSynthetic(items, TELEMETRY_BATCH_MAX);
+  net::BatchTrace trace;
+  trace.encodeUs = 110000000ull;
+  trace.atMs = 1760000110000ull;
+  trace.prevSendUs = 1200;
+  trace.prevAckUs = 38000;
+
+  auto jsonPoint = [&]() -> size_t { return net::encodeJsonPoint(DEVICE_ID, items[0], json, sizeof(json)); };
+  run(out, "json_point", jsonPoint);
+  auto jsonBatch = [&]() -> size_t {
+    return net::encodeJsonBatch(DEVICE_ID, items, TELEMETRY_BATCH_MAX, json, sizeof(json));
+  };
+  run(out, "json_batch", jsonBatch);
+  auto jsonBatchTrace = [&]() -> size_t {
+    return net::encodeJsonBatch(DEVICE_ID, items, TELEMETRY_BATCH_MAX, json, sizeof(json), &trace);
+  };
+  run(out, "json_batch_trace", jsonBatchTrace);
+  auto binPoint = [&]() -> size_t { return net::encodeBinaryBatch(DEVICE_ID, items, 1, bin, sizeof(bin)); };
+  run(out, "bin_point", binPoint);
+  auto binBatch = [&]() -> size_t {
+    return net::encodeBinaryBatch(DEVICE_ID, items, TELEMETRY_BATCH_MAX, bin, sizeof(bin));
+  };
+  run(out, "bin_batch", binBatch);
+  auto binBatchTrace = [&]() -> size_t {
+    return net::encodeBinaryBatch(DEVICE_ID, items, TELEMETRY_BATCH_MAX, bin, sizeof(bin), &trace);
+  };
+  run(out, "bin_batch_trace", binBatchTrace);
+
+  // Riga CSV di SdLogger (solo formattazione, niente SD)
+  char row[160];
+  auto csvRow = [&]() -> size_t {
+    return SdLogger::formatRow(row, sizeof(row), items[0].readings, items[0].ts, 123456789u);
+  };
+  run(out, "csv_row", csvRow);
+
+  const DhtReading dr{21.5f, 48.0f, true};
+  const Mq7Reading mr = mq7.get();
+  const auto readings = std::make_tuple(dr, mr);
+
+  // Decodifica di un frame DHT catturato (quello che fa poll() dopo l'RMT)
+  uint8_t dhtFrame[dhtproto::FRAME_BYTES];
+  auto dhtDecode = [&]() -> size_t {
+    return dhtproto::decode(DHT11_PULSES, DHT_PULSES_N, 0, dhtFrame) == DhtStatus::OK ? sizeof(dhtFrame) : 0;
+  };
+  run(out, "dht_decode", dhtDecode);
+
+  // Un giro del motore di regole (ingressi dalle letture, come il task allarme)
+  static AlarmEngine rules;
+  rules.compile(defaultAlarmRules());
+  uint32_t alarmNow = 0;
+  auto alarmEval = [&]() -> size_t {
+    AlarmInputs in = alarmInputs(readings);
+    alarmNow += 20; // tick del task allarme
+    in[AlarmSignal::MQ7_RATIO] = (alarmNow / 5000) & 1 ? 0.80f : 0.90f; // mq7 qui non è calibrato
+    return (size_t)rules.evaluate(alarmNow, in);
+  };
+  run(out, "alarm_eval", alarmEval);
+
+  // Log: printf diretto contro il percorso di una LOGx (argomenti nel record,
+  // ring, riga di testo o frame binario), su un ring privato: il logger
+  // globale (sink, rate limit, modo) resta com'è. Su ESP32 il chiamante paga
+  // solo l'accodamento, qui tutto.
+  NullPrint logSink;
+  static MpscRing<logging::Record, 4> logRing;
+  auto logPrintf = [&]() -> size_t {
+    logSink.bytes = 0;
+    logSink.printf("[%lu.%03lu] I net: POST batch %d | %u/%u accepted\n", 12ul, 345ul, 200, 8u, 10u);
+    return logSink.bytes;
+  };
+  run(out, "log_printf", logPrintf);
+  auto logVia = [&](auto emit) {
+    logSink.bytes = 0;
+    logRing.push([](logging::Record& r) {
+      fillRecord(r, logging::Level::INFO, logging::Mod::NET, "POST batch %d | %u/%u accepted", 200, 8u, 10u);
+    });
+    logRing.pop(emit);
+    return logSink.bytes;
+  };
+  auto logText = [&]() -> size_t {
+    return logVia([&](const logging::Record& r) {
+      char line[192];
+      logSink.write(reinterpret_cast<const uint8_t*>(line), logging::formatLine(r, line, sizeof(line)));
+    });
+  };
+  run(out, "log_text", logText);
+  auto logBinary = [&]() -> size_t {
+    return logVia([&](const logging::Record& r) {
+      uint8_t frame[2 + 8 + logging::PAYLOAD];
+      const size_t n = logging::encodeMsg(r, 0, frame + 2, sizeof(frame) - 2);
+      frame[0] = 0xA5; // FRAME_MSG
+      frame[1] = (uint8_t)n;
+      logSink.write(frame, 2 + n);
+    });
+  };
+  run(out, "log_binary", logBinary);
+
+#if defined(ARDUINO)
+  if (oled) {
+    // Cambia solo T a ogni giro: una riga ridisegnata, una pagina inviata.
+    OledView view{dr.tC, dr.rh, mr.ppm, mr.ratio, mr.ok, mr.calibrated, mr.warmupDone, 1};
+    uint32_t frame = 0;
+    auto oledDraw = [&]() -> size_t {
+      view.tC = 20.0f + (frame++ & 1);
+      oled->draw(view);
+      return 0;
+    };
+    run(out, "oled_draw", oledDraw);
+    auto oledPush = [&]() -> size_t {
+      view.tC = 20.0f + (frame++ & 1);
+      oled->draw(view);
+      oled->push();
+      return 0;
+    };
+    run(out, "oled_push", oledPush);
+    // Come il vecchio percorso: tutte le righe e tutte le 8 pagine
+    auto oledPushFull = [&]() -> size_t {
+      oled->invalidate();
+      oled->draw(view);
+      oled->push();
+      return 0;
+    };
+    run(out, "oled_push_full", oledPushFull);
+  }
+#else
+  (void)oled;
+#endif
+}
+
+} // namespace bench
@@ -0,0 +1,28 @@
+#if defined(BENCH_MAIN)
+// Entry point degli env esp32bench / native_bench: esegue la suite una volta.
+#include "bench/bench.h"
+
+#if defined(ARDUINO)
+#include "display/oled_display.h"
+
+static OledDisplay oled;
+
+void setup() {
+  Serial.begin(115200);
+  delay(500);
+
+  const bool oledOk = oled.begin();
+  bench::runAll(Serial, oledOk ? &oled : nullptr);
+  Serial.println("{\"done\":true}");
+}
+
+void loop() {
+  delay(1000);
+}
+#else
+int main() {
+  bench::runAll(Serial);
+  return 0;
+}
+#endif
+#endif
@@ -2,19 +2,35 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <string.h>
 
 static constexpr int SCREEN_W = 128;
 static constexpr int SCREEN_H = 64;
+static constexpr uint8_t PAGES = SCREEN_H / 8;
+static constexpr uint8_t LINE_H = 8; // testo size 1: una riga = una pagina
+static constexpr uint32_t REFRESH_MS = 500;
+static constexpr size_t I2C_CHUNK = 64; // byte dati per transazione (sotto il buffer di Wire)
+static constexpr uint8_t I2C_DATA = 0x40; // control byte: segue GDDRAM
 
-static Adafruit_SSD1306 display(SCREEN_W, SCREEN_H, &Wire, -1); // -1 = no reset pin
+// -1 = no reset pin; stesso clock durante e dopo i trasferimenti della libreria
+static Adafruit_SSD1306 display(SCREEN_W, SCREEN_H, &Wire, -1, OLED_I2C_HZ, OLED_I2C_HZ);
 
-void OledDisplay::begin() {
+static_assert(OledDisplay::LINES <= PAGES, "una riga per pagina");
+
+static bool probe(uint8_t addr) {
+  Wire.beginTransmission(addr);
+  return Wire.endTransmission() == 0;
+}
+
+bool OledDisplay::begin() {
   Wire.begin(21,22);
 
-  if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) { // 0x3C tipico
-    // se non parte, prova 0x3D (vedi sotto)
-    while (true) delay(1000);
-  }
+  // display.begin() non verifica l'ACK: senza sonda "parte" anche senza display
+  uint8_t addr = OLED_I2C_ADDR;
+  if (!probe(addr)) addr = OLED_I2C_ADDR == 0x3C ? 0x3D : 0x3C;
+  if (!probe(addr) || !display.begin(SSD1306_SWITCHCAPVCC, addr)) return false;
+  addr_ = addr; // push() scrive la GDDRAM a mano: stesso indirizzo della libreria
+  Wire.setClock(OLED_I2C_HZ);
 
   display.clearDisplay();
   display.setTextSize(1);
@@ -23,38 +39,129 @@ void OledDisplay::begin() {
   display.println("EnvMonitor");
   display.println("Booting...");
   display.display();
+  invalidate();
+  ready_ = true;
+  return true;
 }
 
-void OledDisplay::update(float tC, float rh, float coPpm, float ratio, bool mqOk, bool calibrated, bool warmupDone, uint8_t mq7Level) {
+bool OledDisplay::update(const OledView& v) {
   const uint32_t now = millis();
-  if (now < nextDraw_) return;
-  nextDraw_ = now + 500; // refresh 2Hz
+  if ((int32_t)(now - nextDraw_) < 0) return false;
+  nextDraw_ = now + REFRESH_MS; // refresh 2Hz
 
-  display.clearDisplay();
-  display.setCursor(0, 0);
+  draw(v);
+  if (!dirtyPages_) return false;
+  push();
+  return true;
+}
+
+void OledDisplay::setLine_(uint8_t line, const char* text) {
+  if (strcmp(shown_[line], text) == 0) return;
+  strncpy(shown_[line], text, LINE_CHARS - 1);
+  display.fillRect(0, line * LINE_H, SCREEN_W, LINE_H, SSD1306_BLACK);
+  display.setCursor(0, line * LINE_H);
+  display.print(shown_[line]);
+  dirtyPages_ |= (uint8_t)(1u << line);
+}
 
-  display.printf("T: %.1f C\n", tC);
-  display.printf("RH: %.0f %%\n", rh);
-
-  if (!warmupDone) {
-    display.println("CO: warmup...");
-    display.printf("ratio: %.2f\n", ratio);
-  } else if (!calibrated) {
-    display.println("CO: calib needed");
-    display.printf("ratio: %.2f\n", ratio);
-  } else if (mqOk) {
-    display.printf("CO: %.0f ppm\n", coPpm);
-    display.printf("ratio: %.2f\n", ratio);
+void OledDisplay::draw(const OledView& v) {
+  char line[LINE_CHARS];
+  stats_.frames++;
+
+  snprintf(line, sizeof(line), "T: %.1f C", v.tC);
+  setLine_(0, line);
+  snprintf(line, sizeof(line), "RH: %.0f %%", v.rh);
+  setLine_(1, line);
+
+  if (!v.warmupDone) {
+    setLine_(2, "CO: warmup...");
+  } else if (!v.calibrated) {
+    setLine_(2, "CO: calib needed");
+  } else if (v.mqOk) {
+    snprintf(line, sizeof(line), "CO: %.0f ppm", v.coPpm);
+    setLine_(2, line);
   } else {
-    display.println("CO: n/d");
-    display.printf("ratio: %.2f\n", ratio);
+    setLine_(2, "CO: n/d");
   }
+  snprintf(line, sizeof(line), "ratio: %.2f", v.ratio);
+  setLine_(3, line);
 
   const char* level = "UNK";
-  if (mq7Level == 1) level = "OK";
-  else if (mq7Level == 2) level = "WARN";
-  else if (mq7Level == 3) level = "DANGER";
-  display.printf("State: %s\n", level);
+  if (v.mq7Level == 1) level = "OK";
+  else if (v.mq7Level == 2) level = "WARN";
+  else if (v.mq7Level == 3) level = "DANGER";
+  snprintf(line, sizeof(line), "State: %s", level);
+  setLine_(4, line);
+}
 
-  display.display();
+// Invia solo le pagine sporche, una finestra PAGEADDR per ogni gruppo di
+// pagine consecutive (indirizzamento orizzontale impostato da begin()).
+void OledDisplay::push() {
+  if (!dirtyPages_) return;
+  const uint32_t t0 = micros();
+  const uint8_t* buf = display.getBuffer();
+
+  uint8_t first = 0;
+  bool ok = true;
+  while (first < PAGES) {
+    if (!(dirtyPages_ & (1u << first))) {
+      first++;
+      continue;
+    }
+    uint8_t last = first;
+    while (last + 1 < PAGES && (dirtyPages_ & (1u << (last + 1)))) last++;
+
+    display.ssd1306_command(SSD1306_PAGEADDR);
+    display.ssd1306_command(first);
+    display.ssd1306_command(last);
+    display.ssd1306_command(SSD1306_COLUMNADDR);
+    display.ssd1306_command(0);
+    display.ssd1306_command(SCREEN_W - 1);
+
+    const uint8_t* p = buf + first * SCREEN_W;
+    size_t left = (size_t)(last - first + 1) * SCREEN_W;
+    bool sent = true;
+    while (left > 0) {
+      const size_t n = left < I2C_CHUNK ? left : I2C_CHUNK;
+      Wire.beginTransmission(addr_);
+      Wire.write(I2C_DATA);
+      Wire.write(p, n);
+      if (Wire.endTransmission() != 0) {
+        sent = false; // NACK/timeout: il resto del gruppo andrebbe perso allo stesso modo
+        break;
+      }
+      p += n;
+      left -= n;
+    }
+    if (sent) stats_.pages += last - first + 1;
+    else stats_.i2cErrors++;
+    ok = ok && sent;
+    first = last + 1;
+  }
+  // Se qualcosa non è passato si reinvia tutto al prossimo frame: la finestra
+  // PAGEADDR e il contenuto della GDDRAM non sono più noti.
+  if (ok) dirtyPages_ = 0;
+  else invalidate();
+
+  const uint32_t us = micros() - t0;
+  stats_.pushes++;
+  stats_.lastPushUs = us;
+  if (us > stats_.maxPushUs) stats_.maxPushUs = us;
+  stats_.totalPushUs += us;
+}
+
+void OledDisplay::invalidate() {
+  for (uint8_t i = 0; i < LINES; i++) shown_[i][0] = '\0';
+  dirtyPages_ = (uint8_t)((1u << PAGES) - 1);
+}
+
+void OledDisplay::printStats(Print& out) const {
+  if (!ready_) {
+    out.println("oled: not found");
+    return;
+  }
+  out.printf("oled: 0x%02X frames=%u pushes=%u pages=%u i2c_err=%u last=%uus max=%uus avg=%uus @%ukHz\n",
+             (unsigned)addr_, (unsigned)stats_.frames, (unsigned)stats_.pushes, (unsigned)stats_.pages,
+             (unsigned)stats_.i2cErrors, (unsigned)stats_.lastPushUs, (unsigned)stats_.maxPushUs,
+             stats_.pushes ? (unsigned)(stats_.totalPushUs / stats_.pushes) : 0u, (unsigned)(OLED_I2C_HZ / 1000));
 }
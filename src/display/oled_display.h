@@ -1,11 +1,69 @@
 #pragma once
 #include <Arduino.h>
+#include "app/app_state.h"
 
+#ifndef OLED_I2C_ADDR
+#define OLED_I2C_ADDR 0x3C // 0x3C tipico, alcuni moduli 0x3D
+#endif
+#ifndef OLED_I2C_HZ
+#define OLED_I2C_HZ 400000 // fast mode: l'SSD1306 lo regge, 100k è il default di Wire
+#endif
+
+// Valori mostrati sull'OLED.
+struct OledView {
+  float tC = NAN;
+  float rh = NAN;
+  float coPpm = NAN;
+  float ratio = NAN;
+  bool mqOk = false;
+  bool calibrated = false;
+  bool warmupDone = false;
+  uint8_t mq7Level = 0; // 0=UNKNOWN, 1=OK, 2=WARN, 3=DANGER
+
+  static OledView from(const AppReadings& r) {
+    return {r.tC, r.rh, r.mq7Ppm, r.mq7Ratio, r.mq7Ok, r.mq7Calibrated, r.mq7WarmupDone, r.mq7Level};
+  }
+};
+
+struct OledStats {
+  uint32_t frames = 0;     // update() che hanno ridisegnato
+  uint32_t pushes = 0;     // frame con almeno una pagina inviata
+  uint32_t pages = 0;      // pagine SSD1306 inviate in totale
+  uint32_t i2cErrors = 0;  // gruppi di pagine non confermati (NACK), reinviati al frame dopo
+  uint32_t lastPushUs = 0; // tempo I2C dell'ultimo push
+  uint32_t maxPushUs = 0;
+  uint64_t totalPushUs = 0;
+};
+
+// Una riga di testo per pagina SSD1306 (8 px). Ogni riga ricorda l'ultimo
+// testo mostrato: si ridisegna solo se il testo formattato cambia e via I2C
+// passano solo le pagine toccate.
 class OledDisplay {
 public:
-  void begin();
-  void update(float tC, float rh, float coPpm, float ratio, bool mqOk, bool calibrated, bool warmupDone, uint8_t mq7Level);
+  static constexpr uint8_t LINES = 5;
+  static constexpr uint8_t LINE_CHARS = 22; // 21 colonne a 6 px + '\0'
+
+  // false se non risponde né a OLED_I2C_ADDR né all'altro indirizzo SSD1306
+  bool begin();
+  bool isReady() const { return ready_; }
+  // true se ha inviato qualcosa (tempo in stats().lastPushUs)
+  bool update(const OledView& v);
+  uint32_t nextDeadlineMs() const { return nextDraw_; }
+  // update() = draw() nel framebuffer + push() via I2C, separati per il benchmark.
+  void draw(const OledView& v);
+  void push();
+  // Forza il ridisegno e l'invio di tutte le righe al prossimo draw().
+  void invalidate();
+  const OledStats& stats() const { return stats_; }
+  void printStats(Print& out) const;
 
 private:
+  void setLine_(uint8_t line, const char* text);
+
+  bool ready_ = false;
+  uint8_t addr_ = OLED_I2C_ADDR; // indirizzo che ha risposto alla sonda in begin()
   uint32_t nextDraw_ = 0;
+  char shown_[LINES][LINE_CHARS] = {};
+  uint8_t dirtyPages_ = 0;
+  OledStats stats_;
 };
@@ -0,0 +1,149 @@
+#if defined(ARDUINO)
+#include "hal/hal.h"
+#include "hal/hal_fs.h"
+#include "config.h"
+#include "util/log.h"
+
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+#include <SD.h>
+#include <SPI.h>
+
+namespace hal {
+
+static Preferences prefs;
+static bool prefsInited = false;
+
+uint64_t monoUs() { return (uint64_t)esp_timer_get_time(); }
+uint32_t millis() { return ::millis(); }
+uint32_t micros() { return ::micros(); }
+void delayMs(uint32_t ms) { ::delay(ms); }
+void yieldLower() { vTaskDelay(1); }
+
+void gpioOutput(uint8_t pin) { pinMode(pin, OUTPUT); }
+void gpioWrite(uint8_t pin, bool high) { digitalWrite(pin, high ? HIGH : LOW); }
+
+void toneBegin(uint8_t pin, uint8_t channel, uint32_t freqHz) {
+  ledcSetup(channel, freqHz, 8);
+  ledcAttachPin(pin, channel);
+}
+
+void toneWrite(uint8_t channel, uint32_t freqHz) { ledcWriteTone(channel, freqHz); }
+
+TimerHandle timerCreate(TimerFn fn, void* arg, const char* name) {
+  esp_timer_create_args_t args = {};
+  args.callback = fn;
+  args.arg = arg;
+  args.name = name;
+  esp_timer_handle_t t = nullptr;
+  return esp_timer_create(&args, &t) == ESP_OK ? t : nullptr;
+}
+
+// Senza lock, due task che riarmano lo stesso timer possono intrecciare
+// stop/start: il secondo start trova il timer attivo e fallisce.
+static portMUX_TYPE timerMux = portMUX_INITIALIZER_UNLOCKED;
+
+bool timerStartOnce(TimerHandle t, uint32_t us) {
+  esp_timer_handle_t h = static_cast<esp_timer_handle_t>(t);
+  portENTER_CRITICAL(&timerMux);
+  esp_timer_stop(h); // errore innocuo se non era attivo
+  const esp_err_t err = esp_timer_start_once(h, us);
+  portEXIT_CRITICAL(&timerMux);
+  return err == ESP_OK;
+}
+
+void timerStop(TimerHandle t) { esp_timer_stop(static_cast<esp_timer_handle_t>(t)); }
+
+struct AwakeLock {
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_handle_t pm;
+#endif
+  bool held;
+};
+static constexpr uint8_t MAX_AWAKE = 4;
+static AwakeLock awakeLocks[MAX_AWAKE];
+static uint8_t awakeCount = 0;
+
+AwakeHandle awakeCreate(const char* name) {
+  if (awakeCount >= MAX_AWAKE) return nullptr;
+  AwakeLock& l = awakeLocks[awakeCount];
+#if CONFIG_PM_ENABLE
+  if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, name, &l.pm) != ESP_OK) return nullptr;
+#else
+  (void)name;
+#endif
+  l.held = false;
+  return &awakeLocks[awakeCount++];
+}
+
+void awakeHold(AwakeHandle h, bool hold) {
+  AwakeLock* l = static_cast<AwakeLock*>(h);
+  if (!l || l->held == hold) return;
+  l->held = hold;
+#if CONFIG_PM_ENABLE
+  if (hold) {
+    esp_pm_lock_acquire(l->pm);
+  } else {
+    esp_pm_lock_release(l->pm);
+  }
+#endif
+}
+
+HeapInfo heapInfo() {
+  return {(uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+          (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+          (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT)};
+}
+
+bool hasPsram() { return psramFound(); }
+
+void* allocLarge(size_t bytes) { return psramFound() ? ps_malloc(bytes) : malloc(bytes); }
+
+bool nvsBegin() {
+  if (!prefsInited) prefsInited = prefs.begin("envmon", false);
+  return prefsInited;
+}
+
+bool nvsHas(const char* key) { return prefsInited && prefs.isKey(key); }
+float nvsGetFloat(const char* key, float fallback) { return prefsInited ? prefs.getFloat(key, fallback) : fallback; }
+
+void nvsPutFloat(const char* key, float value) {
+  if (prefsInited) prefs.putFloat(key, value);
+}
+
+size_t nvsGetBytes(const char* key, void* out, size_t len) {
+  if (!prefsInited || prefs.getBytesLength(key) != len) return 0;
+  return prefs.getBytes(key, out, len);
+}
+
+void nvsPutBytes(const char* key, const void* data, size_t len) {
+  if (prefsInited) prefs.putBytes(key, data, len);
+}
+
+void nvsRemove(const char* key) {
+  if (prefsInited) prefs.remove(key);
+}
+
+const char* fsRoot() { return "/sd"; }
+
+bool fsBegin() {
+  SPI.begin(PIN_SD_SCK, PIN_SD_MISO, PIN_SD_MOSI, PIN_SD_CS);
+  pinMode(PIN_SD_CS, OUTPUT);
+  digitalWrite(PIN_SD_CS, HIGH);
+
+  LOGI(STORAGE, "SD init pins CS=%d SCK=%d MISO=%d MOSI=%d", PIN_SD_CS, PIN_SD_SCK, PIN_SD_MISO, PIN_SD_MOSI);
+
+  // Many cheap SD modules are unstable at default SPI speed with long wires.
+  bool ok = SD.begin(PIN_SD_CS, SPI, 1000000U, fsRoot());
+  if (!ok) {
+    ok = SD.begin(PIN_SD_CS, SPI, 400000U, fsRoot());
+  }
+  return ok;
+}
+
+} // namespace hal
+#endif
@@ -0,0 +1,80 @@
+#include "hal/hal_fs.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hal {
+
+static void fullPath(const char* path, char* out, size_t cap) {
+  snprintf(out, cap, "%s%s", fsRoot(), path);
+}
+
+bool fsExists(const char* path) {
+  char p[96];
+  fullPath(path, p, sizeof(p));
+  struct stat st;
+  return stat(p, &st) == 0;
+}
+
+bool fsMkdir(const char* path) {
+  char p[96];
+  fullPath(path, p, sizeof(p));
+  return mkdir(p, 0775) == 0;
+}
+
+bool fsRemove(const char* path) {
+  char p[96];
+  fullPath(path, p, sizeof(p));
+  return remove(p) == 0;
+}
+
+bool fsRename(const char* from, const char* to) {
+  char a[96], b[96];
+  fullPath(from, a, sizeof(a));
+  fullPath(to, b, sizeof(b));
+  return rename(a, b) == 0;
+}
+
+bool File::open(const char* path, const char* mode) {
+  close();
+  char p[96];
+  fullPath(path, p, sizeof(p));
+  f_ = fopen(p, mode);
+  if (!f_) return false;
+  setvbuf(f_, nullptr, _IONBF, 0);
+  return true;
+}
+
+void File::close() {
+  if (f_) fclose(f_);
+  f_ = nullptr;
+}
+
+size_t File::write(const void* data, size_t n) {
+  return f_ ? fwrite(data, 1, n, f_) : 0;
+}
+
+size_t File::read(void* data, size_t n) {
+  return f_ ? fread(data, 1, n, f_) : 0;
+}
+
+bool File::seek(size_t pos) {
+  return f_ && fseek(f_, (long)pos, SEEK_SET) == 0;
+}
+
+size_t File::size() {
+  if (!f_) return 0;
+  long cur = ftell(f_);
+  fseek(f_, 0, SEEK_END);
+  long end = ftell(f_);
+  fseek(f_, cur, SEEK_SET);
+  return end > 0 ? (size_t)end : 0;
+}
+
+void File::flush() {
+  if (!f_) return;
+  fflush(f_);
+  fsync(fileno(f_));
+}
+
+} // namespace hal
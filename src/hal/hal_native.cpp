@@ -0,0 +1,145 @@
+#if !defined(ARDUINO)
+#include "hal/hal.h"
+#include "hal/hal_fs.h"
+#include "hal/hal_native.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+
+FilePrint Serial(stdout);
+
+namespace hal {
+
+// Tempo virtuale: avanza solo con advanceMs()/delayMs(), così una replay
+// di mesi di dati gira alla velocità della CPU.
+static uint64_t nowUs = 0;
+static bool gpio[64];
+static uint32_t tones[16];
+static std::map<std::string, float> nvs;
+static std::map<std::string, std::string> nvsBlobs;
+static std::string root = "sdcard";
+
+struct NativeTimer {
+  TimerFn fn;
+  void* arg;
+  uint64_t dueUs;
+  bool armed;
+};
+static constexpr size_t MAX_TIMERS = 8;
+static NativeTimer timers[MAX_TIMERS];
+static size_t timerCount = 0;
+
+// Porta il tempo a targetUs facendo scattare in ordine i timer scaduti
+// (ognuno vede micros() = sua scadenza).
+static void advanceTo(uint64_t targetUs) {
+  for (;;) {
+    NativeTimer* next = nullptr;
+    for (size_t i = 0; i < timerCount; i++) {
+      NativeTimer& t = timers[i];
+      if (t.armed && t.dueUs <= targetUs && (!next || t.dueUs < next->dueUs)) next = &t;
+    }
+    if (!next) break;
+    if (next->dueUs > nowUs) nowUs = next->dueUs;
+    next->armed = false;
+    next->fn(next->arg);
+  }
+  nowUs = targetUs;
+}
+
+uint64_t monoUs() { return nowUs; }
+uint32_t millis() { return (uint32_t)(nowUs / 1000u); }
+uint32_t micros() { return (uint32_t)nowUs; }
+void delayMs(uint32_t ms) { advanceTo(nowUs + (uint64_t)ms * 1000u); }
+void yieldLower() { std::this_thread::yield(); } // il tempo virtuale non avanza
+
+void gpioOutput(uint8_t) {}
+void gpioWrite(uint8_t pin, bool high) {
+  if (pin < 64) gpio[pin] = high;
+}
+
+void toneBegin(uint8_t, uint8_t, uint32_t) {}
+void toneWrite(uint8_t channel, uint32_t freqHz) {
+  if (channel < 16) tones[channel] = freqHz;
+}
+
+TimerHandle timerCreate(TimerFn fn, void* arg, const char*) {
+  if (timerCount >= MAX_TIMERS) return nullptr;
+  timers[timerCount] = {fn, arg, 0, false};
+  return &timers[timerCount++];
+}
+
+bool timerStartOnce(TimerHandle t, uint32_t us) {
+  NativeTimer* nt = static_cast<NativeTimer*>(t);
+  nt->dueUs = nowUs + us;
+  nt->armed = true;
+  return true;
+}
+
+void timerStop(TimerHandle t) { static_cast<NativeTimer*>(t)->armed = false; }
+
+// Nessun light sleep sull'host: basta un handle non nullo.
+AwakeHandle awakeCreate(const char*) {
+  static bool dummy;
+  return &dummy;
+}
+void awakeHold(AwakeHandle, bool) {}
+
+HeapInfo heapInfo() { return {0, 0, 0}; }
+
+bool hasPsram() { return false; }
+void* allocLarge(size_t bytes) { return malloc(bytes); }
+
+bool nvsBegin() { return true; }
+bool nvsHas(const char* key) { return nvs.count(key) != 0 || nvsBlobs.count(key) != 0; }
+
+float nvsGetFloat(const char* key, float fallback) {
+  auto it = nvs.find(key);
+  return it == nvs.end() ? fallback : it->second;
+}
+
+void nvsPutFloat(const char* key, float value) { nvs[key] = value; }
+
+size_t nvsGetBytes(const char* key, void* out, size_t len) {
+  auto it = nvsBlobs.find(key);
+  if (it == nvsBlobs.end() || it->second.size() != len) return 0;
+  memcpy(out, it->second.data(), len);
+  return len;
+}
+
+void nvsPutBytes(const char* key, const void* data, size_t len) {
+  nvsBlobs[key].assign(static_cast<const char*>(data), len);
+}
+
+void nvsRemove(const char* key) {
+  nvs.erase(key);
+  nvsBlobs.erase(key);
+}
+
+const char* fsRoot() { return root.c_str(); }
+
+bool fsBegin() {
+  struct stat st;
+  return stat(root.c_str(), &st) == 0 || mkdir(root.c_str(), 0775) == 0;
+}
+
+namespace native {
+
+void setMillis(uint64_t ms) { nowUs = ms * 1000u; }
+void advanceMs(uint32_t ms) { advanceTo(nowUs + (uint64_t)ms * 1000u); }
+uint64_t nowMs64() { return nowUs / 1000u; }
+
+bool gpioLevel(uint8_t pin) { return pin < 64 && gpio[pin]; }
+uint32_t toneFreq(uint8_t channel) { return channel < 16 ? tones[channel] : 0; }
+
+void setFsRoot(const char* dir) { root = dir; }
+void nvsClear() {
+  nvs.clear();
+  nvsBlobs.clear();
+}
+
+} // namespace native
+} // namespace hal
+#endif
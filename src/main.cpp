@@ -1,191 +1,112 @@
 #include <Arduino.h>
 #include <math.h>
 #include "config.h"
-#include "sensors/dht_sensor.h"
-#include "sensors/mq7_sensor.h"
+#include "sensors/board_sensors.h"
 #include "app/app_state.h"
+#include "app/alarm.h"
+#include "app/duty_cycle.h"
+#include "app/pipeline.h"
+#include "app/readings.h"
+#include "app/scheduler.h"
 #include "net/wifi_manager.h"
-#include "net/telemetry_client.h"
 #include "time/time_sync.h"
 #include "display/oled_display.h"
 #include "source/sd_logger.h"
+#include "storage/bin_logger.h"
+#include "util/log.h"
+
+#ifndef CONSOLE_BENCH
+#define CONSOLE_BENCH 0 // 1 = comando 'b' (benchmark a pipeline attiva, blocca la console e ruba CPU ai task)
+#endif
+#if CONSOLE_BENCH
+#include "bench/bench.h"
+#endif
 
 SdLogger sd;
+BinLogger binlog;
 OledDisplay oled;
-DhtSensor dht;
-Mq7Sensor mq7;
-static uint32_t nextSendMs = 0;
-static bool buzzerOn = false;
-static uint32_t buzzerNextToggleMs = 0;
-static constexpr int BUZZER_PWM_CHANNEL = 1;
+BoardSensors sensors;
+AlarmOutput alarmOut;
 
-enum class AlarmLevel : uint8_t { UNKNOWN = 0, OK = 1, WARN = 2, DANGER = 3 };
-static AlarmLevel alarmLevel = AlarmLevel::UNKNOWN;
-
-static void setBuzzer(bool on) {
-  buzzerOn = on;
-  bool ledOut = ALARM_LED_ACTIVE_HIGH ? on : !on;
-  digitalWrite(PIN_ALARM_LED, ledOut ? HIGH : LOW);
-
-#if defined(ESP32)
-  if (BUZZER_USE_TONE) {
-    if (!on) {
-      ledcWriteTone(BUZZER_PWM_CHANNEL, 0);
-      return;
-    }
-
-    uint32_t freq = (alarmLevel == AlarmLevel::DANGER) ? BUZZER_DANGER_FREQ_HZ : BUZZER_WARN_FREQ_HZ;
-    ledcWriteTone(BUZZER_PWM_CHANNEL, freq);
-    return;
-  }
+#ifndef CONSOLE_STATUS_MS
+#define CONSOLE_STATUS_MS 1000 // riga di stato periodica (0 = solo comandi)
 #endif
 
-  bool out = BUZZER_ACTIVE_HIGH ? on : !on;
-  digitalWrite(PIN_BUZZER, out ? HIGH : LOW);
-}
-
-static AlarmLevel computeAlarmLevel(const Mq7Reading& mr) {
-  if (!mr.warmupDone || !mr.calibrated || !isfinite(mr.ratio)) return AlarmLevel::UNKNOWN;
-  if (mr.ratio < MQ7_RATIO_DANGER_LT) return AlarmLevel::DANGER;
-  if (mr.ratio < MQ7_RATIO_WARN_LT) return AlarmLevel::WARN;
-  return AlarmLevel::OK;
-}
-
-static void updateBuzzer(uint32_t nowMs, AlarmLevel level) {
-  if (level != alarmLevel) {
-    alarmLevel = level;
-    setBuzzer(false);
-    buzzerNextToggleMs = nowMs;
-  }
-
-  if (alarmLevel == AlarmLevel::UNKNOWN || alarmLevel == AlarmLevel::OK) {
-    setBuzzer(false);
-    return;
-  }
-
-  if (nowMs < buzzerNextToggleMs) return;
-
-  if (alarmLevel == AlarmLevel::WARN) {
-    if (!buzzerOn) {
-      setBuzzer(true);
-      buzzerNextToggleMs = nowMs + BUZZER_WARN_ON_MS;
-    } else {
-      setBuzzer(false);
-      buzzerNextToggleMs = nowMs + (BUZZER_WARN_PERIOD_MS - BUZZER_WARN_ON_MS);
-    }
-    return;
-  }
-
-  // DANGER: beep continuo a impulsi rapidi.
-  setBuzzer(!buzzerOn);
-  buzzerNextToggleMs = nowMs + (buzzerOn ? BUZZER_DANGER_ON_MS : BUZZER_DANGER_OFF_MS);
-}
+// loop() dorme fino alla prossima riga di stato o a un byte sulla seriale.
+static sched::Task console("console");
+static uint32_t nextStatusMs = 0;
 
 void setup() {
   Serial.begin(115200);
-  oled.begin();
-  delay(300);
-  bool sdOk = sd.begin();
-  Serial.printf("SD logger: %s\n", sdOk ? "OK" : "FAIL");
-
-#if defined(ESP32)
-  if (BUZZER_USE_TONE) {
-    ledcSetup(BUZZER_PWM_CHANNEL, BUZZER_WARN_FREQ_HZ, 8);
-    ledcAttachPin(PIN_BUZZER, BUZZER_PWM_CHANNEL);
-  } else {
-    pinMode(PIN_BUZZER, OUTPUT);
-  }
-#else
-  pinMode(PIN_BUZZER, OUTPUT);
-#endif
-  pinMode(PIN_ALARM_LED, OUTPUT);
-  digitalWrite(PIN_ALARM_LED, ALARM_LED_ACTIVE_HIGH ? LOW : HIGH);
-  setBuzzer(false);
-  setBuzzer(true);
-  delay(500);
-  setBuzzer(false);
-
+  logging::begin(Serial);
+  if (POWER_DEEP_SLEEP) duty::run(sensors, alarmOut); // a batteria: campione e deep sleep, non ritorna
+  console.attach(); // setup() e loop() girano nello stesso task
+  Serial.onReceive([]() { console.notify(); });
+
+  // Prima la radio: associazione (BSSID in cache), DHCP e NTP proseguono nel
+  // driver. SD e OLED li inizializzano i loro task, in parallelo; se mancano
+  // la pipeline va avanti senza.
   net::wifiBegin();
   timeutil::beginNtp();
-  dht.begin();
-  mq7.begin();
 
-  Serial.println("EnvMonitor start");
+  alarmOut.begin();
+  alarmOut.selfTest(); // non blocca: lo suona il timer dei pattern
+  sensors.begin();
+
+  pipeline::begin({&sensors, &oled, &sd, SD_LOG_BINARY ? &binlog : nullptr, &alarmOut});
+
+  LOGI(SYS, "EnvMonitor start");
   Serial.println("Type 'c' + Enter to calibrate MQ7 R0 (in clean air, after warm-up).");
   Serial.println("Type 'r' + Enter to reset MQ7 R0 calibration.");
-  Serial.println("Calibration uses 20 samples and requires stable signal (<5% stddev).");
+  Serial.println("Type 's' + Enter to print pipeline stage latencies.");
+  Serial.println("Type 'm' + Enter to print latency histograms, overruns and heap.");
+  Serial.println("Type 'h' + Enter to print the on-device minute/hour history.");
+#if CONSOLE_BENCH
+  Serial.println("Type 'b' + Enter to run the hot-path benchmarks (JSON lines).");
+#endif
+  Serial.println("Calibration collects one Rs per MQ7 reading and ends when 20 in a row are stable (<5% stddev), max 5 min.");
   Serial.println("MQ7 readings are ignored for the first 10 minutes (warm-up).");
 }
 
+// loop() fa solo da console: sensori, allarme, SD, display e rete girano nei task della pipeline.
 void loop() {
-  uint32_t now = millis();
-
-  net::wifiEnsureConnected(now);
-  dht.update(now);
-  mq7.update(now);
-
   // Serial commands
-  if (Serial.available()) {
+  while (Serial.available()) {
     char ch = (char)Serial.read();
     if (ch == 'c') {
-      bool ok = mq7.calibrateNow(MQ7_CALIB_SAMPLES);
-      Serial.printf("MQ7 calibrate: %s\n", ok ? "OK" : "FAIL (need warm-up + stable clean air)");
+      pipeline::requestCalibration(MQ7_CALIB_SAMPLES);
+      LOGI(SENSOR, "MQ7 calibration started (keep the sensor in clean air).");
     } else if (ch == 'r') {
-      mq7.resetCalibration();
-      Serial.println("MQ7 calibration reset (R0 fallback restored).");
+      pipeline::requestCalibrationReset();
+      LOGI(SENSOR, "MQ7 calibration reset (R0 fallback restored).");
+    } else if (ch == 's') {
+      pipeline::printStats(Serial);
+    } else if (ch == 'm') {
+      pipeline::printMetrics(Serial);
+    } else if (ch == 'h') {
+      pipeline::printHistory(Serial);
+#if CONSOLE_BENCH
+    } else if (ch == 'b') {
+      bench::runAll(Serial); // pipeline attiva: niente casi OLED
+#endif
     }
   }
 
-  // Print (debug)
-  auto dr = dht.get();
-  if (dr.ok) {
-    Serial.printf("DHT T=%.1fC RH=%.0f%% | ", dr.tC, dr.rh);
-  } else {
-    Serial.print("DHT fail | ");
-  }
-
-  auto mr = mq7.get();
-  AlarmLevel level = computeAlarmLevel(mr);
-  updateBuzzer(now, level);
-
-  AppReadings readings;
-  readings.tC = dr.tC;
-  readings.rh = dr.rh;
-  readings.dhtOk = dr.ok;
-  readings.mq7Raw = mr.raw;
-  readings.mq7Ratio = mr.ratio;
-  readings.mq7Ppm = mr.ppm;
-  readings.mq7R0 = mr.r0;
-  readings.mq7Ok = mr.ok;
-  readings.mq7Calibrated = mr.calibrated;
-  readings.mq7WarmupDone = mr.warmupDone;
-  readings.mq7Level = static_cast<uint8_t>(level);
-
-  if (mr.ok) {
-    const char* levelText = (level == AlarmLevel::DANGER) ? "DANGER" :
-                            (level == AlarmLevel::WARN) ? "WARN" :
-                            (level == AlarmLevel::OK) ? "OK" : "UNKNOWN";
-    Serial.printf("MQ7 raw=%u vNode=%.3f Rs=%.0f R0=%.0f cal=%s warm=%s ratio=%.3f state=%s CO~%.0fppm\n",
-                  mr.raw, mr.vNode, mr.rs, mr.r0, mr.calibrated ? "Y" : "N",
-                  mr.warmupDone ? "Y" : "N", mr.ratio, levelText, mr.ppm);
-  } else {
-    Serial.printf("MQ7 raw=%u vNode=%.3f R0=%.0f cal=%s warm=%s (warming/low signal)\n",
-                  mr.raw, mr.vNode, mr.r0, mr.calibrated ? "Y" : "N", mr.warmupDone ? "Y" : "N");
+  int8_t calib = pipeline::takeCalibrationResult();
+  if (calib >= 0) {
+    LOGI(SENSOR, "MQ7 calibrate: %s", calib ? "OK" : "FAIL (need warm-up + stable clean air)");
   }
 
-  oled.update(dr.tC, dr.rh, mr.ppm, mr.ratio, mr.ok, mr.calibrated, mr.warmupDone, static_cast<uint8_t>(level));
-  sd.update(now, readings, timeutil::unixTime());
-
-  if (now >= nextSendMs) {
-    nextSendMs = now + SEND_PERIOD_MS;
-
-    net::TelemetryPayload payload{readings, timeutil::unixTime()};
-    bool sent = net::postTelemetry(payload);
-    if (!sent) {
-      Serial.println("Telemetry send failed/skipped");
-    }
-
+  // Print (debug)
+  const uint32_t now = millis();
+  if (CONSOLE_STATUS_MS > 0 && (int32_t)(now - nextStatusMs) >= 0) {
+    nextStatusMs = now + CONSOLE_STATUS_MS;
+    pipeline::SensorSnapshot s = pipeline::latestSensors();
+    AlarmLevel level = static_cast<AlarmLevel>(pipeline::latestReadings().mq7Level);
+    logStatusLine(s.sensors, level);
   }
 
-  delay(250);
+  sched::Deadline next(millis());
+  if (CONSOLE_STATUS_MS > 0) next.at(nextStatusMs);
+  console.sleep(next); // esito della calibrazione: al più SCHED_MAX_SLEEP_MS dopo
 }
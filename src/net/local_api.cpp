@@ -0,0 +1,258 @@
+#include "net/local_api.h"
+#include "app/pipeline.h"
+#include "config.h"
+#include "sensors/board_sensors.h"
+#include "time/time_sync.h"
+
+#include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace net {
+
+static constexpr size_t CHUNK_BYTES = 1024;
+static constexpr size_t HIST_BATCH = 16;
+static constexpr uint32_t STACK_BYTES = 6144;
+static constexpr uint32_t SERVE_BUDGET_US = 100000;
+static constexpr uint16_t IO_TIMEOUT_S = 5; // un client lento non tiene occupato il task a lungo
+static constexpr uint16_t DEFAULT_MINUTES = 30;
+
+static httpd_handle_t server = nullptr;
+static StageStats serveStats;
+static std::atomic<uint32_t> requests{0};
+static std::atomic<uint32_t> errors{0};
+static std::atomic<uint64_t> bytesOut{0};
+
+// Gli handler girano tutti nel task del server, uno alla volta: i buffer
+// dei batch possono essere statici.
+static HistSample rawBatch[HIST_BATCH];
+static HistRollup rollupBatch[HIST_BATCH];
+
+namespace {
+
+// Risposta chunked: accumula in un buffer fisso e manda un chunk quando è pieno.
+class ChunkOut {
+public:
+  explicit ChunkOut(httpd_req_t* req) : req_(req) {}
+
+  void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!ok_) return;
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+      va_list ap;
+      va_start(ap, fmt);
+      const int n = vsnprintf(buf_ + len_, CHUNK_BYTES - len_, fmt, ap);
+      va_end(ap);
+      if (n < 0) break;
+      if ((size_t)n < CHUNK_BYTES - len_) {
+        len_ += n;
+        return;
+      }
+      if (len_ == 0 || !flush_()) break; // non sta nemmeno in un chunk vuoto
+    }
+    ok_ = false;
+  }
+
+  bool finish() {
+    if (ok_ && len_ > 0) flush_();
+    if (ok_ && httpd_resp_send_chunk(req_, nullptr, 0) != ESP_OK) ok_ = false;
+    return ok_;
+  }
+
+  bool ok() const { return ok_; }
+  size_t bytes() const { return total_; }
+
+private:
+  bool flush_() {
+    if (httpd_resp_send_chunk(req_, buf_, len_) != ESP_OK) ok_ = false;
+    total_ += len_;
+    len_ = 0;
+    return ok_;
+  }
+
+  httpd_req_t* req_;
+  char buf_[CHUNK_BYTES];
+  size_t len_ = 0;
+  size_t total_ = 0;
+  bool ok_ = true;
+};
+
+// "null" per NaN, come JSON.stringify lato Node
+const char* jnum(char* buf, size_t cap, float v, uint8_t decimals) {
+  if (!isfinite(v)) return "null";
+  snprintf(buf, cap, "%.*f", decimals, v);
+  return buf;
+}
+
+// Un punto con i campi di normalizePoint() del server Node (schema della
+// board). Per gli storici i campi che HistSample non tiene vanno a null.
+void writePoint(ChunkOut& o, uint32_t ts, const AppReadings& r, bool fromHistory) {
+  o.printf("{\"deviceId\":\"%s\",\"ts\":%lu", DEVICE_ID, (unsigned long)ts);
+  char num[16];
+  for (const FieldDesc& f : READING_FIELDS) {
+    if (fromHistory && !(f.flags & FIELD_HISTORY)) {
+      o.printf(",\"%s\":null", f.json);
+    } else if (f.type == FieldType::BOOL) {
+      o.printf(",\"%s\":%s", f.json, fieldUint(f, r) ? "true" : "false");
+    } else if (f.type == FieldType::F32) {
+      o.printf(",\"%s\":%s", f.json, jnum(num, sizeof(num), fieldFloat(f, r), f.decimals));
+    } else {
+      o.printf(",\"%s\":%lu", f.json, (unsigned long)fieldUint(f, r));
+    }
+  }
+  o.printf(",\"receivedAt\":%llu}", (unsigned long long)ts * 1000ULL);
+}
+
+// Campione o rollup dello storico come AppReadings (NaN dove manca la misura).
+AppReadings histReadings(float tC, float rh, float ratio, float ppm, uint8_t flags, uint8_t level) {
+  AppReadings r;
+  r.tC = tC;
+  r.rh = rh;
+  r.dhtOk = flags & HIST_DHT_OK;
+  r.mq7Ratio = ratio;
+  r.mq7Ppm = ppm;
+  r.mq7Ok = flags & HIST_MQ7_OK;
+  r.mq7Calibrated = flags & HIST_MQ7_CALIBRATED;
+  r.mq7WarmupDone = flags & HIST_MQ7_WARMUP_DONE;
+  r.mq7Level = level;
+  return r;
+}
+
+// ts unix di un istante millis(): quello salvato se valido, altrimenti
+// ricavato dall'ora attuale (0 se l'ora non è ancora sincronizzata).
+uint32_t unixAt(uint32_t savedTs, uint32_t atMs, uint32_t nowMs, uint32_t nowUnix) {
+  if (savedTs) return savedTs;
+  return nowUnix ? nowUnix - (nowMs - atMs) / 1000 : 0;
+}
+
+void beginJson(httpd_req_t* req) {
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*"); // dashboard servita dal server Node
+}
+
+esp_err_t endJson(ChunkOut& o, uint32_t t0) {
+  const bool ok = o.finish();
+  requests.fetch_add(1, std::memory_order_relaxed);
+  if (!ok) errors.fetch_add(1, std::memory_order_relaxed);
+  bytesOut.fetch_add(o.bytes(), std::memory_order_relaxed);
+  serveStats.record(micros() - t0);
+  return ok ? ESP_OK : ESP_FAIL; // ESP_FAIL chiude il socket
+}
+
+esp_err_t latestHandler(httpd_req_t* req) {
+  const uint32_t t0 = micros();
+  beginJson(req);
+  ChunkOut o(req);
+  if (!pipeline::hasReadings()) {
+    o.printf("{\"ok\":false}");
+    return endJson(o, t0);
+  }
+  const AppReadings r = pipeline::latestReadings();
+  writePoint(o, timeutil::unixAt(r.atUs), r, false);
+  return endJson(o, t0);
+}
+
+uint16_t queryMinutes(httpd_req_t* req) {
+  char query[64], val[12];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) return DEFAULT_MINUTES;
+  if (httpd_query_key_value(query, "minutes", val, sizeof(val)) != ESP_OK) return DEFAULT_MINUTES;
+  const long m = atol(val);
+  if (m < 1) return 1;
+  return m > LOCAL_API_HISTORY_MAX_MINUTES ? LOCAL_API_HISTORY_MAX_MINUTES : (uint16_t)m;
+}
+
+esp_err_t historyHandler(httpd_req_t* req) {
+  const uint32_t t0 = micros();
+  const uint16_t minutes = queryMinutes(req);
+  const History& hist = pipeline::history();
+  const uint32_t nowMs = millis();
+  const uint32_t nowUnix = timeutil::unixTime();
+  const uint32_t windowMs = (uint32_t)minutes * History::MINUTE_MS;
+  uint32_t after = nowMs - windowMs;
+
+  beginJson(req);
+  ChunkOut o(req);
+  // count va in fondo: si conosce solo a fine streaming
+  o.printf("{\"minutes\":%u,\"points\":[", (unsigned)minutes);
+  uint32_t count = 0;
+  size_t n;
+  if (windowMs <= hist.rawSpanMs()) {
+    do {
+      n = hist.copyRaw(rawBatch, HIST_BATCH, after);
+      for (size_t i = 0; i < n; i++) {
+        const HistSample& s = rawBatch[i];
+        if (count++) o.printf(",");
+        writePoint(o, unixAt(s.ts, s.ms, nowMs, nowUnix), histReadings(s.tC, s.rh, s.ratio, s.ppm, s.flags, s.level),
+                   true);
+      }
+      if (n) after = rawBatch[n - 1].ms;
+    } while (n == HIST_BATCH && o.ok());
+  } else {
+    // Finestra più lunga del ring grezzo: un punto per minuto (medie).
+    do {
+      n = hist.copyMinutes(rollupBatch, HIST_BATCH, after);
+      for (size_t i = 0; i < n; i++) {
+        const HistRollup& m = rollupBatch[i];
+        if (count++) o.printf(",");
+        writePoint(o, unixAt(m.ts, m.startMs, nowMs, nowUnix),
+                   histReadings(m.tC.mean(), m.rh.mean(), m.ratio.mean(), m.ppm.mean(), m.flags, m.maxLevel), true);
+      }
+      if (n) after = rollupBatch[n - 1].startMs;
+    } while (n == HIST_BATCH && o.ok());
+  }
+  o.printf("],\"count\":%lu}", (unsigned long)count);
+  return endJson(o, t0);
+}
+
+} // namespace
+
+bool localApiBegin() {
+  if (server) return true;
+  serveStats.budgetUs = SERVE_BUDGET_US;
+
+  httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+  cfg.server_port = LOCAL_API_PORT;
+  cfg.max_open_sockets = LOCAL_API_MAX_CLIENTS;
+  cfg.lru_purge_enable = true;
+  cfg.max_uri_handlers = 2;
+  cfg.core_id = 0;                           // lontano da sensori e allarme (core 1)
+  cfg.task_priority = tskIDLE_PRIORITY + 1;  // sotto tutti i task della pipeline
+  cfg.stack_size = STACK_BYTES;
+  cfg.recv_wait_timeout = IO_TIMEOUT_S;
+  cfg.send_wait_timeout = IO_TIMEOUT_S;
+  if (httpd_start(&server, &cfg) != ESP_OK) {
+    server = nullptr;
+    return false;
+  }
+
+  httpd_uri_t latest = {};
+  latest.uri = "/api/v1/latest";
+  latest.method = HTTP_GET;
+  latest.handler = latestHandler;
+  httpd_register_uri_handler(server, &latest);
+
+  httpd_uri_t history = {};
+  history.uri = "/api/v1/history";
+  history.method = HTTP_GET;
+  history.handler = historyHandler;
+  httpd_register_uri_handler(server, &history);
+  return true;
+}
+
+bool localApiRunning() { return server != nullptr; }
+
+const StageStats& localApiStats() { return serveStats; }
+
+void printLocalApiStats(Print& out) {
+  out.printf("http: %s requests=%u errors=%u bytes=%llu last=%uus p95=%uus max=%uus\n", server ? "up" : "down",
+             (unsigned)requests.load(), (unsigned)errors.load(), (unsigned long long)bytesOut.load(),
+             (unsigned)serveStats.lastUs.load(), (unsigned)serveStats.percentileUs(95),
+             (unsigned)serveStats.maxUs.load());
+}
+
+} // namespace net
@@ -1,49 +1,236 @@
 #include "net/telemetry_client.h"
 #include "net/wifi_manager.h"
 #include "config.h"
+#include "net/telemetry_codec.h"
+#include "time/time_sync.h"
+#include "util/seqlock.h"
+#include "util/log.h"
 
 #include <HTTPClient.h>
+#include <WiFi.h>
 #include <ArduinoJson.h>
 
 namespace net {
 
+// Connessione persistente: stesso WiFiClient riusato (keep-alive) finché il
+// server non la chiude. Usata solo dal task che invia.
+static WiFiClient tcp;
+static HTTPClient http;
+static bool httpInited = false;
+
+// Formato negoziato: passa al binario quando il server lo annuncia in Accept-Post.
+static bool useBinary = false;
+static uint8_t binBuf[TELEMETRY_BIN_MAX_HEADER + TELEMETRY_BIN_MAX_TRACE +
+                      (TELEMETRY_BIN_MAX_RECORD + TELEMETRY_BIN_MAX_TRACE_RECORD) * TELEMETRY_BATCH_MAX];
+static char jsonBuf[TELEMETRY_JSON_MAX_HEADER + TELEMETRY_JSON_MAX_POINT * TELEMETRY_BATCH_MAX];
+static const char* const COLLECT_HEADERS[] = {"Accept-Post"};
+
+// Tracce dell'ultimo batch con risposta: viaggiano col batch successivo.
+static uint32_t lastSendUs = 0;
+static uint32_t lastAckUs = 0;
+
+static ConnectionStats connStats;
+static SeqLock<ConnectionStats> connStatsSnap;
+
+// "http://host[:porta]/..." -> host e porta (per aprire la connessione a mano).
+static bool hostPort(const char* url, char* host, size_t cap, uint16_t& port) {
+  if (strncmp(url, "http://", 7) != 0) return false;
+  const char* h = url + 7;
+  const size_t end = strcspn(h, ":/");
+  if (end == 0 || end >= cap) return false;
+  memcpy(host, h, end);
+  host[end] = '\0';
+  port = h[end] == ':' ? (uint16_t)atoi(h + end + 1) : 80;
+  return port != 0;
+}
+
+// POST sulla connessione persistente entro TELEMETRY_REQUEST_BUDGET_MS: una
+// sola scadenza per connect, invio + attesa degli header e lettura del corpo.
+// Il connect lo fa questa funzione (HTTPClient con reuse usa il socket già
+// aperto), così l'attesa della risposta parte da quel che resta del budget.
+// La risposta (piccola) finisce in resp senza passare da getString().
+static int postKeepAlive(const char* url, const char* contentType, const uint8_t* body, size_t len,
+                         char* resp, size_t respSize) {
+  if (!httpInited) {
+    http.setReuse(true);
+    http.collectHeaders(const_cast<const char**>(COLLECT_HEADERS), 1);
+    httpInited = true;
+  }
+  const uint32_t t0 = millis();
+  auto left = [t0]() -> uint32_t {
+    const uint32_t spent = millis() - t0;
+    return spent < TELEMETRY_REQUEST_BUDGET_MS ? TELEMETRY_REQUEST_BUDGET_MS - spent : 0;
+  };
+
+  int code = 0;
+  if (!tcp.connected()) {
+    connStats.connects++;
+    char host[64];
+    uint16_t port = 0;
+    if (!hostPort(url, host, sizeof(host), port) || !tcp.connect(host, port, (int32_t)left())) {
+      code = HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+  }
+  if (code == 0 && left() == 0) code = HTTPC_ERROR_READ_TIMEOUT;
+
+  size_t got = 0;
+  if (code == 0) {
+    http.setTimeout((uint16_t)left()); // invio del corpo e attesa degli header
+    http.begin(tcp, url);
+    http.addHeader("Content-Type", contentType);
+    http.addHeader("Authorization", String("Bearer ") + DEVICE_TOKEN);
+    code = http.POST(const_cast<uint8_t*>(body), len);
+  }
+
+  if (code > 0) {
+    if (TELEMETRY_BINARY && http.hasHeader("Accept-Post")) {
+      useBinary = http.header("Accept-Post").indexOf(TELEMETRY_BIN_CONTENT_TYPE) >= 0;
+    }
+
+    int respLen = http.getSize(); // -1 se chunked/sconosciuta
+    WiFiClient* s = http.getStreamPtr();
+    while (s && got + 1 < respSize && (respLen < 0 || got < (size_t)respLen) && left() > 0) {
+      if (s->available()) {
+        resp[got++] = (char)s->read();
+      } else if (!s->connected()) {
+        break;
+      } else {
+        delay(1);
+      }
+    }
+    // budget finito prima del corpo atteso: risposta incompleta, la richiesta è fallita
+    if (respLen > 0 && got < (size_t)respLen && got + 1 < respSize) code = HTTPC_ERROR_READ_TIMEOUT;
+  }
+  resp[got] = '\0';
+  http.end(); // con reuse lascia aperto il socket se il server lo consente
+
+  const uint32_t rtt = millis() - t0;
+  connStats.requests++;
+  connStats.lastRttMs = rtt;
+  if (rtt > connStats.maxRttMs) connStats.maxRttMs = rtt;
+  connStats.totalRttMs += rtt;
+  connStats.bytesSent += len;
+  if (code < 200 || code >= 300) {
+    connStats.failures++;
+    tcp.stop(); // stato della connessione incerto: la prossima riapre
+  }
+  connStatsSnap.write(connStats);
+  return code;
+}
+
 bool postTelemetry(const TelemetryPayload& p) {
   if (!wifiIsConnected()) return false;
 
-  HTTPClient http;
-  http.begin(TELEMETRY_URL);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("Authorization", String("Bearer ") + DEVICE_TOKEN);
-
-  StaticJsonDocument<512> doc;
-  doc["deviceId"] = DEVICE_ID;
-  doc["ts"] = p.ts;
-  doc["t"] = p.readings.tC;
-  doc["rh"] = p.readings.rh;
-  doc["dhtOk"] = p.readings.dhtOk;
-  doc["mq7Raw"] = p.readings.mq7Raw;
-  doc["mq7Ratio"] = p.readings.mq7Ratio;
-  doc["mq7Ppm"] = p.readings.mq7Ppm;
-  doc["mq7R0"] = p.readings.mq7R0;
-  doc["mq7Ok"] = p.readings.mq7Ok;
-  doc["mq7Calibrated"] = p.readings.mq7Calibrated;
-  doc["mq7WarmupDone"] = p.readings.mq7WarmupDone;
-  doc["mq7Level"] = p.readings.mq7Level;
-
-  String body;
-  serializeJson(doc, body);
-
-  int code = http.POST(body);
-  String resp = http.getString();
-  http.end();
+  size_t len = encodeJsonPoint(DEVICE_ID, p, jsonBuf, sizeof(jsonBuf));
+  if (len == 0) return false;
+
+  char resp[128];
+  int code = postKeepAlive(TELEMETRY_URL, "application/json", reinterpret_cast<const uint8_t*>(jsonBuf), len, resp,
+                           sizeof(resp));
 
   if (code < 0) {
-    Serial.printf("HTTP error: %d\n", code);
+    LOGW(NET, "HTTP error: %d", code);
     return false;
   }
 
-  Serial.printf("POST %d | %s\n", code, resp.c_str());
+  LOGI(NET, "POST %d | %s", code, resp);
   return code >= 200 && code < 300;
 }
 
+// 4xx legati al batch stesso. Restano da ritentare 401/403 (token: si
+// sistema lato server, i dati sono buoni), 408, 429 e 415 (gestito sopra).
+static bool permanentReject(int code) {
+  return code >= 400 && code < 500 && code != 401 && code != 403 && code != 408 && code != 415 && code != 429;
+}
+
+bool binaryNegotiated() {
+  return useBinary;
+}
+
+BatchResult postTelemetryBatch(const TelemetryPayload* items, size_t n, size_t& accepted) {
+  accepted = 0;
+  if (n == 0) return BatchResult::OK;
+  if (!wifiIsConnected()) return BatchResult::RETRY;
+
+  char resp[128];
+  int code = 0;
+  bool sent = false;
+  BatchTrace trace;
+  trace.encodeUs = hal::monoUs();
+  trace.atMs = timeutil::unixUsAt(trace.encodeUs) / 1000;
+  trace.prevSendUs = lastSendUs;
+  trace.prevAckUs = lastAckUs;
+  uint64_t sendUs = 0;
+
+  if (useBinary) {
+    size_t len = encodeBinaryBatch(DEVICE_ID, items, n, binBuf, sizeof(binBuf), &trace);
+    if (len > 0) {
+      sendUs = hal::monoUs();
+      code = postKeepAlive(TELEMETRY_BATCH_URL, TELEMETRY_BIN_CONTENT_TYPE, binBuf, len, resp, sizeof(resp));
+      sent = code != 415;
+      if (!sent) useBinary = false; // il server non lo accetta più: torna al JSON
+    }
+  }
+
+  if (!sent) {
+    size_t len = encodeJsonBatch(DEVICE_ID, items, n, jsonBuf, sizeof(jsonBuf), &trace);
+    if (len == 0) {
+      LOGW(NET, "POST batch: %u points do not fit the JSON buffer", (unsigned)n);
+      return BatchResult::REJECTED;
+    }
+    sendUs = hal::monoUs();
+    code = postKeepAlive(TELEMETRY_BATCH_URL, "application/json", reinterpret_cast<const uint8_t*>(jsonBuf), len, resp,
+                         sizeof(resp));
+  }
+
+  if (code > 0) {
+    lastSendUs = (uint32_t)(sendUs - trace.encodeUs);
+    lastAckUs = (uint32_t)(hal::monoUs() - sendUs);
+  }
+
+  if (code < 0) {
+    LOGW(NET, "HTTP error: %d", code);
+    return BatchResult::RETRY;
+  }
+  if (code < 200 || code >= 300) {
+    LOGW(NET, "POST batch %d | %s", code, resp);
+    return permanentReject(code) ? BatchResult::REJECTED : BatchResult::RETRY;
+  }
+
+  // Ack: il server conferma quanti punti (in ordine) ha accettato.
+  JsonDocument ackDoc;
+  if (deserializeJson(ackDoc, resp) != DeserializationError::Ok) return BatchResult::RETRY;
+  size_t nOk = ackDoc["accepted"] | 0u;
+  accepted = nOk > n ? n : nOk;
+  LOGI(NET, "POST batch %d | %u/%u accepted", code, (unsigned)accepted, (unsigned)n);
+  return accepted == n ? BatchResult::OK : BatchResult::RETRY;
+}
+
+bool postMetrics(const char* json, size_t len) {
+  if (!wifiIsConnected()) return false;
+
+  char resp[64];
+  int code = postKeepAlive(TELEMETRY_METRICS_URL, "application/json", reinterpret_cast<const uint8_t*>(json), len,
+                           resp, sizeof(resp));
+  if (code < 200 || code >= 300) {
+    LOGW(NET, "POST metrics %d", code);
+    return false;
+  }
+  return true;
+}
+
+ConnectionStats connectionStats() {
+  ConnectionStats s;
+  connStatsSnap.read(s);
+  return s;
+}
+
+void printConnectionStats(Print& out) {
+  ConnectionStats s = connectionStats();
+  uint32_t avg = s.requests ? (uint32_t)(s.totalRttMs / s.requests) : 0;
+  out.printf("http: req=%u fail=%u connects=%u rtt last=%ums avg=%ums max=%ums sent=%llu B\n",
+             (unsigned)s.requests, (unsigned)s.failures, (unsigned)s.connects, (unsigned)s.lastRttMs,
+             (unsigned)avg, (unsigned)s.maxRttMs, (unsigned long long)s.bytesSent);
+}
+
 } // namespace net
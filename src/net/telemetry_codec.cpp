@@ -0,0 +1,203 @@
+#include "net/telemetry_codec.h"
+#include "sensors/board_sensors.h"
+#include <ArduinoJson.h>
+#include <math.h>
+#include <string.h>
+
+namespace net {
+
+namespace {
+
+struct Writer {
+  uint8_t* p;
+  size_t cap;
+  size_t len = 0;
+  bool ok = true;
+
+  void u8(uint8_t v) {
+    if (len >= cap) {
+      ok = false;
+      return;
+    }
+    p[len++] = v;
+  }
+  void u16(uint16_t v) {
+    u8((uint8_t)v);
+    u8((uint8_t)(v >> 8));
+  }
+  void u32(uint32_t v) {
+    u16((uint16_t)v);
+    u16((uint16_t)(v >> 16));
+  }
+  void varint(uint32_t v) {
+    while (v >= 0x80) {
+      u8((uint8_t)(v | 0x80));
+      v >>= 7;
+    }
+    u8((uint8_t)v);
+  }
+};
+
+// Intervallo saturato: 1 + valore deve stare in un varint a 32 bit.
+uint32_t spanUs(uint64_t from, uint64_t to) {
+  if (to <= from) return 0;
+  return to - from >= 0xFFFFFFFEu ? 0xFFFFFFFEu : (uint32_t)(to - from);
+}
+
+// Tracce solo per letture di questo boot passate da allarme e coda.
+bool traced(const TelemetryPayload& p, const BatchTrace& t) {
+  return p.readings.atUs != 0 && p.readings.alarmUs != 0 && p.queuedUs != 0 && p.queuedUs <= t.encodeUs;
+}
+
+uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+
+uint16_t scaledU16(float v, float scale) {
+  if (!isfinite(v)) return 0xFFFF;
+  float s = v * scale + 0.5f;
+  if (s <= 0.0f) return 0;
+  if (s >= 65534.0f) return 0xFFFE;
+  return (uint16_t)s;
+}
+
+int16_t scaledI16(float v, float scale) {
+  if (!isfinite(v)) return INT16_MIN;
+  float s = v * scale;
+  s += (s >= 0.0f) ? 0.5f : -0.5f;
+  if (s <= -32767.0f) return -32767;
+  if (s >= 32767.0f) return 32767;
+  return (int16_t)s;
+}
+
+void fillPoint(JsonObject o, const TelemetryPayload& p) {
+  o["ts"] = p.ts;
+  for (const FieldDesc& f : READING_FIELDS) {
+    switch (f.type) {
+    case FieldType::F32:
+      o[f.json] = fieldFloat(f, p.readings); // NaN -> null
+      break;
+    case FieldType::BOOL:
+      o[f.json] = fieldUint(f, p.readings) != 0;
+      break;
+    default:
+      o[f.json] = fieldUint(f, p.readings);
+      break;
+    }
+  }
+}
+
+void fillTrace(JsonObject o, const TelemetryPayload& p, const BatchTrace& t) {
+  if (!traced(p, t)) return;
+  JsonObject tr = o["trace"].to<JsonObject>();
+  tr["alarmUs"] = spanUs(p.readings.atUs, p.readings.alarmUs);
+  tr["queueUs"] = spanUs(p.readings.alarmUs, p.queuedUs);
+  tr["encodeUs"] = spanUs(p.queuedUs, t.encodeUs);
+}
+
+// Byte massimi di un record: dTs varint + flags + campi di WIRE_V1_FIELDS.
+constexpr size_t wireRecordMax() {
+  size_t n = 5 + 1;
+  for (const FieldDesc& f : WIRE_V1_FIELDS) {
+    if (f.bin == BinEnc::I16 || f.bin == BinEnc::U16) n += 2;
+    else if (f.bin == BinEnc::VARINT) n += 5;
+  }
+  return n;
+}
+static_assert(wireRecordMax() == TELEMETRY_BIN_MAX_RECORD, "TELEMETRY_BIN_MAX_RECORD non segue lo schema");
+
+// serializeJson tronca senza errore: prima si misura.
+size_t serializeInto(const JsonDocument& doc, char* out, size_t cap) {
+  if (measureJson(doc) >= cap) return 0;
+  return serializeJson(doc, out, cap);
+}
+
+} // namespace
+
+size_t encodeJsonPoint(const char* deviceId, const TelemetryPayload& p, char* out, size_t cap) {
+  JsonDocument doc;
+  JsonObject o = doc.to<JsonObject>();
+  o["deviceId"] = deviceId;
+  fillPoint(o, p);
+  return serializeInto(doc, out, cap);
+}
+
+size_t encodeJsonBatch(const char* deviceId, const TelemetryPayload* items, size_t n, char* out, size_t cap,
+                       const BatchTrace* trace) {
+  JsonDocument doc;
+  doc["deviceId"] = deviceId;
+  if (trace) {
+    JsonObject send = doc["send"].to<JsonObject>();
+    send["atMs"] = trace->atMs;
+    send["prevSendUs"] = trace->prevSendUs;
+    send["prevAckUs"] = trace->prevAckUs;
+  }
+  JsonArray points = doc["points"].to<JsonArray>();
+  for (size_t i = 0; i < n; i++) {
+    JsonObject o = points.add<JsonObject>();
+    fillPoint(o, items[i]);
+    if (trace) fillTrace(o, items[i], *trace);
+  }
+  return serializeInto(doc, out, cap);
+}
+
+size_t encodeBinaryBatch(const char* deviceId, const TelemetryPayload* items, size_t n, uint8_t* out, size_t cap,
+                         const BatchTrace* trace) {
+  if (n == 0 || n > 255) return 0;
+  size_t idLen = strlen(deviceId);
+  if (idLen > 255) idLen = 255;
+
+  Writer w{out, cap};
+  w.u8('E');
+  w.u8('M');
+  w.u8(TELEMETRY_BIN_VERSION);
+  w.u8((uint8_t)n);
+  w.u8((uint8_t)idLen);
+  for (size_t i = 0; i < idLen; i++) w.u8((uint8_t)deviceId[i]);
+  w.u32(items[0].ts);
+
+  uint32_t prevTs = items[0].ts;
+  for (size_t i = 0; i < n; i++) {
+    const AppReadings& r = items[i].readings;
+    w.varint(zigzag((int32_t)(items[i].ts - prevTs)));
+    prevTs = items[i].ts;
+
+    w.u8(packFlags(WIRE_V1_FIELDS, r));
+    for (const FieldDesc& f : WIRE_V1_FIELDS) {
+      const float v = fieldFloat(f, r);
+      switch (f.bin) {
+      case BinEnc::I16:
+        w.u16((uint16_t)scaledI16(v, f.binScale));
+        break;
+      case BinEnc::U16:
+        w.u16(scaledU16(v, f.binScale));
+        break;
+      case BinEnc::VARINT:
+        w.varint((isfinite(v) && v >= 1.0f) ? (uint32_t)(v * f.binScale + 0.5f) : 0);
+        break;
+      default:
+        break; // FLAG: già nel byte flags
+      }
+    }
+  }
+
+  if (trace) {
+    w.u8('T');
+    w.u32((uint32_t)trace->atMs);
+    w.u32((uint32_t)(trace->atMs >> 32));
+    w.varint(trace->prevSendUs);
+    w.varint(trace->prevAckUs);
+    for (size_t i = 0; i < n; i++) {
+      const TelemetryPayload& p = items[i];
+      if (!traced(p, *trace)) {
+        w.varint(0);
+        continue;
+      }
+      w.varint(1 + spanUs(p.readings.atUs, p.readings.alarmUs));
+      w.varint(spanUs(p.readings.alarmUs, p.queuedUs));
+      w.varint(spanUs(p.queuedUs, trace->encodeUs));
+    }
+  }
+
+  return w.ok ? w.len : 0;
+}
+
+} // namespace net
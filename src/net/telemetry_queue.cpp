@@ -0,0 +1,194 @@
+#include "net/telemetry_queue.h"
+
+#include "hal/hal_fs.h"
+#include "time/time_sync.h"
+#include "util/log.h"
+
+namespace net {
+
+// Layout file: header fisso + record TelemetryPayload grezzi in append.
+// Il header tiene l'indice del primo record non confermato, così la coda
+// sopravvive a un riavvio senza riscrivere il file.
+struct SpillHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t readIndex;
+};
+
+static constexpr uint32_t SPILL_MAGIC = 0x51544E45; // "ENTQ"
+static constexpr uint16_t SPILL_VERSION = 3; // 2: AppReadings con atUs, 3: tracce di latenza
+static constexpr size_t REC_SIZE = sizeof(TelemetryPayload);
+
+// Copia della compattazione, a blocchi di record (statico: stack del task rete piccolo).
+static constexpr size_t COMPACT_CHUNK = 8;
+static uint8_t compactBuf[COMPACT_CHUNK * REC_SIZE];
+
+static void resolveTs(TelemetryPayload& p) {
+  if (p.ts == 0 && p.readings.atUs != 0) p.ts = timeutil::unixAt(p.readings.atUs);
+}
+
+void TelemetryQueue::begin(bool sdReady) {
+  sdReady_ = sdReady;
+  if (!sdReady_ || !hal::fsExists(TQ_SPILL_PATH)) return;
+
+  hal::File f;
+  SpillHeader h{};
+  bool valid = f.open(TQ_SPILL_PATH, "r") && f.read(&h, sizeof(h)) == sizeof(h) &&
+               h.magic == SPILL_MAGIC && h.version == SPILL_VERSION && h.recordSize == REC_SIZE;
+  uint32_t total = valid ? (uint32_t)((f.size() - sizeof(h)) / REC_SIZE) : 0;
+  f.close();
+
+  if (!valid || h.readIndex >= total) {
+    clearSpill_();
+    return;
+  }
+
+  spillRead_ = h.readIndex;
+  spillCount_ = total - h.readIndex;
+  bootStart_ = total;
+  spillAtMs_ = hal::millis();
+  LOGI(NET, "Telemetry queue: %u records pending on SD", (unsigned)spillCount_);
+}
+
+void TelemetryQueue::push(const TelemetryPayload& p) {
+  if (ramCount_ == TQ_RAM_CAPACITY && !spillRam_()) {
+    // SD assente o piena: scarta il più vecchio in RAM
+    ramHead_ = (ramHead_ + 1) % TQ_RAM_CAPACITY;
+    ramCount_--;
+    dropped_++;
+  }
+  const size_t i = (ramHead_ + ramCount_) % TQ_RAM_CAPACITY;
+  ram_[i] = p;
+  ramAtMs_[i] = hal::millis();
+  ramCount_++;
+}
+
+size_t TelemetryQueue::peek(TelemetryPayload* out, size_t maxN) {
+  size_t n = 0;
+
+  if (spillCount_ > 0) {
+    hal::File f;
+    if (!f.open(TQ_SPILL_PATH, "r")) return 0;
+    f.seek(sizeof(SpillHeader) + (size_t)spillRead_ * REC_SIZE);
+    size_t want = maxN < spillCount_ ? maxN : spillCount_;
+    n = f.read(out, want * REC_SIZE) / REC_SIZE;
+    for (size_t i = 0; i < n; i++) {
+      if (spillRead_ + i >= bootStart_) resolveTs(out[i]);
+      else out[i].queuedUs = 0; // istanti di un altro boot: niente tracce
+    }
+    return n; // non mescolare spill e RAM nello stesso batch
+  }
+
+  while (n < maxN && n < ramCount_) {
+    out[n] = ram_[(ramHead_ + n) % TQ_RAM_CAPACITY];
+    resolveTs(out[n]);
+    n++;
+  }
+  return n;
+}
+
+void TelemetryQueue::ack(size_t n) {
+  if (spillCount_ > 0) {
+    if (n > spillCount_) n = spillCount_;
+    spillRead_ += n;
+    spillCount_ -= n;
+    if (spillCount_ == 0) clearSpill_();
+    else writeSpillHeader_();
+  } else {
+    if (n > ramCount_) n = ramCount_;
+    ramHead_ = (ramHead_ + n) % TQ_RAM_CAPACITY;
+    ramCount_ -= n;
+  }
+}
+
+void TelemetryQueue::reject(size_t n) {
+  if (n > size()) n = size();
+  // ack() toglie dal file o dalla RAM, non da entrambi in una volta
+  const size_t fromSpill = n < spillCount_ ? n : spillCount_;
+  if (fromSpill > 0) ack(fromSpill);
+  if (n > fromSpill) ack(n - fromSpill);
+}
+
+bool TelemetryQueue::spillRam_() {
+  if (!sdReady_) return false;
+
+  if (spillRead_ >= TQ_SPILL_COMPACT_MIN && spillRead_ >= spillCount_ && !compactSpill_()) {
+    LOGW(NET, "Telemetry queue: spill compaction failed");
+  }
+
+  if (spillCount_ == 0 && !hal::fsExists(TQ_SPILL_PATH)) {
+    spillRead_ = 0;
+    if (!writeSpillHeader_()) return false;
+  }
+
+  hal::File f;
+  if (!f.open(TQ_SPILL_PATH, "a")) return false;
+  if (spillCount_ == 0) spillAtMs_ = ramAtMs_[ramHead_];
+  size_t written = 0;
+  while (ramCount_ > 0) {
+    if (f.write(&ram_[ramHead_], REC_SIZE) != REC_SIZE) break;
+    ramHead_ = (ramHead_ + 1) % TQ_RAM_CAPACITY;
+    ramCount_--;
+    written++;
+  }
+  f.close();
+  spillCount_ += written;
+
+  // Limite del file: avanza l'indice di lettura (scarta i più vecchi).
+  if (spillCount_ > TQ_SPILL_MAX_RECORDS) {
+    uint32_t excess = spillCount_ - TQ_SPILL_MAX_RECORDS;
+    spillRead_ += excess;
+    spillCount_ -= excess;
+    dropped_ += excess;
+  }
+  writeSpillHeader_();
+  return written > 0;
+}
+
+bool TelemetryQueue::writeSpillHeader_() {
+  SpillHeader h{SPILL_MAGIC, SPILL_VERSION, (uint16_t)REC_SIZE, spillRead_};
+  // "r+" per riscrivere solo il header senza troncare i record
+  hal::File f;
+  if (!f.open(TQ_SPILL_PATH, hal::fsExists(TQ_SPILL_PATH) ? "r+" : "w")) return false;
+  return f.write(&h, sizeof(h)) == sizeof(h);
+}
+
+// Riscrive il file con i soli record non confermati. Se qualcosa va storto
+// resta il file vecchio (il temporaneo si butta).
+bool TelemetryQueue::compactSpill_() {
+  hal::File in, out;
+  if (!in.open(TQ_SPILL_PATH, "r") || !out.open(TQ_SPILL_TMP_PATH, "w")) return false;
+  const SpillHeader h{SPILL_MAGIC, SPILL_VERSION, (uint16_t)REC_SIZE, 0};
+  bool ok = out.write(&h, sizeof(h)) == sizeof(h) && in.seek(sizeof(SpillHeader) + (size_t)spillRead_ * REC_SIZE);
+  for (uint32_t left = spillCount_; ok && left > 0;) {
+    const size_t n = left < COMPACT_CHUNK ? left : COMPACT_CHUNK;
+    ok = in.read(compactBuf, n * REC_SIZE) == n * REC_SIZE && out.write(compactBuf, n * REC_SIZE) == n * REC_SIZE;
+    left -= n;
+  }
+  in.close();
+  out.close();
+  if (!ok) {
+    hal::fsRemove(TQ_SPILL_TMP_PATH);
+    return false;
+  }
+  hal::fsRemove(TQ_SPILL_PATH);
+  if (!hal::fsRename(TQ_SPILL_TMP_PATH, TQ_SPILL_PATH)) { // spill perso: la coda riparte dalla RAM
+    dropped_ += spillCount_;
+    clearSpill_();
+    hal::fsRemove(TQ_SPILL_TMP_PATH);
+    return false;
+  }
+  bootStart_ = bootStart_ > spillRead_ ? bootStart_ - spillRead_ : 0;
+  spillRead_ = 0;
+  return true;
+}
+
+void TelemetryQueue::clearSpill_() {
+  if (sdReady_) hal::fsRemove(TQ_SPILL_PATH);
+  spillRead_ = 0;
+  spillCount_ = 0;
+  bootStart_ = 0;
+}
+
+} // namespace net
@@ -0,0 +1,73 @@
+#include "net/telemetry_sender.h"
+
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace net {
+
+void TelemetrySender::begin() {
+  if (task_) return;
+  TaskHandle_t h = nullptr;
+  xTaskCreatePinnedToCore(taskEntry_, "tx", 8192, this, 1, &h, 0);
+  task_ = h;
+}
+
+bool TelemetrySender::submit(const TelemetryPayload* items, size_t n) {
+  if (!task_ || n == 0 || busy()) return false;
+  if (n > TELEMETRY_BATCH_MAX) n = TELEMETRY_BATCH_MAX;
+  for (size_t i = 0; i < n; i++) items_[i] = items[i];
+  count_ = n;
+  metricsLen_ = 0;
+  return start_();
+}
+
+bool TelemetrySender::submitMetrics(const char* json, size_t len) {
+  if (!task_ || len == 0 || len > sizeof(metrics_) || busy()) return false;
+  memcpy(metrics_, json, len);
+  metricsLen_ = len;
+  count_ = 0;
+  return start_();
+}
+
+bool TelemetrySender::start_() {
+  state_.store(PENDING, std::memory_order_release);
+  xTaskNotifyGive(static_cast<TaskHandle_t>(task_));
+  return true;
+}
+
+bool TelemetrySender::poll(SendResult& out) {
+  if (state_.load(std::memory_order_acquire) != DONE) return false;
+  out = result_;
+  state_.store(IDLE, std::memory_order_release);
+  return true;
+}
+
+void TelemetrySender::taskEntry_(void* arg) {
+  static_cast<TelemetrySender*>(arg)->run_();
+}
+
+void TelemetrySender::run_() {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (state_.load(std::memory_order_acquire) != PENDING) continue;
+
+    const uint32_t t0 = millis();
+    SendResult r;
+    if (metricsLen_ > 0) {
+      r.metrics = true;
+      r.ok = postMetrics(metrics_, metricsLen_);
+    } else {
+      r.submitted = count_;
+      const BatchResult br = postTelemetryBatch(items_, count_, r.accepted);
+      r.ok = br == BatchResult::OK;
+      r.rejected = br == BatchResult::REJECTED;
+    }
+    r.rttMs = millis() - t0;
+    r.doneUs = hal::monoUs();
+    result_ = r;
+    state_.store(DONE, std::memory_order_release);
+  }
+}
+
+} // namespace net
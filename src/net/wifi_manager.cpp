@@ -1,16 +1,126 @@
 #include "net/wifi_manager.h"
 #include <WiFi.h>
 #include "config.h"
+#include "hal/hal.h"
+#include "util/log.h"
+
+#include <atomic>
+#include <string.h>
 
 namespace net {
 
+static constexpr const char* KEY_AP = "wifi_ap";
+static constexpr uint8_t AP_VERSION = 1;
+
+// Ultimo AP associato. BSSID + canale evitano la scansione di tutti i canali;
+// l'IP serve solo con WIFI_CACHE_IP. Niente padding: si confronta con memcmp.
+struct ApCache {
+  uint8_t version;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint32_t ssidHash; // SSID cambiato in config.h = cache da buttare
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t mask;
+  uint32_t dns;
+};
+static_assert(sizeof(ApCache) == 28, "ApCache: layout fisso in NVS");
+
+static ApCache ap{};
+static bool apValid = false;
+static bool fastAttempt = false; // tentativo in corso con BSSID/canale in cache
+static bool up = false;          // ultimo stato visto da wifiEnsureConnected()
+static uint32_t attemptMs = 0;
 static uint32_t nextTryMs = 0;
+static uint32_t retryMs = WIFI_RETRY_MIN_MS;
+static std::atomic<uint32_t> gotIpMs{0}; // dal task eventi del WiFi
+static std::atomic<void (*)()> onUp{nullptr};
+static WifiStats st;
+
+static uint32_t ssidHash() { // FNV-1a
+  uint32_t h = 2166136261u;
+  for (const char* p = WIFI_SSID; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+  return h;
+}
+
+static void onGotIp(arduino_event_id_t) {
+  gotIpMs.store(millis());
+  void (*fn)() = onUp.load();
+  if (fn) fn();
+}
+
+static void loadAp() {
+  ApCache c{};
+  apValid = hal::nvsBegin() && hal::nvsGetBytes(KEY_AP, &c, sizeof(c)) == sizeof(c) && c.version == AP_VERSION &&
+            c.ssidHash == ssidHash() && c.channel != 0;
+  if (apValid) ap = c;
+}
+
+static void saveAp() {
+  const uint8_t* bssid = WiFi.BSSID();
+  if (!bssid) return;
+  ApCache c{};
+  c.version = AP_VERSION;
+  c.channel = (uint8_t)WiFi.channel();
+  memcpy(c.bssid, bssid, sizeof(c.bssid));
+  c.ssidHash = ssidHash();
+  c.ip = WiFi.localIP();
+  c.gateway = WiFi.gatewayIP();
+  c.mask = WiFi.subnetMask();
+  c.dns = WiFi.dnsIP();
+  if (apValid && memcmp(&c, &ap, sizeof(c)) == 0) return; // stesso AP: nessuna scrittura in flash
+  ap = c;
+  apValid = true;
+  if (hal::nvsBegin()) hal::nvsPutBytes(KEY_AP, &ap, sizeof(ap));
+}
+
+static void connect(uint32_t nowMs) {
+  attemptMs = nowMs;
+  gotIpMs.store(0);
+  st.attempts++;
+  fastAttempt = WIFI_FAST_CONNECT && apValid;
+  if (WIFI_CACHE_IP) { // IP del lease precedente; tutto a 0.0.0.0 = di nuovo DHCP
+    static const ApCache none{};
+    const ApCache& a = fastAttempt && ap.ip != 0 ? ap : none;
+    WiFi.config(IPAddress(a.ip), IPAddress(a.gateway), IPAddress(a.mask), IPAddress(a.dns));
+  }
+  if (fastAttempt) {
+    st.fastAttempts++;
+    WiFi.begin(WIFI_SSID, WIFI_PASS, ap.channel, ap.bssid);
+  } else {
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+  }
+}
+
+static void connected(uint32_t nowMs) {
+  up = true;
+  const uint32_t at = gotIpMs.load() ? gotIpMs.load() : nowMs;
+  st.connects++;
+  if (fastAttempt) st.fastConnects++;
+  st.lastConnectMs = at - attemptMs;
+  if (st.firstUpMs == 0) st.firstUpMs = at;
+  retryMs = WIFI_RETRY_MIN_MS;
+  LOGI(NET, "WiFi up in %u ms (%s, ch %d, %s)", (unsigned)st.lastConnectMs, fastAttempt ? "cached AP" : "scan",
+       (int)WiFi.channel(), wifiIp().c_str());
+  fastAttempt = false;
+  saveAp();
+}
 
 void wifiBegin() {
   WiFi.mode(WIFI_STA);
   WiFi.setAutoReconnect(true);
+  WiFi.setSleep(WIFI_MODEM_SLEEP ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+  static bool hooked = false;
+  if (!hooked) hooked = WiFi.onEvent(onGotIp, ARDUINO_EVENT_WIFI_STA_GOT_IP) != 0;
+  loadAp();
+
+  const uint32_t now = millis();
+  connect(now);
+  nextTryMs = now + retryMs;
 }
 
+uint32_t wifiNextTryMs() { return nextTryMs; }
+
 bool wifiIsConnected() {
   return WiFi.status() == WL_CONNECTED;
 }
@@ -19,13 +129,39 @@ String wifiIp() {
   return WiFi.localIP().toString();
 }
 
+void wifiOnConnected(void (*fn)()) { onUp.store(fn); }
+
 void wifiEnsureConnected(uint32_t nowMs) {
-  if (wifiIsConnected()) return;
+  if (wifiIsConnected()) {
+    if (!up) connected(nowMs);
+    return;
+  }
+  if (up) { // caduta: prima tocca alla riconnessione automatica del driver
+    up = false;
+    attemptMs = nowMs;
+    gotIpMs.store(0);
+    nextTryMs = nowMs + retryMs;
+    LOGW(NET, "WiFi lost, reconnecting");
+    return;
+  }
+
+  if ((int32_t)(nowMs - nextTryMs) < 0) return;
+  if (fastAttempt) { // AP spostato o canale cambiato: si torna alla scansione
+    apValid = false;
+    hal::nvsRemove(KEY_AP); // al prossimo boot non si riprova: la riscrive il prossimo IP
+    LOGW(NET, "WiFi: cached AP not reachable, full scan");
+  }
+  connect(nowMs);
+  nextTryMs = nowMs + retryMs;
+  retryMs = retryMs * 2 > WIFI_RETRY_MAX_MS ? WIFI_RETRY_MAX_MS : retryMs * 2;
+}
 
-  if (nowMs < nextTryMs) return;
-  nextTryMs = nowMs + 3000; // ritenta ogni 3s
+WifiStats wifiStats() { return st; }
 
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
+void printWifiStats(Print& out) {
+  out.printf("wifi: attempts=%u (cached AP %u) connects=%u (cached AP %u) last=%ums first_ip=%ums\n",
+             (unsigned)st.attempts, (unsigned)st.fastAttempts, (unsigned)st.connects, (unsigned)st.fastConnects,
+             (unsigned)st.lastConnectMs, (unsigned)st.firstUpMs);
 }
 
-} // namespace net
\ No newline at end of file
+} // namespace net
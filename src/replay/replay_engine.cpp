@@ -0,0 +1,205 @@
+#if !defined(ARDUINO)
+#include "replay/replay_engine.h"
+#include "config.h"
+#include "app/alarm.h"
+#include "app/readings.h"
+#include "hal/hal_native.h"
+#include "sensors/dht_sensor.h"
+#include "sensors/mq7_sensor.h"
+#include "storage/r0_store.h"
+
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+namespace replay {
+
+static constexpr size_t CSV_FIELDS = 13;
+static constexpr uint32_t MAX_TS_GAP_S = 3600; // oltre: buco nel log, usa millis
+static constexpr uint32_t MIN_VALID_TS = 1600000000;
+
+namespace {
+
+// Sorgente DHT che restituisce i valori dell'ultima riga applicata.
+class ReplayDhtSource : public DhtSource {
+public:
+  void set(const CsvRow& r) { row_ = r; }
+  DhtStatus poll(uint32_t, float& tC, float& rh) override {
+    tC = row_.tC;
+    rh = row_.rh;
+    return (row_.dhtOk && !isnan(tC) && !isnan(rh)) ? DhtStatus::OK : DhtStatus::NO_RESPONSE;
+  }
+
+private:
+  CsvRow row_;
+};
+
+float parseFloat(const char* s) {
+  if (*s == '\0') return NAN; // SdLogger scrive NaN come campo vuoto
+  return strtof(s, nullptr);
+}
+
+// Millisecondi virtuali tra due righe: ts se affidabile, altrimenti millis
+// (che riparte da zero a ogni reset), altrimenti il periodo nominale.
+uint32_t rowGapMs(const CsvRow& prev, const CsvRow& cur) {
+  if (prev.ts >= MIN_VALID_TS && cur.ts >= prev.ts && cur.ts - prev.ts <= MAX_TS_GAP_S) {
+    return (cur.ts - prev.ts) * 1000u;
+  }
+  if (cur.millis > prev.millis) return cur.millis - prev.millis;
+  return SD_PERIOD_MS;
+}
+
+} // namespace
+
+bool parseCsvRow(const char* line, CsvRow& out) {
+  char buf[256];
+  size_t len = strcspn(line, "\r\n");
+  if (len == 0 || len >= sizeof(buf) || line[0] < '0' || line[0] > '9') return false;
+  memcpy(buf, line, len);
+  buf[len] = '\0';
+
+  const char* f[CSV_FIELDS];
+  size_t n = 0;
+  char* p = buf;
+  f[n++] = p;
+  while ((p = strchr(p, ',')) != nullptr) {
+    *p++ = '\0';
+    if (n == CSV_FIELDS) return false;
+    f[n++] = p;
+  }
+  if (n != CSV_FIELDS) return false;
+
+  out.ts = strtoul(f[0], nullptr, 10);
+  out.millis = strtoul(f[1], nullptr, 10);
+  out.tC = parseFloat(f[2]);
+  out.rh = parseFloat(f[3]);
+  out.dhtOk = atoi(f[4]) != 0;
+  out.mq7Raw = (uint16_t)atoi(f[5]);
+  out.mq7Ratio = parseFloat(f[6]);
+  out.mq7Ppm = parseFloat(f[7]);
+  out.mq7R0 = parseFloat(f[8]);
+  out.mq7Ok = atoi(f[9]) != 0;
+  out.mq7Calibrated = atoi(f[10]) != 0;
+  out.mq7WarmupDone = atoi(f[11]) != 0;
+  out.mq7Level = (uint8_t)atoi(f[12]);
+  return out.mq7Level <= 3;
+}
+
+bool run(FILE* in, const Options& opt, Result& res) {
+  res = Result{};
+  auto wallStart = std::chrono::steady_clock::now();
+  uint32_t tickMs = opt.tickMs > 0 ? opt.tickMs : 1;
+
+  hal::native::setMillis(0);
+  hal::native::nvsClear();
+
+  char line[256];
+  CsvRow row;
+  bool first = false;
+  while (fgets(line, sizeof(line), in)) {
+    if (parseCsvRow(line, row)) {
+      first = true;
+      break;
+    }
+  }
+  if (!first) return false;
+
+  // R0 come nella NVS del dispositivo che ha registrato il log
+  if (row.mq7Calibrated && row.mq7R0 > 0) {
+    R0Store store;
+    store.begin();
+    store.save(row.mq7R0);
+  }
+
+  ReplayDhtSource dhtSource;
+  BufferedAdcSampler sampler;
+  DhtSensor dht;
+  Mq7Sensor mq7;
+  AlarmOutput alarm;
+  dht.setSource(&dhtSource);
+  mq7.setSampler(&sampler);
+  dht.begin();
+  mq7.begin();
+  alarm.begin();
+  AlarmEngine rules;
+  if (!rules.compile(defaultAlarmRules())) {
+    fprintf(stderr, "alarm rules: %s\n", rules.error());
+    return false;
+  }
+
+  // log iniziato a sensore già caldo: salta il warmup
+  if (row.mq7WarmupDone) hal::native::advanceMs(MQ7_WARMUP_MS);
+
+  AlarmLevel level = AlarmLevel::UNKNOWN;
+  auto tick = [&](const CsvRow& r) {
+    uint32_t now = hal::millis();
+    dhtSource.set(r);
+    sampler.feed(&r.mq7Raw, 1);
+    dht.update(now);
+    mq7.update(now);
+    AlarmLevel next = rules.evaluate(now, alarmInputs(std::make_tuple(dht.get(), mq7.get())));
+    alarm.update(now, next);
+    if (next != level) {
+      res.transitions++;
+      if (opt.transitions) {
+        fprintf(opt.transitions, "%llu,%lu,%s,%s,%.4f\n", (unsigned long long)hal::native::nowMs64(),
+                (unsigned long)r.ts, alarmLevelText(level), alarmLevelText(next), mq7.get().ratio);
+      }
+      level = next;
+    }
+    res.ticks++;
+  };
+
+  auto nextRow = [&](CsvRow& out) {
+    while (fgets(line, sizeof(line), in)) {
+      if (parseCsvRow(line, out)) return true;
+      if (line[0] >= '0' && line[0] <= '9') res.skipped++;
+    }
+    return false;
+  };
+
+  CsvRow prev = row;
+  bool have = true;
+  while (have) {
+    // fino all'istante della riga gli ingressi restano quelli della precedente
+    uint32_t gap = res.rows == 0 ? 0 : rowGapMs(prev, row);
+    uint32_t elapsed = 0;
+    while (elapsed + tickMs < gap) {
+      hal::native::advanceMs(tickMs);
+      elapsed += tickMs;
+      tick(prev);
+    }
+    hal::native::advanceMs(gap - elapsed);
+    tick(row);
+
+    res.rows++;
+    res.levelRows[(uint8_t)level]++;
+    if (row.mq7WarmupDone && mq7.isWarmupDone()) {
+      res.compared++;
+      if ((uint8_t)level != row.mq7Level) res.mismatches++;
+    }
+    prev = row;
+    have = nextRow(row);
+  }
+
+  res.virtualMs = hal::native::nowMs64();
+  res.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+  return true;
+}
+
+void printResult(const Result& res, FILE* out) {
+  fprintf(out, "rows        %lu (skipped %lu)\n", (unsigned long)res.rows, (unsigned long)res.skipped);
+  fprintf(out, "virtual     %.1f h in %llu ticks\n", res.virtualMs / 3600000.0, (unsigned long long)res.ticks);
+  for (uint8_t i = 0; i < 4; i++) {
+    fprintf(out, "%-11s %lu rows\n", alarmLevelText((AlarmLevel)i), (unsigned long)res.levelRows[i]);
+  }
+  fprintf(out, "transitions %lu\n", (unsigned long)res.transitions);
+  fprintf(out, "mismatches  %lu / %lu rows vs recorded mq7Level\n", (unsigned long)res.mismatches,
+          (unsigned long)res.compared);
+  double wallS = res.wallMs / 1000.0;
+  fprintf(out, "wall        %.1f ms, %.0f rows/s, %.0fx real time\n", res.wallMs,
+          wallS > 0 ? res.rows / wallS : 0.0, res.wallMs > 0 ? res.virtualMs / res.wallMs : 0.0);
+}
+
+} // namespace replay
+#endif
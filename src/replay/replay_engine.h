@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include <stdio.h>
+
+// Replay su host dei log CSV di SdLogger: ricostruisce gli ingressi dei
+// sensori riga per riga e fa girare Mq7Sensor / DhtSensor / allarme sul
+// tempo virtuale della HAL nativa. Solo build native.
+namespace replay {
+
+struct CsvRow {
+  uint32_t ts = 0;
+  uint32_t millis = 0;
+  float tC = NAN;
+  float rh = NAN;
+  bool dhtOk = false;
+  uint16_t mq7Raw = 0;
+  float mq7Ratio = NAN;
+  float mq7Ppm = NAN;
+  float mq7R0 = NAN;
+  bool mq7Ok = false;
+  bool mq7Calibrated = false;
+  bool mq7WarmupDone = false;
+  uint8_t mq7Level = 0;
+};
+
+// Una riga dati (header e righe vuote -> false).
+bool parseCsvRow(const char* line, CsvRow& out);
+
+struct Options {
+  uint32_t tickMs = 50;          // passo del loop sensori (come il task sensor)
+  FILE* transitions = nullptr;   // se non nullo: una riga per ogni cambio di livello
+};
+
+struct Result {
+  uint32_t rows = 0;
+  uint32_t skipped = 0;          // righe non valide
+  uint64_t ticks = 0;
+  uint64_t virtualMs = 0;
+  uint32_t levelRows[4] = {};    // righe per livello simulato (UNKNOWN..DANGER)
+  uint32_t transitions = 0;
+  uint32_t compared = 0;         // righe con warmup concluso in entrambi
+  uint32_t mismatches = 0;       // livello simulato != mq7Level registrato
+  double wallMs = 0;
+};
+
+// Legge tutto il CSV da in e riempie res. false se non c'è nessuna riga valida.
+bool run(FILE* in, const Options& opt, Result& res);
+
+void printResult(const Result& res, FILE* out);
+
+} // namespace replay
@@ -0,0 +1,54 @@
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+#include "replay/replay_engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Uso: replay <log.csv|-> [--tick MS] [--transitions FILE]
+// Esempio: .pio/build/native/program LOG.CSV --transitions alarms.csv
+static int usage() {
+  fprintf(stderr, "usage: replay <log.csv|-> [--tick MS] [--transitions FILE]\n");
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) return usage();
+
+  replay::Options opt;
+  const char* transitionsPath = nullptr;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--tick") && i + 1 < argc) {
+      opt.tickMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "--transitions") && i + 1 < argc) {
+      transitionsPath = argv[++i];
+    } else {
+      return usage();
+    }
+  }
+
+  FILE* in = strcmp(argv[1], "-") ? fopen(argv[1], "r") : stdin;
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+  if (transitionsPath) {
+    opt.transitions = fopen(transitionsPath, "w");
+    if (!opt.transitions) {
+      fprintf(stderr, "cannot create %s\n", transitionsPath);
+      return 1;
+    }
+    fprintf(opt.transitions, "virtualMs,ts,from,to,ratio\n");
+  }
+
+  replay::Result res;
+  bool ok = replay::run(in, opt, res);
+  if (in != stdin) fclose(in);
+  if (opt.transitions) fclose(opt.transitions);
+  if (!ok) {
+    fprintf(stderr, "no data rows\n");
+    return 1;
+  }
+  replay::printResult(res, stdout);
+  return 0;
+}
+#endif
@@ -0,0 +1,117 @@
+#include "sensors/adc_dma_sampler.h"
+#include "util/log.h"
+
+#if defined(ESP32)
+#include <driver/adc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static constexpr uint32_t DMA_FRAME_BYTES = 256;
+
+bool DmaAdcSampler::begin() {
+  if (started_) return true;
+
+  int8_t ch = digitalPinToAnalogChannel(pin_);
+  if (ch < 0 || ch > 7) {
+    // solo ADC1 (ADC2 non è usabile con il WiFi attivo)
+    LOGE(SENSOR, "ADC DMA: pin %u is not on ADC1", pin_);
+    return false;
+  }
+  channel_ = (uint8_t)ch;
+
+  adc_digi_init_config_t initCfg = {};
+  initCfg.max_store_buf_size = 4 * DMA_FRAME_BYTES;
+  initCfg.conv_num_each_intr = DMA_FRAME_BYTES;
+  initCfg.adc1_chan_mask = BIT(channel_);
+  initCfg.adc2_chan_mask = 0;
+  if (adc_digi_initialize(&initCfg) != ESP_OK) {
+    LOGE(SENSOR, "ADC DMA: init failed");
+    return false;
+  }
+
+  // ADC_0db: segnali bassi -> sensibilità vicino allo zero (come prima con analogRead)
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_0;
+  pattern.channel = channel_;
+  pattern.unit = 0; // ADC1
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+  adc_digi_configuration_t digCfg = {};
+  digCfg.conv_limit_en = true;
+  digCfg.conv_limit_num = 250;
+  digCfg.pattern_num = 1;
+  digCfg.adc_pattern = &pattern;
+  digCfg.sample_freq_hz = SAMPLE_FREQ_HZ;
+  digCfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digCfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+  if (adc_digi_controller_configure(&digCfg) != ESP_OK) {
+    LOGE(SENSOR, "ADC DMA: configure failed");
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  TaskHandle_t task = nullptr;
+  started_ = xTaskCreatePinnedToCore(taskEntry_, "adc_dma", 3072, this, 5, &task, 0) == pdPASS;
+  task_ = task;
+  return started_;
+}
+
+void DmaAdcSampler::startBurst(uint32_t ms) {
+  if (task_) xTaskNotify(static_cast<TaskHandle_t>(task_), ms, eSetValueWithOverwrite);
+}
+
+void DmaAdcSampler::taskEntry_(void* arg) {
+  static_cast<DmaAdcSampler*>(arg)->run_();
+}
+
+// Fermo (DMA spento) finché startBurst() non notifica la durata della finestra.
+void DmaAdcSampler::run_() {
+  for (;;) {
+    uint32_t ms = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &ms, portMAX_DELAY);
+    if (adc_digi_start() != ESP_OK) {
+      LOGE(SENSOR, "ADC DMA: start failed");
+      continue;
+    }
+    collect_(ms ? (ms * OUTPUT_HZ + 999) / 1000 : 0);
+    adc_digi_stop();
+  }
+}
+
+void DmaAdcSampler::collect_(uint32_t outputs) {
+  uint8_t frame[DMA_FRAME_BYTES];
+  uint32_t got = 0;
+  // frame rimasti nel driver dalla finestra precedente: vecchi, si scartano
+  while (adc_digi_read_bytes(frame, sizeof(frame), &got, 0) == ESP_OK && got > 0) {
+  }
+
+  uint32_t acc = 0;
+  uint32_t accN = 0;
+  uint32_t produced = 0;
+  while (outputs == 0 || produced < outputs) {
+    esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &got, 100);
+    if (err != ESP_OK) continue; // timeout o overflow interno del driver: riprova
+
+    for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= got; i += sizeof(adc_digi_output_data_t)) {
+      const adc_digi_output_data_t* d = reinterpret_cast<const adc_digi_output_data_t*>(&frame[i]);
+      if (d->type1.channel != channel_) continue;
+      acc += d->type1.data;
+      if (++accN == DECIMATION) {
+        ring_.push((uint16_t)(acc / accN));
+        acc = 0;
+        accN = 0;
+        produced++;
+      }
+    }
+  }
+}
+
+#else
+
+bool DmaAdcSampler::begin() { return false; }
+void DmaAdcSampler::startBurst(uint32_t) {}
+void DmaAdcSampler::taskEntry_(void*) {}
+void DmaAdcSampler::run_() {}
+void DmaAdcSampler::collect_(uint32_t) {}
+
+#endif
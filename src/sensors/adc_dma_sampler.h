@@ -0,0 +1,31 @@
+#pragma once
+#include "hal/hal.h"
+#include "sensors/adc_sampler.h"
+
+// Acquisizione ADC1 via DMA (I2S) su un singolo pin, a finestre.
+// Un task in background, a ogni startBurst(), avvia il DMA, legge i frame, li
+// decima (media di DECIMATION campioni) e spinge il risultato nel ring; a
+// finestra finita ferma il DMA e aspetta la notifica successiva. Da fermo il
+// driver rilascia il suo lock di frequenza APB: DFS e light sleep tornano
+// utili fra un campione MQ-7 e l'altro.
+class DmaAdcSampler : public BufferedAdcSampler {
+public:
+  static constexpr uint32_t SAMPLE_FREQ_HZ = 20000; // minimo supportato su ESP32
+  static constexpr uint32_t DECIMATION = 80;        // -> 250 campioni/s nel ring
+  static constexpr uint32_t OUTPUT_HZ = SAMPLE_FREQ_HZ / DECIMATION;
+
+  explicit DmaAdcSampler(uint8_t pin) : pin_(pin) {}
+  bool begin() override;
+  void startBurst(uint32_t ms) override;
+
+private:
+  static void taskEntry_(void* arg);
+  void run_();
+  // Legge frame DMA finché non ha prodotto outputs campioni (0 = per sempre).
+  void collect_(uint32_t outputs);
+
+  uint8_t pin_;
+  uint8_t channel_ = 0;
+  bool started_ = false;
+  void* task_ = nullptr;
+};
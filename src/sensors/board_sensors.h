@@ -0,0 +1,25 @@
+#pragma once
+#include "sensors/sensor_registry.h"
+#include "sensors/dht_sensor.h"
+#include "sensors/mq7_sensor.h"
+
+// Sensori montati sulla board (-D in build_flags). Un sensore a 0 sparisce da
+// registro, CSV e JSON; per non compilarne nemmeno il .cpp va tolto anche da
+// build_src_filter (es. -<sensors/dht_sensor.cpp>).
+#ifndef BOARD_HAS_DHT
+#define BOARD_HAS_DHT 1
+#endif
+#ifndef BOARD_HAS_MQ7
+#define BOARD_HAS_MQ7 1
+#endif
+
+using BoardSensors = SensorRegistryOf<std::conditional_t<BOARD_HAS_DHT, DhtSensor, void>,
+                                      std::conditional_t<BOARD_HAS_MQ7, Mq7Sensor, void>>;
+
+// Campi di AppReadings in CSV e JSON, nell'ordine della board.
+inline constexpr const auto& READING_FIELDS = BoardSensors::FIELDS;
+
+// Record binario v1 (telemetria): layout fisso con tutti i sensori noti, così
+// il decoder del server non dipende dalla board. I campi di un sensore
+// assente restano ai default di AppReadings (NaN / 0 / false).
+inline constexpr auto WIRE_V1_FIELDS = fieldsOf<DhtSensor, Mq7Sensor>();
@@ -0,0 +1,74 @@
+#include "sensors/dht_decode.h"
+
+namespace dhtproto {
+
+// Tolleranze larghe: i sensori economici e il filtro RMT spostano i fronti
+// di qualche us, ma un bit 0 e un bit 1 restano ben separati.
+static constexpr uint16_t RESP_MIN_US = 50;
+static constexpr uint16_t RESP_MAX_US = 120;
+static constexpr uint16_t BIT_LOW_MIN_US = 30;
+static constexpr uint16_t BIT_LOW_MAX_US = 90;
+static constexpr uint16_t BIT_HIGH_MIN_US = 10;
+static constexpr uint16_t BIT_HIGH_MAX_US = 95;
+static constexpr uint16_t BIT_ONE_US = 48; // alto più lungo = 1
+
+DhtStatus decode(const uint16_t* pulsesUs, size_t n, uint8_t firstLevel, uint8_t out[FRAME_BYTES]) {
+  // primo impulso basso
+  size_t i = firstLevel ? 1 : 0;
+
+  // risposta: coppia basso/alto da ~80 us (i bit hanno il basso più corto)
+  for (; i + 1 < n; i += 2) {
+    const uint16_t lo = pulsesUs[i];
+    const uint16_t hi = pulsesUs[i + 1];
+    if (lo >= RESP_MIN_US && lo <= RESP_MAX_US && hi >= RESP_MIN_US && hi <= RESP_MAX_US) break;
+  }
+  if (i + 1 >= n) return DhtStatus::NO_RESPONSE;
+  i += 2;
+
+  for (size_t b = 0; b < FRAME_BYTES; b++) out[b] = 0;
+  for (size_t bit = 0; bit < FRAME_BYTES * 8; bit++, i += 2) {
+    if (i + 1 >= n) return DhtStatus::SHORT_FRAME;
+    const uint16_t lo = pulsesUs[i];
+    const uint16_t hi = pulsesUs[i + 1];
+    if (lo < BIT_LOW_MIN_US || lo > BIT_LOW_MAX_US || hi < BIT_HIGH_MIN_US || hi > BIT_HIGH_MAX_US) {
+      return DhtStatus::BAD_TIMING;
+    }
+    out[bit / 8] = (uint8_t)((out[bit / 8] << 1) | (hi > BIT_ONE_US ? 1 : 0));
+  }
+
+  const uint8_t sum = (uint8_t)(out[0] + out[1] + out[2] + out[3]);
+  return sum == out[4] ? DhtStatus::OK : DhtStatus::CHECKSUM;
+}
+
+void convert(const uint8_t frame[FRAME_BYTES], uint8_t type, float& tC, float& rh) {
+  if (type == 22) {
+    rh = ((frame[0] << 8) | frame[1]) * 0.1f;
+    tC = (((frame[2] & 0x7F) << 8) | frame[3]) * 0.1f;
+    if (frame[2] & 0x80) tC = -tC;
+  } else {
+    // DHT11: decimali a 0 sui modelli vecchi, bit 7 del decimale = segno sui nuovi
+    rh = frame[0] + frame[1] * 0.1f;
+    tC = frame[2] + (frame[3] & 0x7F) * 0.1f;
+    if (frame[3] & 0x80) tC = -tC;
+  }
+}
+
+const char* statusText(DhtStatus s) {
+  switch (s) {
+  case DhtStatus::OK:
+    return "ok";
+  case DhtStatus::PENDING:
+    return "pending";
+  case DhtStatus::NO_RESPONSE:
+    return "no_response";
+  case DhtStatus::SHORT_FRAME:
+    return "short_frame";
+  case DhtStatus::BAD_TIMING:
+    return "bad_timing";
+  case DhtStatus::CHECKSUM:
+    return "checksum";
+  }
+  return "?";
+}
+
+} // namespace dhtproto
@@ -1,24 +1,209 @@
 #include "config.h"
 #include "sensors/dht_sensor.h"
+#include "util/log.h"
+
+#if defined(ARDUINO) && DHT_USE_RMT
+#include <driver/gpio.h>
+#include <driver/rmt.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/ringbuf.h>
+
+namespace {
+
+// Lettura DHT senza bit-bang: lo start (linea bassa) lo chiude un esp_timer,
+// che avvia anche la ricezione RMT; il treno di impulsi arriva nel ring
+// buffer del driver e poll() lo decodifica. La CPU non aspetta mai i fronti.
+class RmtDhtSource : public DhtSource {
+public:
+  void begin() override {
+    rmt_config_t cfg = RMT_DEFAULT_CONFIG_RX(PIN, CHANNEL);
+    cfg.clk_div = 80; // APB 80 MHz -> 1 tick = 1 us
+    cfg.rx_config.filter_en = true;
+    cfg.rx_config.filter_ticks_thresh = 100; // glitch sotto ~1.25 us (in cicli APB)
+    cfg.rx_config.idle_threshold = IDLE_US;  // linea ferma: frame finito
+    ready_ = rmt_config(&cfg) == ESP_OK && rmt_driver_install(CHANNEL, RING_BYTES, 0) == ESP_OK &&
+             rmt_get_ringbuf_handle(CHANNEL, &ring_) == ESP_OK;
+
+    // Open-drain con pull-up: la stessa linea fa lo start (uscita) e resta
+    // collegata all'ingresso RMT dal GPIO matrix.
+    gpio_set_pull_mode(PIN, GPIO_PULLUP_ONLY);
+    gpio_set_direction(PIN, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level(PIN, 1);
+
+    esp_timer_create_args_t args = {};
+    args.callback = &release_;
+    args.arg = this;
+    args.name = "dht_start";
+    ready_ = ready_ && esp_timer_create(&args, &timer_) == ESP_OK;
+    awake_ = hal::awakeCreate("dht");
+    if (!ready_) LOGE(SENSOR, "DHT: RMT init failed");
+  }
+
+  void start(uint32_t nowMs) override {
+    if (!ready_) return;
+    startMs_ = nowMs;
+    hal::awakeHold(awake_, true); // RMT fermo in light sleep: sveglio fino a fine frame
+    gpio_set_level(PIN, 0);
+    esp_timer_start_once(timer_, START_LOW_US);
+  }
+
+  DhtStatus poll(uint32_t nowMs, float& tC, float& rh) override {
+    if (!ready_) return DhtStatus::NO_RESPONSE;
+    size_t bytes = 0;
+    rmt_item32_t* items = static_cast<rmt_item32_t*>(xRingbufferReceive(ring_, &bytes, 0));
+    if (!items) {
+      if (nowMs - startMs_ < TIMEOUT_MS) return DhtStatus::PENDING;
+      esp_timer_stop(timer_);
+      rmt_rx_stop(CHANNEL);
+      gpio_set_level(PIN, 1);
+      hal::awakeHold(awake_, false);
+      return DhtStatus::NO_RESPONSE;
+    }
+
+    // item RMT (due livelli ciascuno) -> durate a livelli alterni
+    uint16_t pulses[dhtproto::MAX_PULSES];
+    size_t n = 0;
+    uint8_t firstLevel = 0, level = 0;
+    const size_t count = bytes / sizeof(rmt_item32_t);
+    for (size_t i = 0; i < count; i++) {
+      const uint16_t d[2] = {(uint16_t)items[i].duration0, (uint16_t)items[i].duration1};
+      const uint8_t l[2] = {(uint8_t)items[i].level0, (uint8_t)items[i].level1};
+      for (uint8_t k = 0; k < 2 && d[k] > 0; k++) {
+        if (n > 0 && l[k] == level) {
+          pulses[n - 1] += d[k]; // stesso livello: un solo impulso
+        } else if (n < dhtproto::MAX_PULSES) {
+          if (n == 0) firstLevel = l[k];
+          pulses[n++] = d[k];
+          level = l[k];
+        }
+      }
+    }
+    vRingbufferReturnItem(ring_, items);
+    rmt_rx_stop(CHANNEL);
+    hal::awakeHold(awake_, false);
+
+    uint8_t frame[dhtproto::FRAME_BYTES];
+    const DhtStatus st = dhtproto::decode(pulses, n, firstLevel, frame);
+    if (st == DhtStatus::OK) dhtproto::convert(frame, DHT_TYPE, tC, rh);
+    return st;
+  }
+
+private:
+  static constexpr gpio_num_t PIN = (gpio_num_t)PIN_DHT;
+  static constexpr rmt_channel_t CHANNEL = RMT_CHANNEL_4;
+  static constexpr uint16_t IDLE_US = 200;      // fra due fronti di un frame al massimo ~90 us
+  static constexpr size_t RING_BYTES = 512;
+  static constexpr uint32_t START_LOW_US = DHT_TYPE == 22 ? 1100 : 20000; // datasheet: >= 1 ms / >= 18 ms
+  static constexpr uint32_t TIMEOUT_MS = 100;
+
+  // Task esp_timer: fine dello start, il sensore risponde entro ~40 us.
+  static void release_(void* arg) {
+    (void)arg;
+    rmt_rx_start(CHANNEL, true);
+    gpio_set_level(PIN, 1);
+  }
+
+  bool ready_ = false;
+  RingbufHandle_t ring_ = nullptr;
+  esp_timer_handle_t timer_ = nullptr;
+  hal::AwakeHandle awake_ = nullptr;
+  uint32_t startMs_ = 0;
+};
+
+RmtDhtSource defaultSource;
+
+} // namespace
+#elif defined(ARDUINO)
 #include <DHT.h>
 
-static DHT dht(PIN_DHT, DHT11); // cambia a DHT22 se serve
+namespace {
+
+// Lettura sincrona della libreria: poll() blocca per la durata del frame.
+class AdafruitDhtSource : public DhtSource {
+public:
+  void begin() override { dht_.begin(); }
+  DhtStatus poll(uint32_t, float& tC, float& rh) override {
+    rh = dht_.readHumidity();
+    tC = dht_.readTemperature();
+    return (!isnan(rh) && !isnan(tC)) ? DhtStatus::OK : DhtStatus::NO_RESPONSE;
+  }
+
+private:
+  DHT dht_{PIN_DHT, DHT_TYPE == 22 ? DHT22 : DHT11};
+};
+
+AdafruitDhtSource defaultSource;
+
+} // namespace
+#endif
 
 void DhtSensor::begin() {
-  dht.begin();
+#if defined(ARDUINO)
+  if (!source_) source_ = &defaultSource;
+#endif
+  if (source_) source_->begin();
+  busy_ = false;
   nextRead_ = 0;
+  backoffMs_ = DHT_RETRY_MIN_MS;
+  fails_ = 0;
 }
 
 void DhtSensor::update(uint32_t nowMs) {
-  if (nowMs < nextRead_) return;
-  nextRead_ = nowMs + DHT_PERIOD_MS;
+  if (!busy_) {
+    if ((int32_t)(nowMs - nextRead_) < 0) return;
+    stats_.reads++;
+    if (fails_ > 0) stats_.retries++;
+    if (!source_) {
+      finish_(nowMs, DhtStatus::NO_RESPONSE, NAN, NAN);
+      return;
+    }
+    startUs_ = hal::monoUs();
+    source_->start(nowMs);
+    busy_ = true;
+  }
 
-  float h = dht.readHumidity();
-  float t = dht.readTemperature();
+  float t = NAN;
+  float h = NAN;
+  const DhtStatus st = source_->poll(nowMs, t, h);
+  if (st == DhtStatus::PENDING) {
+    pollAtMs_ = nowMs + POLL_MS;
+    return;
+  }
+  busy_ = false;
+  finish_(nowMs, st, t, h);
+}
+
+void DhtSensor::finish_(uint32_t nowMs, DhtStatus st, float tC, float rh) {
+  last_.status = st;
+  if (st == DhtStatus::OK) {
+    stats_.ok++;
+    last_.tC = tC;
+    last_.rh = rh;
+    last_.ok = true;
+    last_.atUs = startUs_;
+    fails_ = 0;
+    backoffMs_ = DHT_RETRY_MIN_MS;
+    nextRead_ = nowMs + DHT_PERIOD_MS;
+    return;
+  }
 
-  if (isnan(h) || isnan(t)) {
-    last_ = {NAN, NAN, false};
-  } else {
-    last_ = {t, h, true};
+  if (st == DhtStatus::CHECKSUM) stats_.checksum++;
+  else if (st == DhtStatus::NO_RESPONSE) stats_.noResponse++;
+  else stats_.badFrames++;
+
+  if (fails_ < 255) fails_++;
+  if (fails_ >= DHT_MAX_FAILS) {
+    last_.tC = NAN;
+    last_.rh = NAN;
+    last_.ok = false;
   }
-}
\ No newline at end of file
+  nextRead_ = nowMs + backoffMs_;
+  backoffMs_ = backoffMs_ * 2 > DHT_RETRY_MAX_MS ? DHT_RETRY_MAX_MS : backoffMs_ * 2;
+}
+
+void DhtSensor::printStats(Print& out) const {
+  out.printf("dht: reads=%u ok=%u no_resp=%u bad=%u checksum=%u retries=%u last=%s\n", (unsigned)stats_.reads,
+             (unsigned)stats_.ok, (unsigned)stats_.noResponse, (unsigned)stats_.badFrames, (unsigned)stats_.checksum,
+             (unsigned)stats_.retries, dhtproto::statusText(last_.status));
+}
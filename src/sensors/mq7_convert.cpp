@@ -0,0 +1,74 @@
+#include "sensors/mq7_convert.h"
+
+namespace mq7conv {
+
+namespace {
+
+constexpr uint32_t toQ(float v, uint8_t bits) {
+  if (!(v >= 0.0f)) return Q_INVALID; // NaN o negativo
+  const float s = v * (float)(1u << bits) + 0.5f;
+  if (s >= 4294967040.0f) return Q_MAX; // massimo float < 2^32
+  return (uint32_t)s;
+}
+
+// a + (b - a) * f / 2^bits, con b < a ammesso
+inline uint32_t lerp(uint32_t a, uint32_t b, uint32_t f, uint8_t bits) {
+  return (uint32_t)((int64_t)a + ((((int64_t)b - (int64_t)a) * f) >> bits));
+}
+
+struct RsTable {
+  uint32_t q4[ADC_CODES];
+};
+
+constexpr RsTable makeRsTable() {
+  RsTable t{};
+  for (uint32_t raw = 0; raw < ADC_CODES; raw++) t.q4[raw] = toQ(rawToRs((float)raw), FRAC_BITS);
+  return t;
+}
+
+// 16 KB in flash, calcolati dal compilatore da RL_OHMS, VCC_SENSOR e DIVIDER_GAIN.
+constexpr RsTable RS_TABLE = makeRsTable();
+static_assert(RS_TABLE.q4[0] == Q_INVALID, "raw 0 deve restare non valido");
+static_assert(RS_TABLE.q4[1] > RS_TABLE.q4[ADC_CODES / 2], "Rs deve scendere al crescere di raw");
+
+} // namespace
+
+uint32_t rsQ4(uint32_t rawQ4) {
+  const uint32_t i = rawQ4 >> FRAC_BITS;
+  if (i >= ADC_CODES - 1) return RS_TABLE.q4[ADC_CODES - 1];
+  const uint32_t a = RS_TABLE.q4[i];
+  const uint32_t f = rawQ4 & ((1u << FRAC_BITS) - 1);
+  if (f == 0 || a == Q_INVALID) return a;
+  return lerp(a, RS_TABLE.q4[i + 1], f, FRAC_BITS);
+}
+
+void PpmTable::rebuild(float r0) {
+  r0_ = r0;
+  if (!(r0 > 0)) return;
+  for (uint16_t n = 0; n < NODES; n++) {
+    const float ratio = rawToRs((float)((uint32_t)n << STRIDE_BITS)) / r0;
+    ratioQ16_[n] = toQ(ratio, RATIO_FRAC_BITS);
+    ppmQ8_[n] = toQ(ratioToPpm(ratio), PPM_FRAC_BITS);
+  }
+}
+
+bool PpmTable::lookup(uint32_t rawQ4, uint32_t& ratioQ16, uint32_t& ppmQ8) const {
+  if (!(r0_ > 0)) return false;
+  static constexpr uint8_t SHIFT = FRAC_BITS + STRIDE_BITS;
+  uint32_t n = rawQ4 >> SHIFT;
+  uint32_t f = rawQ4 & ((1u << SHIFT) - 1);
+  if (n >= NODES - 1) {
+    n = NODES - 2;
+    f = 1u << SHIFT;
+  }
+  // il primo intervallo parte da raw 0 (Rs non definito): lo copre il percorso float
+  if (n == 0) return false;
+  const uint32_t r0q = ratioQ16_[n], r1q = ratioQ16_[n + 1];
+  const uint32_t p0 = ppmQ8_[n], p1 = ppmQ8_[n + 1];
+  if (r0q == Q_INVALID || r1q == Q_INVALID || p0 == Q_INVALID || p1 == Q_INVALID) return false;
+  ratioQ16 = lerp(r0q, r1q, f, SHIFT);
+  ppmQ8 = lerp(p0, p1, f, SHIFT);
+  return true;
+}
+
+} // namespace mq7conv
@@ -0,0 +1,70 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include "config.h"
+
+// Conversioni MQ-7: raw ADC -> Vnode -> VRL -> Rs -> ratio -> ppm.
+// Percorso float di riferimento (constexpr dove possibile) e percorso a
+// tabelle: Rs per ogni codice ADC generato a compile time, ratio/ppm per
+// nodi ricalcolati a runtime quando cambia R0. Entrambe le tabelle
+// interpolano un raw medio con FRAC_BITS bit frazionari.
+namespace mq7conv {
+
+static constexpr uint16_t ADC_CODES = 4096;
+static constexpr float ADC_VREF = 1.1f; // ADC_0db: ~0..1.1V nominale, ma Vref varia tra chip -> stima
+
+static constexpr uint8_t FRAC_BITS = 4;  // raw medio e Rs in Q.4
+static constexpr uint8_t RATIO_FRAC_BITS = 16;
+static constexpr uint8_t PPM_FRAC_BITS = 8;       // 1/256 ppm: <0.5% anche a 1 ppm
+static constexpr uint32_t Q_INVALID = UINT32_MAX;
+static constexpr uint32_t Q_MAX = UINT32_MAX - 1; // saturazione
+
+// --- percorso float ---
+
+constexpr float rawToVnode(float raw) {
+  return (raw * ADC_VREF) / 4095.0f;
+}
+
+constexpr float vRlToRs(float vRl) {
+  // Datasheet: Rs/RL = (Vc - VRL) / VRL  => Rs = RL*(Vc - VRL)/VRL
+  if (vRl <= 0.0001f) return NAN;
+  if (vRl >= VCC_SENSOR) vRl = VCC_SENSOR - 0.0001f;
+  return RL_OHMS * (VCC_SENSOR - vRl) / vRl;
+}
+
+// VRL ricostruita prima del partitore
+constexpr float rawToRs(float raw) {
+  return vRlToRs(rawToVnode(raw) * DIVIDER_GAIN);
+}
+
+inline float ratioToPpm(float ratio) {
+  if (!(ratio > 0)) return NAN;
+  // ppm = A * ratio^B (placeholder: fit da fare bene sulla tua curva)
+  return CO_A * powf(ratio, CO_B);
+}
+
+// --- percorso a tabelle ---
+
+// Rs in ohm Q.4 per un raw Q.4 (tabella in flash); Q_INVALID sotto 1 LSB.
+uint32_t rsQ4(uint32_t rawQ4);
+
+// ratio (Q.16) e ppm (Q.8) per raw Q.4 con R0 fissato. Un nodo ogni
+// 2^STRIDE_BITS codici: i nodi si ricalcolano con rebuild() (un powf per
+// nodo) quando R0 cambia, il lookup è un'interpolazione intera.
+class PpmTable {
+public:
+  static constexpr uint8_t STRIDE_BITS = 3;
+  static constexpr uint16_t NODES = (ADC_CODES >> STRIDE_BITS) + 1;
+
+  void rebuild(float r0);
+  float r0() const { return r0_; }
+  // false se R0 o il raw non sono nel dominio della tabella: usare il percorso float.
+  bool lookup(uint32_t rawQ4, uint32_t& ratioQ16, uint32_t& ppmQ8) const;
+
+private:
+  float r0_ = NAN;
+  uint32_t ratioQ16_[NODES];
+  uint32_t ppmQ8_[NODES];
+};
+
+} // namespace mq7conv
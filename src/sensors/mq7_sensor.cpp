@@ -1,60 +1,116 @@
 #include "config.h"
 #include "sensors/mq7_sensor.h"
+#include "sensors/adc_dma_sampler.h"
+#include "util/log.h"
 #include <math.h>
 
-static constexpr int AVG_N = 20;
+static constexpr size_t DRAIN_CHUNK = 64;
+static constexpr uint8_t CALIB_MIN_SAMPLES = 2;
+// Il ring deve reggere almeno due periodi senza drain (un update saltato).
+static_assert((uint64_t)BufferedAdcSampler::RING_SIZE * 1000u / DmaAdcSampler::OUTPUT_HZ >= 2u * MQ7_PERIOD_MS,
+              "RING_SIZE troppo piccolo per MQ7_PERIOD_MS");
+
+static constexpr uint32_t BURST_LEAD_MS = Mq7Sensor::BURST_LEAD_MS;
+static_assert(MQ7_ADC_BURST_MS == 0 || MQ7_ADC_BURST_MS + BURST_LEAD_MS < MQ7_PERIOD_MS,
+              "MQ7_ADC_BURST_MS deve stare nel periodo (0 = ADC sempre acceso)");
+static constexpr uint64_t BURST_MID_US = (uint64_t)(MQ7_ADC_BURST_MS / 2 + BURST_LEAD_MS) * 1000u;
+
+static DmaAdcSampler defaultSampler(PIN_MQ7_ADC);
 
 void Mq7Sensor::begin() {
   store_.begin();
   calibrated_ = store_.hasValue();
-  r0_ = store_.load(MQ7_R0_DEFAULT);
-  warmupUntilMs_ = millis() + MQ7_WARMUP_MS;
-  nextSampleAtMs_ = millis();
+  setR0_(store_.load(MQ7_R0_DEFAULT));
+  calibState_ = Mq7CalibState::IDLE;
+  warmupUntilUs_ = hal::monoUs() + (uint64_t)MQ7_WARMUP_MS * 1000u;
+  nextSampleAtMs_ = hal::millis();
+
+  if (!sampler_) sampler_ = &defaultSampler;
+  if (!sampler_->begin()) {
+    LOGE(SENSOR, "MQ7: ADC sampler start failed");
+  }
+  burstPending_ = false;
+  if (MQ7_ADC_BURST_MS == 0) {
+    sampler_->startBurst(0);
+  } else {
+    // prima finestra subito: senza, il primo update() svuoterebbe un ring
+    // vuoto e la prima lettura arriverebbe un MQ7_PERIOD_MS dopo (in deep
+    // sleep, a ogni risveglio)
+    sampler_->startBurst(MQ7_ADC_BURST_MS);
+    nextSampleAtMs_ += FIRST_SAMPLE_MS;
+  }
+}
 
-  // ADC: segnali bassi -> 0dB per sensibilità vicino allo zero
-  analogReadResolution(12);
-  analogSetPinAttenuation(PIN_MQ7_ADC, ADC_0db);
+void Mq7Sensor::setWarmupElapsed(uint32_t elapsedMs) {
+  warmupUntilUs_ = hal::monoUs() + (uint64_t)(elapsedMs >= MQ7_WARMUP_MS ? 0 : MQ7_WARMUP_MS - elapsedMs) * 1000u;
 }
 
-uint16_t Mq7Sensor::readAvgRaw_() const {
+bool Mq7Sensor::drainAvgRaw_(uint32_t& outQ4) {
+  uint16_t chunk[DRAIN_CHUNK];
   uint32_t sum = 0;
-  for (int i = 0; i < AVG_N; i++) {
-    sum += analogRead(PIN_MQ7_ADC);
-    delay(3);
+  uint32_t count = 0;
+  size_t n;
+  while ((n = sampler_->drain(chunk, DRAIN_CHUNK)) > 0) {
+    for (size_t i = 0; i < n; i++) sum += chunk[i];
+    count += n;
   }
-  return (uint16_t)(sum / AVG_N);
-}
-
-float Mq7Sensor::rawToVnode_(uint16_t raw) const {
-  // ADC_0db: ~0..1.1V nominal, ma Vref varia tra chip -> è una stima
-  const float vref = 1.1f;
-  return (raw * vref) / 4095.0f;
+  if (count == 0) return false;
+  // media con FRAC_BITS bit frazionari: la media di molti campioni ne vale di più di 12
+  outQ4 = (uint32_t)((((uint64_t)sum << mq7conv::FRAC_BITS) + count / 2) / count);
+  return true;
 }
 
-float Mq7Sensor::computeRs_(float vRl) const {
-  // Datasheet: Rs/RL = (Vc - VRL) / VRL  => Rs = RL*(Vc - VRL)/VRL  [oai_citation:3‡SparkFun Electronics](https://www.sparkfun.com/datasheets/Sensors/Biometric/MQ-7.pdf?utm_source=chatgpt.com)
-  if (vRl <= 0.0001f) return NAN;
-  if (vRl >= VCC_SENSOR) vRl = VCC_SENSOR - 0.0001f;
-  return RL_OHMS * (VCC_SENSOR - vRl) / vRl;
+void Mq7Sensor::convert_(uint32_t rawQ4, float& rs, float& ratio, float& ppm) const {
+#if MQ7_USE_LUT
+  const uint32_t rsQ = mq7conv::rsQ4(rawQ4);
+  uint32_t ratioQ16, ppmQ8;
+  if (rsQ != mq7conv::Q_INVALID && ppmTable_.lookup(rawQ4, ratioQ16, ppmQ8)) {
+    rs = rsQ * (1.0f / (1u << mq7conv::FRAC_BITS));
+    ratio = ratioQ16 * (1.0f / (1u << mq7conv::RATIO_FRAC_BITS));
+    ppm = ppmQ8 * (1.0f / (1u << mq7conv::PPM_FRAC_BITS));
+    return;
+  }
+#endif
+  rs = mq7conv::rawToRs(rawQ4 * (1.0f / (1u << mq7conv::FRAC_BITS)));
+  ratio = (isnan(rs) || !(r0_ > 0)) ? NAN : (rs / r0_);
+  ppm = mq7conv::ratioToPpm(ratio);
 }
 
-float Mq7Sensor::ratioToPpm_(float ratio) const {
-  if (!(ratio > 0)) return NAN;
-  // ppm = A * ratio^B (placeholder: fit da fare bene sulla tua curva)
-  return CO_A * powf(ratio, CO_B);
+void Mq7Sensor::setR0_(float r0) {
+  r0_ = r0;
+  ppmTable_.rebuild(r0_);
+  ratioFilter_.reset(); // il ratio salta: non mediarlo con quello vecchio
 }
 
 void Mq7Sensor::update(uint32_t nowMs) {
-  if (nowMs < nextSampleAtMs_) return;
+  if (burstPending_ && (int32_t)(nowMs - burstAtMs_) >= 0) {
+    sampler_->startBurst(MQ7_ADC_BURST_MS);
+    burstPending_ = false;
+  }
+  if ((int32_t)(nowMs - nextSampleAtMs_) < 0) return;
   nextSampleAtMs_ = nowMs + MQ7_PERIOD_MS;
+  if (MQ7_ADC_BURST_MS > 0) {
+    burstAtMs_ = nextSampleAtMs_ - MQ7_ADC_BURST_MS - BURST_LEAD_MS;
+    burstPending_ = true;
+  }
 
-  uint16_t raw = readAvgRaw_();
-  float vNode = rawToVnode_(raw);
+  uint32_t rawQ4;
+  if (!drainAvgRaw_(rawQ4)) { // nessun campione nuovo: resta l'ultima lettura
+    if (calibState_ == Mq7CalibState::COLLECTING) calibStep_(nowMs, NAN);
+    return;
+  }
+  // la media copre i campioni dall'ultimo drain, o solo la finestra ADC che
+  // chiude circa BURST_LEAD_MS prima: la lettura vale a metà
+  const uint64_t drainUs = hal::monoUs();
+  uint64_t atUs = lastDrainUs_ ? lastDrainUs_ + (drainUs - lastDrainUs_) / 2 : drainUs;
+  if (MQ7_ADC_BURST_MS > 0 && drainUs > BURST_MID_US) atUs = drainUs - BURST_MID_US;
+  lastDrainUs_ = drainUs;
+  const uint16_t raw = (uint16_t)((rawQ4 + (1u << (mq7conv::FRAC_BITS - 1))) >> mq7conv::FRAC_BITS);
+  float vNode = mq7conv::rawToVnode(rawQ4 * (1.0f / (1u << mq7conv::FRAC_BITS)));
   float vRl = vNode * DIVIDER_GAIN;     // ricostruisci VRL (prima del partitore)
-  float rs = computeRs_(vRl);
-  float ratio = (isnan(rs) || !(r0_ > 0)) ? NAN : (rs / r0_);
-  float ppm = ratioToPpm_(ratio);
-  bool warmupDone = isWarmupDone(nowMs);
+  float rs, ratio, ppm;
+  convert_(rawQ4, rs, ratio, ppm);
+  bool warmupDone = isWarmupDone();
 
   last_.raw = raw;
   last_.vNode = vNode;
@@ -66,52 +122,50 @@ void Mq7Sensor::update(uint32_t nowMs) {
   last_.ratio = ratio;
   last_.ppm = ppm;
   last_.ok = warmupDone && !isnan(ppm);
-}
-
-bool Mq7Sensor::calibrateNow(uint8_t samples) {
-  // Calibra R0 usando Rs attuale (devi essere in aria pulita)
-  if (!isWarmupDone(millis())) return false;
-  if (samples == 0) return false;
-
-  float rsValues[32];
-  if (samples > 32) samples = 32;
-  uint8_t rsCount = 0;
-  for (uint8_t i = 0; i < samples; i++) {
-    uint16_t raw = readAvgRaw_();
-    float vNode = rawToVnode_(raw);
-    float vRl = vNode * DIVIDER_GAIN;
-    float rs = computeRs_(vRl);
-    if (!isnan(rs) && rs > 0) {
-      rsValues[rsCount++] = rs;
-    }
-    delay(10);
-  }
+  last_.atUs = atUs;
 
-  if (rsCount < 2) return false;
+  if (isnan(ratio)) ratioFilter_.reset();
+  last_.ratioSmooth = isnan(ratio) ? NAN : ratioFilter_.add(ratio);
+  last_.ratioMedian = isnan(ratio) ? NAN : ratioFilter_.median();
 
-  float rsSum = 0.0f;
-  for (uint8_t i = 0; i < rsCount; i++) rsSum += rsValues[i];
-  float mean = rsSum / rsCount;
-  if (!(mean > 0)) return false;
+  if (calibState_ == Mq7CalibState::COLLECTING) calibStep_(nowMs, rs);
+}
 
-  float var = 0.0f;
-  for (uint8_t i = 0; i < rsCount; i++) {
-    float d = rsValues[i] - mean;
-    var += d * d;
+bool Mq7Sensor::startCalibration(uint8_t samples) {
+  // Calibra R0 usando Rs delle prossime letture (devi essere in aria pulita)
+  if (!isWarmupDone()) {
+    calibState_ = Mq7CalibState::FAILED;
+    return false;
   }
-  var /= rsCount;
-  float stddev = sqrtf(var);
-  float relStddev = stddev / mean;
-  if (relStddev > MQ7_CALIB_MAX_REL_STDDEV) return false;
-
-  r0_ = mean;
-  calibrated_ = true;
-  store_.save(r0_);
+  calibTarget_ = samples < CALIB_MIN_SAMPLES ? CALIB_MIN_SAMPLES : samples;
+  calibDeadlineMs_ = hal::millis() + MQ7_CALIB_TIMEOUT_MS;
+  calibRs_.reset();
+  calibState_ = Mq7CalibState::COLLECTING;
   return true;
 }
 
+void Mq7Sensor::calibStep_(uint32_t nowMs, float rs) {
+  // Rs grezzi: una mediana prima di Welford nasconderebbe proprio il rumore
+  // che il controllo di stabilità deve vedere.
+  if (!isnan(rs) && rs > 0) calibRs_.add(rs);
+
+  if (calibRs_.count() >= calibTarget_) {
+    if (calibRs_.relStddev() <= MQ7_CALIB_MAX_REL_STDDEV) {
+      setR0_(calibRs_.mean());
+      calibrated_ = true;
+      store_.save(r0_);
+      calibState_ = Mq7CalibState::DONE;
+      return;
+    }
+    // Finestra instabile (sensore ancora in deriva): si riparte con la successiva.
+    calibRs_.reset();
+  }
+  if ((int32_t)(nowMs - calibDeadlineMs_) >= 0) calibState_ = Mq7CalibState::FAILED;
+}
+
 void Mq7Sensor::resetCalibration() {
   store_.clear();
   calibrated_ = false;
-  r0_ = MQ7_R0_DEFAULT;
+  calibState_ = Mq7CalibState::IDLE;
+  setR0_(MQ7_R0_DEFAULT);
 }
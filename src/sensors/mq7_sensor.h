@@ -1,34 +1,113 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
 #include "sensors/mq7_types.h"
+#include "sensors/adc_sampler.h"
 #include "storage/r0_store.h"
+#include "sensors/mq7_convert.h"
+#include "util/stream_stats.h"
+#include "sensors/sensor_schema.h"
+
+#ifndef MQ7_USE_LUT
+#define MQ7_USE_LUT 1 // conversione a tabelle (0 = percorso float con powf)
+#endif
+#ifndef MQ7_RATIO_MEDIAN_N
+#define MQ7_RATIO_MEDIAN_N 5 // letture nella mediana del ratio (scarta spike fino a 2 letture)
+#endif
+#ifndef MQ7_RATIO_EMA_ALPHA
+#define MQ7_RATIO_EMA_ALPHA 0.3f // 1 = nessuno smussamento dopo la mediana
+#endif
+#ifndef MQ7_ADC_BURST_MS
+#define MQ7_ADC_BURST_MS 200 // ADC acceso solo per questa finestra prima di ogni campione (0 = sempre acceso)
+#endif
+#ifndef MQ7_CALIB_TIMEOUT_MS
+#define MQ7_CALIB_TIMEOUT_MS (5UL * 60UL * 1000UL) // senza finestra stabile entro questo tempo: FAILED
+#endif
+
+enum class Mq7CalibState : uint8_t { IDLE = 0, COLLECTING, DONE, FAILED };
 
 class Mq7Sensor {
 public:
+  using Reading = Mq7Reading;
+  // Anticipo dell'avvio della finestra ADC sul campione: avvio del DMA e
+  // risveglio del task, così la finestra è chiusa quando update() la svuota.
+  static constexpr uint32_t BURST_LEAD_MS = 20;
+  // Con le finestre ADC, da begin() alla prima lettura: la prima parte subito.
+  static constexpr uint32_t FIRST_SAMPLE_MS = MQ7_ADC_BURST_MS + BURST_LEAD_MS;
+  // mq7Level non viene dal sensore: lo scrive l'allarme (makeReadings).
+  static constexpr FieldDesc FIELDS[] = {
+      {"mq7Raw", "mq7Raw", FieldType::U16, offsetof(AppReadings, mq7Raw), 0, BinEnc::U16, 0, 1.0f, 0},
+      {"mq7Ratio", "mq7Ratio", FieldType::F32, offsetof(AppReadings, mq7Ratio), 4, BinEnc::U16, 0, 10000.0f,
+       FIELD_HISTORY},
+      {"mq7Ppm", "mq7Ppm", FieldType::F32, offsetof(AppReadings, mq7Ppm), 1, BinEnc::U16, 0, 10.0f, FIELD_HISTORY},
+      {"mq7R0", "mq7R0", FieldType::F32, offsetof(AppReadings, mq7R0), 1, BinEnc::VARINT, 0, 1.0f, 0},
+      {"mq7Ok", "mq7Ok", FieldType::BOOL, offsetof(AppReadings, mq7Ok), 0, BinEnc::FLAG, 1, 1.0f, FIELD_HISTORY},
+      {"mq7Calibrated", "mq7Calibrated", FieldType::BOOL, offsetof(AppReadings, mq7Calibrated), 0, BinEnc::FLAG, 2,
+       1.0f, FIELD_HISTORY},
+      {"mq7WarmupDone", "mq7WarmupDone", FieldType::BOOL, offsetof(AppReadings, mq7WarmupDone), 0, BinEnc::FLAG, 3,
+       1.0f, FIELD_HISTORY},
+      {"mq7Level", "mq7Level", FieldType::U8, offsetof(AppReadings, mq7Level), 0, BinEnc::FLAG, 4, 1.0f,
+       FIELD_HISTORY},
+  };
+  static void fill(const Mq7Reading& m, AppReadings& r) {
+    r.mq7Raw = m.raw;
+    r.mq7Ratio = m.ratio;
+    r.mq7Ppm = m.ppm;
+    r.mq7R0 = m.r0;
+    r.mq7Ok = m.ok;
+    r.mq7Calibrated = m.calibrated;
+    r.mq7WarmupDone = m.warmupDone;
+  }
+
+  // Sorgente campioni: di default il backend DMA su PIN_MQ7_ADC.
+  // Va impostata prima di begin() (es. sorgente sintetica su host).
+  void setSampler(AdcSampler* sampler) { sampler_ = sampler; }
   void begin();
   void update(uint32_t nowMs);
   Mq7Reading get() const { return last_; }
+  // Prossimo avvio della finestra ADC o, se già partita, prossimo campione.
+  uint32_t nextDeadlineMs() const { return burstPending_ ? burstAtMs_ : nextSampleAtMs_; }
 
-  // Calibrazione: chiama quando sei in aria pulita (dopo warmup)
-  // Salva R0 persistente
-  bool calibrateNow(uint8_t samples = 20);
+  // Calibrazione: chiama quando sei in aria pulita (dopo warmup).
+  // Non blocca: raccoglie un Rs per ogni update() e, appena una finestra di
+  // `samples` letture ha stddev relativa <= MQ7_CALIB_MAX_REL_STDDEV, salva R0
+  // persistente (DONE). false (e FAILED) se il warmup non è finito.
+  bool startCalibration(uint8_t samples = 20);
+  Mq7CalibState calibState() const { return calibState_; }
+  // Annulla una calibrazione in corso e torna a R0 di default.
   void resetCalibration();
   bool isCalibrated() const { return calibrated_; }
-  bool isWarmupDone(uint32_t nowMs) const { return nowMs >= warmupUntilMs_; }
+  bool isWarmupDone() const { return hal::monoUs() >= warmupUntilUs_; }
+  // Heater acceso già da elapsedMs (es. attraverso il deep sleep): dopo begin(),
+  // accorcia il warmup di conseguenza.
+  void setWarmupElapsed(uint32_t elapsedMs);
+  size_t bufferedSamples() const { return sampler_ ? sampler_->available() : 0; }
 
 private:
+  AdcSampler* sampler_ = nullptr;
   R0Store store_;
   float r0_ = NAN;
   bool calibrated_ = false;
-  uint32_t warmupUntilMs_ = 0;
+  uint64_t warmupUntilUs_ = 0; // a 64 bit: il warmup non "ricomincia" al wrap di millis()
   uint32_t nextSampleAtMs_ = 0;
+  uint32_t burstAtMs_ = 0;
+  bool burstPending_ = false; // finestra ADC del prossimo campione ancora da avviare
+  uint64_t lastDrainUs_ = 0;
 
   Mq7Reading last_;
 
-  uint16_t readAvgRaw_() const;
+  mq7conv::PpmTable ppmTable_; // segue r0_: rebuild() a ogni cambio
+  StreamStats<MQ7_RATIO_MEDIAN_N> ratioFilter_{MQ7_RATIO_EMA_ALPHA};
+
+  Mq7CalibState calibState_ = Mq7CalibState::IDLE;
+  uint8_t calibTarget_ = 0;
+  uint32_t calibDeadlineMs_ = 0;
+  RunningStats calibRs_; // Rs grezzi della finestra corrente
+
+  void setR0_(float r0);
+  void calibStep_(uint32_t nowMs, float rs);
 
-  // conversioni
-  float rawToVnode_(uint16_t raw) const;
-  float computeRs_(float vRl) const;
-  float ratioToPpm_(float ratio) const;
+  // media dei campioni accumulati dal sampler in Q.4 (false se non ce ne sono)
+  bool drainAvgRaw_(uint32_t& outQ4);
+  // raw Q.4 -> Rs, ratio, ppm (tabelle se MQ7_USE_LUT, altrimenti float)
+  void convert_(uint32_t rawQ4, float& rs, float& ratio, float& ppm) const;
 };
@@ -1,113 +1,178 @@
 #include "source/sd_logger.h"
 
 #include "config.h"
+#include "sensors/board_sensors.h"
+#include "util/log.h"
 
-#include <SPI.h>
-#include <SD.h>
 #include <math.h>
+#include <string.h>
 
 namespace {
 
-void printCsvFloat(File& f, float v, uint8_t decimals) {
-  if (!isnan(v)) {
-    f.print(v, decimals);
-  }
+// Riga CSV più lunga possibile (ts, millis + 11 campi della board completa) con margine.
+constexpr size_t MAX_ROW = 160;
+
+// Un campo con la virgola davanti; NaN -> campo vuoto, come prima con f.print()
+int formatCsvField(char* out, size_t cap, const FieldDesc& f, const AppReadings& r) {
+  const float v = fieldFloat(f, r);
+  if (f.type != FieldType::F32) return snprintf(out, cap, ",%lu", (unsigned long)fieldUint(f, r));
+  if (isnan(v)) return snprintf(out, cap, ",");
+  return snprintf(out, cap, ",%.*f", f.decimals, v);
 }
 
 } // namespace
 
 bool SdLogger::begin() {
-  SPI.begin(PIN_SD_SCK, PIN_SD_MISO, PIN_SD_MOSI, PIN_SD_CS);
-  pinMode(PIN_SD_CS, OUTPUT);
-  digitalWrite(PIN_SD_CS, HIGH);
-
-  Serial.printf("SD init pins CS=%d SCK=%d MISO=%d MOSI=%d\n",
-                PIN_SD_CS, PIN_SD_SCK, PIN_SD_MISO, PIN_SD_MOSI);
+  ready_ = hal::fsBegin();
 
-#if defined(ESP32)
-  // Many cheap SD modules are unstable at default SPI speed with long wires.
-  ready_ = SD.begin(PIN_SD_CS, SPI, 1000000U);
   if (!ready_) {
-    ready_ = SD.begin(PIN_SD_CS, SPI, 400000U);
+    LOGE(STORAGE, "SD init failed");
+    return false;
   }
-#else
-  ready_ = SD.begin(PIN_SD_CS);
-#endif
 
-  if (!ready_) {
-    Serial.println("SD init failed");
+  if (!ensureFileHasHeader_()) {
+    LOGE(STORAGE, "SD header write failed");
+    ready_ = false;
     return false;
   }
 
-  if (!ensureFileHasHeader_()) {
-    Serial.println("SD header write failed");
+  if (!openFile_()) {
+    LOGE(STORAGE, "SD open append failed");
     ready_ = false;
     return false;
   }
 
-  nextWriteAtMs_ = millis();
+  nextWriteAtMs_ = hal::millis();
+  nextSyncAtMs_ = hal::millis() + SD_SYNC_PERIOD_MS;
+  return true;
+}
+
+bool SdLogger::openFile_() {
+  if (!file_.open(SD_FILE_PATH, "a")) return false;
+  const size_t rem = file_.size() % SECTOR;
+  fileAlign_ = rem ? SECTOR - rem : 0;
   return true;
 }
 
 void SdLogger::update(uint32_t nowMs, const AppReadings& readings, uint32_t unixTs) {
   if (!ready_) return;
-  if (nowMs < nextWriteAtMs_) return;
 
-  nextWriteAtMs_ = nowMs + SD_PERIOD_MS;
-  if (!appendNow(readings, unixTs)) {
-    Serial.println("SD append failed");
+  if ((int32_t)(nowMs - nextWriteAtMs_) >= 0) {
+    nextWriteAtMs_ = nowMs + SD_PERIOD_MS;
+    if (!appendNow(readings, unixTs)) {
+      LOGE(STORAGE, "SD append failed");
+    }
+  }
+
+  if ((int32_t)(nowMs - nextSyncAtMs_) >= 0) {
+    nextSyncAtMs_ = nowMs + SD_SYNC_PERIOD_MS;
+    sync();
+  }
+}
+
+size_t SdLogger::formatRow(char* out, size_t cap, const AppReadings& readings, uint32_t unixTs, uint32_t ms) {
+  int n = snprintf(out, cap, "%lu,%lu", (unsigned long)unixTs, (unsigned long)ms);
+  for (const FieldDesc& f : READING_FIELDS) {
+    if (n <= 0 || (size_t)n >= cap) return 0;
+    n += formatCsvField(out + n, cap - n, f, readings);
+  }
+  if (n <= 0 || (size_t)n >= cap) return 0;
+  n += snprintf(out + n, cap - n, "\r\n");
+  return (n <= 0 || (size_t)n >= cap) ? 0 : (size_t)n;
+}
+
+size_t SdLogger::formatHeader(char* out, size_t cap) {
+  int n = snprintf(out, cap, "ts,millis");
+  for (const FieldDesc& f : READING_FIELDS) {
+    if (n <= 0 || (size_t)n >= cap) return 0;
+    n += snprintf(out + n, cap - n, ",%s", f.csv);
   }
+  return (n <= 0 || (size_t)n >= cap) ? 0 : (size_t)n;
 }
 
 bool SdLogger::appendNow(const AppReadings& readings, uint32_t unixTs) {
   if (!ready_) return false;
 
-  File f = SD.open(SD_FILE_PATH, FILE_APPEND);
-  if (!f) {
-    Serial.println("SD open append failed");
+  char row[MAX_ROW];
+  size_t n = formatRow(row, sizeof(row), readings, unixTs, hal::millis());
+  if (n == 0) return false;
+  if (len_ + n > sizeof(buf_)) {
+    // buffer pieno per errori di scrittura ripetuti: scarta la riga
+    stats_.errors++;
     return false;
   }
 
-  f.print(unixTs);
-  f.print(',');
-  f.print(millis());
-  f.print(',');
-  printCsvFloat(f, readings.tC, 2);
-  f.print(',');
-  printCsvFloat(f, readings.rh, 2);
-  f.print(',');
-  f.print(readings.dhtOk ? 1 : 0);
-  f.print(',');
-  f.print(readings.mq7Raw);
-  f.print(',');
-  printCsvFloat(f, readings.mq7Ratio, 4);
-  f.print(',');
-  printCsvFloat(f, readings.mq7Ppm, 1);
-  f.print(',');
-  printCsvFloat(f, readings.mq7R0, 1);
-  f.print(',');
-  f.print(readings.mq7Ok ? 1 : 0);
-  f.print(',');
-  f.print(readings.mq7Calibrated ? 1 : 0);
-  f.print(',');
-  f.print(readings.mq7WarmupDone ? 1 : 0);
-  f.print(',');
-  f.println(readings.mq7Level);
-
-  f.close();
+  memcpy(buf_ + len_, row, n);
+  len_ += n;
+  stats_.rows++;
+
+  // Solo settori interi: il primo completa l'allineamento del file.
+  for (;;) {
+    const size_t chunk = fileAlign_ ? fileAlign_ : SECTOR;
+    if (len_ < chunk) return true;
+    if (!writeOut_(chunk)) return false;
+  }
+}
+
+bool SdLogger::sync() {
+  if (!ready_) return false;
+  bool ok = len_ == 0 || writeOut_(len_);
+  if (file_) {
+    file_.flush();
+    stats_.syncs++;
+  }
+  return ok;
+}
+
+bool SdLogger::writeOut_(size_t n) {
+  if (!file_ && !openFile_()) {
+    stats_.errors++;
+    return false;
+  }
+
+  const uint32_t t0 = hal::micros();
+  size_t written = file_.write(buf_, n);
+  const uint32_t us = hal::micros() - t0;
+
+  stats_.flushes++;
+  stats_.lastFlushUs = us;
+  if (us > stats_.maxFlushUs) stats_.maxFlushUs = us;
+  stats_.lastFlushBytes = written;
+  stats_.bytesWritten += written;
+
+  if (written != n) {
+    // Scheda rimossa o errore: riapre al prossimo giro, il buffer resta.
+    stats_.errors++;
+    file_.close();
+    return false;
+  }
+
+  fileAlign_ = (fileAlign_ + SECTOR - n % SECTOR) % SECTOR;
+  len_ -= n;
+  memmove(buf_, buf_ + n, len_);
   return true;
 }
 
+void SdLogger::printStats(Print& out) const {
+  out.printf("sd: rows=%u flushes=%u syncs=%u err=%u last=%uB/%uus max=%uus total=%llu B\n",
+             (unsigned)stats_.rows, (unsigned)stats_.flushes, (unsigned)stats_.syncs, (unsigned)stats_.errors,
+             (unsigned)stats_.lastFlushBytes, (unsigned)stats_.lastFlushUs, (unsigned)stats_.maxFlushUs,
+             (unsigned long long)stats_.bytesWritten);
+}
+
 bool SdLogger::ensureFileHasHeader_() {
-  if (SD.exists(SD_FILE_PATH)) return true;
+  if (hal::fsExists(SD_FILE_PATH)) return true;
 
-  File f = SD.open(SD_FILE_PATH, FILE_WRITE);
-  if (!f) {
-    Serial.println("SD open write failed");
+  hal::File f;
+  if (!f.open(SD_FILE_PATH, "w")) {
+    LOGE(STORAGE, "SD open write failed");
     return false;
   }
 
-  f.println("ts,millis,tC,rh,dhtOk,mq7Raw,mq7Ratio,mq7Ppm,mq7R0,mq7Ok,mq7Calibrated,mq7WarmupDone,mq7Level");
-  f.close();
-  return true;
+  char line[MAX_ROW + 2];
+  size_t n = formatHeader(line, MAX_ROW);
+  if (n == 0) return false;
+  line[n++] = '\r';
+  line[n++] = '\n';
+  return f.write(line, n) == n;
 }
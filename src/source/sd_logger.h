@@ -1,19 +1,62 @@
 #pragma once
 
-#include <Arduino.h>
+#include "hal/hal.h"
+#include "hal/hal_fs.h"
 #include "app/app_state.h"
 
+#ifndef SD_SYNC_PERIOD_MS
+#define SD_SYNC_PERIOD_MS 10000 // finestra massima di perdita dati su power-fail
+#endif
+
+// Logger CSV bufferizzato: le righe vengono formattate in RAM e scritte su un
+// file che resta aperto, a settori interi da 512 byte allineati all'offset del
+// file. Ogni SD_SYNC_PERIOD_MS si scrive anche il settore parziale e si fa flush.
 class SdLogger {
 public:
+  static constexpr size_t SECTOR = 512;
+
+  struct Stats {
+    uint32_t rows = 0;
+    uint32_t flushes = 0;      // scritture verso la SD
+    uint32_t syncs = 0;        // flush del file (directory entry aggiornata)
+    uint32_t errors = 0;
+    uint32_t lastFlushUs = 0;
+    uint32_t maxFlushUs = 0;
+    uint32_t lastFlushBytes = 0;
+    uint64_t bytesWritten = 0;
+  };
+
   bool begin();
   void update(uint32_t nowMs, const AppReadings& readings, uint32_t unixTs = 0);
   bool appendNow(const AppReadings& readings, uint32_t unixTs = 0);
+  // Scrive tutto il buffer (anche il settore parziale) e fa flush del file.
+  bool sync();
+  // Riga CSV (con "\r\n") in out; 0 se non ci sta. Colonne: ts, millis e i
+  // campi dei sensori della board (READING_FIELDS, board_sensors.h).
+  static size_t formatRow(char* out, size_t cap, const AppReadings& readings, uint32_t unixTs, uint32_t ms);
+  // Intestazione corrispondente (senza "\r\n"); con tutti i sensori è envlog::CSV_HEADER.
+  static size_t formatHeader(char* out, size_t cap);
 
   bool isReady() const { return ready_; }
+  // Prima fra prossima scrittura e prossimo sync (solo se isReady()).
+  uint32_t nextDeadlineMs() const {
+    return (int32_t)(nextSyncAtMs_ - nextWriteAtMs_) < 0 ? nextSyncAtMs_ : nextWriteAtMs_;
+  }
+  const Stats& stats() const { return stats_; }
+  void printStats(Print& out) const;
 
 private:
   bool ensureFileHasHeader_();
+  bool openFile_();
+  bool writeOut_(size_t n);
 
   bool ready_ = false;
   uint32_t nextWriteAtMs_ = 0;
+  uint32_t nextSyncAtMs_ = 0;
+
+  hal::File file_;
+  char buf_[2 * SECTOR];
+  size_t len_ = 0;
+  size_t fileAlign_ = 0; // byte mancanti per allineare il file a SECTOR
+  Stats stats_;
 };
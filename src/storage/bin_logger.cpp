@@ -0,0 +1,162 @@
+#include "storage/bin_logger.h"
+#include "config.h"
+#include "util/log.h"
+
+#include <time.h>
+
+using envlog::Record;
+
+static uint32_t dayKey(uint32_t unixTs) {
+  if (unixTs == 0) return 0;
+  time_t t = (time_t)unixTs;
+  struct tm tmv;
+  gmtime_r(&t, &tmv);
+  return (uint32_t)(tmv.tm_year + 1900) * 10000u + (uint32_t)(tmv.tm_mon + 1) * 100u + (uint32_t)tmv.tm_mday;
+}
+
+Record toLogRecord(const AppReadings& r, uint32_t unixTs, uint32_t ms) {
+  Record rec;
+  rec.ts = unixTs;
+  rec.millis = ms;
+  rec.tC = r.tC;
+  rec.rh = r.rh;
+  rec.mq7Ratio = r.mq7Ratio;
+  rec.mq7Ppm = r.mq7Ppm;
+  rec.mq7R0 = r.mq7R0;
+  rec.mq7Raw = r.mq7Raw;
+  rec.flags = (r.dhtOk ? envlog::FLAG_DHT_OK : 0) | (r.mq7Ok ? envlog::FLAG_MQ7_OK : 0) |
+              (r.mq7Calibrated ? envlog::FLAG_MQ7_CALIBRATED : 0) |
+              (r.mq7WarmupDone ? envlog::FLAG_MQ7_WARMUP_DONE : 0);
+  rec.mq7Level = r.mq7Level;
+  return rec;
+}
+
+AppReadings fromLogRecord(const Record& rec) {
+  AppReadings r;
+  r.tC = rec.tC;
+  r.rh = rec.rh;
+  r.dhtOk = rec.flags & envlog::FLAG_DHT_OK;
+  r.mq7Raw = rec.mq7Raw;
+  r.mq7Ratio = rec.mq7Ratio;
+  r.mq7Ppm = rec.mq7Ppm;
+  r.mq7R0 = rec.mq7R0;
+  r.mq7Ok = rec.flags & envlog::FLAG_MQ7_OK;
+  r.mq7Calibrated = rec.flags & envlog::FLAG_MQ7_CALIBRATED;
+  r.mq7WarmupDone = rec.flags & envlog::FLAG_MQ7_WARMUP_DONE;
+  r.mq7Level = rec.mq7Level;
+  return r;
+}
+
+bool BinLogger::begin() {
+  if (!hal::fsExists(BINLOG_DIR) && !hal::fsMkdir(BINLOG_DIR)) {
+    LOGE(STORAGE, "BinLog: mkdir failed");
+    return false;
+  }
+  ready_ = true;
+  nextWriteAtMs_ = hal::millis();
+  nextSyncAtMs_ = hal::millis() + SD_SYNC_PERIOD_MS;
+  return true;
+}
+
+void BinLogger::update(uint32_t nowMs, const AppReadings& readings, uint32_t unixTs) {
+  if (!ready_) return;
+
+  if ((int32_t)(nowMs - nextWriteAtMs_) >= 0) {
+    nextWriteAtMs_ = nowMs + SD_PERIOD_MS;
+    if (!append(readings, unixTs)) {
+      LOGE(STORAGE, "BinLog append failed");
+    }
+  }
+
+  if ((int32_t)(nowMs - nextSyncAtMs_) >= 0) {
+    nextSyncAtMs_ = nowMs + SD_SYNC_PERIOD_MS;
+    sync();
+  }
+}
+
+bool BinLogger::append(const AppReadings& readings, uint32_t unixTs) {
+  if (!ready_) return false;
+  if (!rotateIfNeeded_(unixTs)) return false;
+
+  Record& rec = buf_[bufCount_++];
+  rec = toLogRecord(readings, unixTs, hal::millis());
+
+  // Indice sparso: un entry ogni INDEX_STRIDE record, solo con ora valida.
+  if (unixTs != 0 && (!indexed_ || fileRecords_ - lastIndexed_ >= envlog::INDEX_STRIDE)) {
+    envlog::IndexEntry e{unixTs, fileRecords_};
+    idx_.write(&e, sizeof(e));
+    lastIndexed_ = fileRecords_;
+    indexed_ = true;
+  }
+  fileRecords_++;
+
+  // Il header occupa lo slot 0: si scrive quando il settore è completo.
+  if ((fileRecords_ + 1) % SLOTS_PER_SECTOR == 0) return flushRecords_();
+  return true;
+}
+
+bool BinLogger::sync() {
+  if (!bin_) return true;
+  bool ok = flushRecords_();
+  bin_.flush();
+  idx_.flush();
+  return ok;
+}
+
+bool BinLogger::rotateIfNeeded_(uint32_t unixTs) {
+  const uint32_t day = dayKey(unixTs);
+  const bool dayChanged = day != 0 && day != day_;
+  const bool full = (uint64_t)(fileRecords_ + 1) * sizeof(Record) >= BINLOG_MAX_FILE_BYTES;
+  if (bin_ && !dayChanged && !full) return true;
+
+  close_();
+  return openNew_(unixTs);
+}
+
+bool BinLogger::openNew_(uint32_t unixTs) {
+  const uint32_t day = dayKey(unixTs);
+  char binPath[40];
+  char idxPath[40];
+  for (unsigned seq = 0; seq < 100; seq++) {
+    snprintf(binPath, sizeof(binPath), "%s/%08lu-%02u.bin", BINLOG_DIR, (unsigned long)day, seq);
+    if (!hal::fsExists(binPath)) {
+      snprintf(idxPath, sizeof(idxPath), "%s/%08lu-%02u.idx", BINLOG_DIR, (unsigned long)day, seq);
+      break;
+    }
+    binPath[0] = '\0';
+  }
+  if (!binPath[0]) return false;
+
+  if (!bin_.open(binPath, "w") || !idx_.open(idxPath, "w")) {
+    close_();
+    return false;
+  }
+
+  envlog::FileHeader h{};
+  h.magic = envlog::FILE_MAGIC;
+  h.version = envlog::FILE_VERSION;
+  h.recordSize = sizeof(Record);
+  h.createdTs = unixTs;
+  bin_.write(&h, sizeof(h));
+
+  day_ = day;
+  fileRecords_ = 0;
+  indexed_ = false;
+  LOGI(STORAGE, "BinLog: %s", binPath);
+  return true;
+}
+
+bool BinLogger::flushRecords_() {
+  if (bufCount_ == 0) return true;
+  const size_t bytes = bufCount_ * sizeof(Record);
+  bool ok = bin_ && bin_.write(buf_, bytes) == bytes;
+  bufCount_ = 0;
+  return ok;
+}
+
+void BinLogger::close_() {
+  if (bin_) flushRecords_();
+  bin_.close();
+  idx_.close();
+  bufCount_ = 0;
+}
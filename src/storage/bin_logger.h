@@ -0,0 +1,59 @@
+#pragma once
+#include "hal/hal.h"
+#include "hal/hal_fs.h"
+#include "app/app_state.h"
+#include "storage/log_record.h"
+#include "source/sd_logger.h"
+
+#ifndef SD_LOG_BINARY
+#define SD_LOG_BINARY 0 // 1 = scrive anche il log binario /log/*.bin
+#endif
+#ifndef BINLOG_DIR
+#define BINLOG_DIR "/log"
+#endif
+#ifndef BINLOG_MAX_FILE_BYTES
+#define BINLOG_MAX_FILE_BYTES (4UL * 1024UL * 1024UL)
+#endif
+
+// Lettura <-> record fisso da 32 byte (stesse colonne del CSV); ms = millis della riga.
+envlog::Record toLogRecord(const AppReadings& r, uint32_t unixTs, uint32_t ms);
+AppReadings fromLogRecord(const envlog::Record& rec);
+
+// Log binario a record fissi (envlog::Record), ruotato per giorno (UTC) o per
+// dimensione, con un indice temporale sparso accanto a ogni file.
+// Richiede la SD già montata (SdLogger::begin).
+class BinLogger {
+public:
+  bool begin();
+  void update(uint32_t nowMs, const AppReadings& readings, uint32_t unixTs);
+  bool append(const AppReadings& readings, uint32_t unixTs);
+  bool sync();
+
+  bool isReady() const { return ready_; }
+  // Prima fra prossima scrittura e prossimo sync (solo se isReady()).
+  uint32_t nextDeadlineMs() const {
+    return (int32_t)(nextSyncAtMs_ - nextWriteAtMs_) < 0 ? nextSyncAtMs_ : nextWriteAtMs_;
+  }
+
+private:
+  static constexpr size_t SLOTS_PER_SECTOR = 512 / sizeof(envlog::Record);
+
+  bool rotateIfNeeded_(uint32_t unixTs);
+  bool openNew_(uint32_t unixTs);
+  bool flushRecords_();
+  void close_();
+
+  bool ready_ = false;
+  uint32_t nextWriteAtMs_ = 0;
+  uint32_t nextSyncAtMs_ = 0;
+
+  hal::File bin_;
+  hal::File idx_;
+  uint32_t day_ = 0;          // AAAAMMGG del file aperto (0 = ora non valida)
+  uint32_t fileRecords_ = 0;  // record nel file (scritti + in buffer)
+  uint32_t lastIndexed_ = 0;
+  bool indexed_ = false;
+
+  envlog::Record buf_[SLOTS_PER_SECTOR];
+  size_t bufCount_ = 0;
+};
@@ -0,0 +1,116 @@
+#include "storage/history.h"
+#include <math.h>
+
+template <typename T>
+static bool allocRing(T*& buf, uint32_t& cap, uint32_t slots) {
+  buf = static_cast<T*>(hal::allocLarge(sizeof(T) * slots));
+  cap = buf ? slots : 0;
+  return buf != nullptr;
+}
+
+bool History::begin() {
+  if (ready_) return true;
+  psram_ = hal::hasPsram();
+  ready_ = allocRing(raw_.buf, raw_.cap, psram_ ? HISTORY_RAW_SLOTS_PSRAM : HISTORY_RAW_SLOTS) &&
+           allocRing(minutes_.buf, minutes_.cap, psram_ ? HISTORY_MINUTE_SLOTS_PSRAM : HISTORY_MINUTE_SLOTS) &&
+           allocRing(hours_.buf, hours_.cap, psram_ ? HISTORY_HOUR_SLOTS_PSRAM : HISTORY_HOUR_SLOTS);
+  return ready_;
+}
+
+// Chiude il periodo aperto se il campione è di un periodo nuovo, poi lo accumula.
+void History::fold_(HistRollup& cur, uint32_t& curKey, Ring<HistRollup>& ring, uint32_t key, const HistSample& s) {
+  if (cur.samples > 0 && key != curKey) {
+    ring.push(cur);
+    cur = HistRollup{};
+  }
+  if (cur.samples == 0) {
+    curKey = key;
+    cur.startMs = s.ms;
+    cur.ts = s.ts;
+  }
+  cur.samples++;
+  cur.flags |= s.flags;
+  if (s.level > cur.maxLevel) cur.maxLevel = s.level;
+  if (isfinite(s.tC)) cur.tC.add(s.tC);
+  if (isfinite(s.rh)) cur.rh.add(s.rh);
+  if (isfinite(s.ratio)) cur.ratio.add(s.ratio);
+  if (isfinite(s.ppm)) cur.ppm.add(s.ppm);
+}
+
+void History::add(uint32_t nowMs, uint32_t unixTs, const AppReadings& r) {
+  if (!ready_) return;
+  if (haveRaw_ && nowMs - lastRawMs_ < HISTORY_RAW_PERIOD_MS) return;
+  // cadenza fissa anche se il chiamante gira a tick più larghi; dopo un buco si riallinea
+  const bool late = !haveRaw_ || nowMs - lastRawMs_ >= 2 * HISTORY_RAW_PERIOD_MS;
+  lastRawMs_ = late ? nowMs : lastRawMs_ + HISTORY_RAW_PERIOD_MS;
+  haveRaw_ = true;
+
+  const uint8_t flags = (r.dhtOk ? HIST_DHT_OK : 0) | (r.mq7Ok ? HIST_MQ7_OK : 0) |
+                        (r.mq7Calibrated ? HIST_MQ7_CALIBRATED : 0) | (r.mq7WarmupDone ? HIST_MQ7_WARMUP_DONE : 0);
+  const HistSample s{nowMs,
+                     unixTs,
+                     r.dhtOk ? r.tC : NAN,
+                     r.dhtOk ? r.rh : NAN,
+                     r.mq7Ok ? r.mq7Ratio : NAN,
+                     r.mq7Ok ? r.mq7Ppm : NAN,
+                     flags,
+                     r.mq7Level};
+
+  seq_.writeBegin();
+  raw_.push(s);
+  fold_(minute_, minuteKey_, minutes_, nowMs / MINUTE_MS, s);
+  fold_(hour_, hourKey_, hours_, nowMs / HOUR_MS, s);
+  seq_.writeEnd();
+}
+
+static bool after(uint32_t ms, uint32_t afterMs) { return (int32_t)(ms - afterMs) > 0; }
+
+size_t History::copyRaw(HistSample* out, size_t max, uint32_t afterMs) const {
+  if (!ready_) return 0;
+  size_t n;
+  uint32_t s;
+  do {
+    s = seq_.readBegin();
+    const uint32_t size = raw_.size();
+    uint32_t i = 0;
+    while (i < size && !after(raw_.at(i).ms, afterMs)) i++; // in ordine di ms
+    n = 0;
+    for (; i < size && n < max; i++) out[n++] = raw_.at(i);
+  } while (seq_.readRetry(s));
+  return n;
+}
+
+size_t History::copyRollups_(const Ring<HistRollup>& ring, const HistRollup& open, HistRollup* out, size_t max,
+                             uint32_t afterMs) const {
+  if (!ready_) return 0;
+  size_t n;
+  uint32_t s;
+  do {
+    s = seq_.readBegin();
+    const uint32_t size = ring.size();
+    uint32_t i = 0;
+    while (i < size && !after(ring.at(i).startMs, afterMs)) i++;
+    n = 0;
+    for (; i < size && n < max; i++) out[n++] = ring.at(i);
+    if (n < max && open.samples > 0 && after(open.startMs, afterMs)) out[n++] = open;
+  } while (seq_.readRetry(s));
+  return n;
+}
+
+size_t History::copyMinutes(HistRollup* out, size_t max, uint32_t afterMs) const {
+  return copyRollups_(minutes_, minute_, out, max, afterMs);
+}
+
+size_t History::copyHours(HistRollup* out, size_t max, uint32_t afterMs) const {
+  return copyRollups_(hours_, hour_, out, max, afterMs);
+}
+
+size_t History::bytes() const {
+  return raw_.cap * sizeof(HistSample) + (minutes_.cap + hours_.cap) * sizeof(HistRollup);
+}
+
+void History::printStats(Print& out) const {
+  out.printf("history: raw=%u/%u min=%u/%u hour=%u/%u %uB %s\n", (unsigned)raw_.size(), (unsigned)raw_.cap,
+             (unsigned)minutes_.size(), (unsigned)minutes_.cap, (unsigned)hours_.size(), (unsigned)hours_.cap,
+             (unsigned)bytes(), psram_ ? "psram" : "ram");
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include "hal/hal.h"
+#include "util/seqlock.h"
+#include "app/app_state.h"
+#include "util/stream_stats.h"
+
+#ifndef HISTORY_RAW_PERIOD_MS
+#define HISTORY_RAW_PERIOD_MS 1000 // un campione grezzo al secondo
+#endif
+// Capacità (slot) in RAM interna e con PSRAM. Grezzi: 5 / 15 minuti;
+// minuti: 2 / 24 ore; ore: 2 / 30 giorni.
+#ifndef HISTORY_RAW_SLOTS
+#define HISTORY_RAW_SLOTS 300
+#endif
+#ifndef HISTORY_MINUTE_SLOTS
+#define HISTORY_MINUTE_SLOTS 120
+#endif
+#ifndef HISTORY_HOUR_SLOTS
+#define HISTORY_HOUR_SLOTS 48
+#endif
+#ifndef HISTORY_RAW_SLOTS_PSRAM
+#define HISTORY_RAW_SLOTS_PSRAM 900
+#endif
+#ifndef HISTORY_MINUTE_SLOTS_PSRAM
+#define HISTORY_MINUTE_SLOTS_PSRAM 1440
+#endif
+#ifndef HISTORY_HOUR_SLOTS_PSRAM
+#define HISTORY_HOUR_SLOTS_PSRAM 720
+#endif
+
+// Bit di HistSample::flags / HistRollup::flags (come il log binario)
+enum HistFlags : uint8_t {
+  HIST_DHT_OK = 0x01,
+  HIST_MQ7_OK = 0x02,
+  HIST_MQ7_CALIBRATED = 0x04,
+  HIST_MQ7_WARMUP_DONE = 0x08,
+};
+
+struct HistSample {
+  uint32_t ms;  // millis() del campione
+  uint32_t ts;  // unix (0 se l'ora non era ancora valida)
+  float tC;
+  float rh;
+  float ratio;
+  float ppm;
+  uint8_t flags;
+  uint8_t level; // livello allarme MQ-7 (0..3)
+};
+
+// min/mean/max (e stddev) di un minuto o di un'ora, aggiornati campione per
+// campione. I NaN (sensore non pronto) non entrano: count per campo.
+struct HistRollup {
+  uint32_t startMs; // primo campione del periodo
+  uint32_t ts;      // unix del primo campione (0 se non valida)
+  uint32_t samples;
+  uint8_t flags;    // OR dei flag dei campioni
+  uint8_t maxLevel; // livello allarme peggiore nel periodo
+  RunningStats tC;
+  RunningStats rh;
+  RunningStats ratio;
+  RunningStats ppm;
+};
+
+// Storico a memoria fissa: ring di campioni grezzi + ring di rollup per
+// minuto e per ora (periodi di uptime, non di calendario). Un solo scrittore
+// (task storage); le copy*() si possono chiamare da qualunque task e
+// ripetono la copia se nel frattempo è arrivato un campione (come SeqLock).
+class History {
+public:
+  static constexpr uint32_t MINUTE_MS = 60UL * 1000UL;
+  static constexpr uint32_t HOUR_MS = 60UL * MINUTE_MS;
+
+  // Alloca i ring (capacità *_PSRAM se c'è PSRAM, vedi hal::allocLarge). false se manca memoria.
+  bool begin();
+  // Chiamabile a ogni tick: tiene un campione ogni HISTORY_RAW_PERIOD_MS.
+  void add(uint32_t nowMs, uint32_t unixTs, const AppReadings& r);
+  // Quando add() terrà il prossimo campione (subito se non ce n'è ancora uno).
+  uint32_t nextDeadlineMs() const { return lastRawMs_ + HISTORY_RAW_PERIOD_MS; }
+
+  // I primi max elementi (in ordine cronologico) con ms / startMs dopo
+  // afterMs, tipicamente now - finestra: per leggere a pezzi si ripete con
+  // afterMs = ms dell'ultimo ricevuto finché ne tornano max. I rollup
+  // includono in coda il periodo ancora aperto.
+  size_t copyRaw(HistSample* out, size_t max, uint32_t afterMs) const;
+  size_t copyMinutes(HistRollup* out, size_t max, uint32_t afterMs) const;
+  size_t copyHours(HistRollup* out, size_t max, uint32_t afterMs) const;
+  // Finestra coperta dal ring dei grezzi quando è pieno.
+  uint32_t rawSpanMs() const { return raw_.cap * HISTORY_RAW_PERIOD_MS; }
+
+  bool isReady() const { return ready_; }
+  bool inPsram() const { return psram_; }
+  size_t bytes() const;
+  void printStats(Print& out) const;
+
+private:
+  template <typename T>
+  struct Ring {
+    T* buf = nullptr;
+    uint32_t cap = 0;
+    uint32_t written = 0;
+
+    void push(const T& v) {
+      buf[written % cap] = v;
+      written++;
+    }
+    uint32_t size() const { return written < cap ? written : cap; }
+    const T& at(uint32_t i) const { return buf[(written - size() + i) % cap]; } // 0 = più vecchio
+  };
+
+  static void fold_(HistRollup& cur, uint32_t& curKey, Ring<HistRollup>& ring, uint32_t key, const HistSample& s);
+  size_t copyRollups_(const Ring<HistRollup>& ring, const HistRollup& open, HistRollup* out, size_t max,
+                      uint32_t afterMs) const;
+
+  bool ready_ = false;
+  bool psram_ = false;
+  bool haveRaw_ = false;
+  uint32_t lastRawMs_ = 0;
+
+  Ring<HistSample> raw_;
+  Ring<HistRollup> minutes_;
+  Ring<HistRollup> hours_;
+  HistRollup minute_{};
+  HistRollup hour_{};
+  uint32_t minuteKey_ = 0;
+  uint32_t hourKey_ = 0;
+
+  SeqCount seq_;
+};
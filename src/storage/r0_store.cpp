@@ -1,47 +1,52 @@
 #include "storage/r0_store.h"
 
-#if defined(ESP32)
-  #include <Preferences.h>
-  static Preferences prefs;
+#if defined(ARDUINO)
+#include <esp_attr.h>
+#else
+#define RTC_DATA_ATTR
 #endif
 
+static constexpr const char* KEY_R0 = "mq7_r0";
+
+enum CacheState : uint8_t { CACHE_EMPTY = 0, CACHE_NONE, CACHE_VALUE };
+
+// Ricaricata a ogni boot che non sia un risveglio dal deep sleep; condivisa da tutti gli R0Store.
+RTC_DATA_ATTR static uint8_t cacheState = CACHE_EMPTY;
+RTC_DATA_ATTR static float cachedR0 = 0.0f;
+
 void R0Store::begin() {
-#if defined(ESP32)
-  prefs.begin("envmon", false);
-#endif
-  inited_ = true;
+  if (cacheState != CACHE_EMPTY) return; // risveglio: la copia RTC basta
+  if (!open_()) return;
+  if (hal::nvsHas(KEY_R0)) {
+    cachedR0 = hal::nvsGetFloat(KEY_R0, 0.0f);
+    cacheState = CACHE_VALUE;
+  } else {
+    cacheState = CACHE_NONE;
+  }
+}
+
+bool R0Store::open_() {
+  if (!inited_) inited_ = hal::nvsBegin();
+  return inited_;
 }
 
 float R0Store::load(float fallback) const {
-#if defined(ESP32)
-  if (!inited_) return fallback;
-  return prefs.getFloat("mq7_r0", fallback);
-#else
-  return fallback;
-#endif
+  return cacheState == CACHE_VALUE ? cachedR0 : fallback;
 }
 
 void R0Store::save(float r0) {
-#if defined(ESP32)
-  if (!inited_) return;
-  prefs.putFloat("mq7_r0", r0);
-#else
-  (void)r0;
-#endif
+  if (!open_()) return;
+  hal::nvsPutFloat(KEY_R0, r0);
+  cachedR0 = r0;
+  cacheState = CACHE_VALUE;
 }
 
 bool R0Store::hasValue() const {
-#if defined(ESP32)
-  if (!inited_) return false;
-  return prefs.isKey("mq7_r0");
-#else
-  return false;
-#endif
+  return cacheState == CACHE_VALUE;
 }
 
 void R0Store::clear() {
-#if defined(ESP32)
-  if (!inited_) return;
-  prefs.remove("mq7_r0");
-#endif
+  if (!open_()) return;
+  hal::nvsRemove(KEY_R0);
+  cacheState = CACHE_NONE;
 }
@@ -1,6 +1,9 @@
 #pragma once
-#include <Arduino.h>
+#include "hal/hal.h"
 
+// R0 persistente in NVS, con una copia in memoria RTC: sopravvive al deep
+// sleep, così a un risveglio begin()/load() non aprono l'NVS (solo save() e
+// clear() la scrivono).
 class R0Store {
 public:
   void begin();
@@ -10,5 +13,7 @@ public:
   void clear();
 
 private:
-  mutable bool inited_ = false;
+  bool open_();
+
+  bool inited_ = false;
 };
@@ -0,0 +1,33 @@
+#include "time/time_model.h"
+#include <math.h>
+
+static constexpr float DRIFT_EMA_ALPHA = 0.3f;
+
+uint64_t TimeModel::utcUs(uint64_t monoUs) const {
+  if (!valid()) return 0;
+  const int64_t d = (int64_t)(monoUs - monoRef_);
+  return utcRef_ + d + (int64_t)((double)d * driftPpm_ * 1e-6);
+}
+
+void TimeModel::sync(uint64_t monoUs, uint64_t utcUs) {
+  if (!valid()) {
+    monoAnchor_ = monoUs;
+    utcAnchor_ = utcUs;
+  } else {
+    lastErrorUs_ = (int64_t)(utcUs - this->utcUs(monoUs));
+    const int64_t span = (int64_t)(monoUs - monoAnchor_);
+    if (span >= (int64_t)TIME_DRIFT_MIN_SPAN_S * 1000000) {
+      const double ppm = ((double)(int64_t)(utcUs - utcAnchor_) - (double)span) * 1e6 / (double)span;
+      if (fabs(ppm) <= TIME_DRIFT_MAX_PPM) {
+        driftPpm_ = driftKnown_ ? driftPpm_ + DRIFT_EMA_ALPHA * ((float)ppm - driftPpm_) : (float)ppm;
+        driftKnown_ = true;
+      }
+      // salto d'ora o no, la prossima stima parte da qui
+      monoAnchor_ = monoUs;
+      utcAnchor_ = utcUs;
+    }
+  }
+  monoRef_ = monoUs;
+  utcRef_ = utcUs;
+  syncs_++;
+}
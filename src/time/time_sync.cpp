@@ -1,9 +1,39 @@
 #include "time/time_sync.h"
+#include "time/time_model.h"
+#include "hal/hal.h"
+#include "util/log.h"
+#include "util/seqlock.h"
+
+#include <esp_sntp.h>
+#include <sys/time.h>
 #include <time.h>
 
 namespace timeutil {
 
+// Scritto solo dal callback SNTP (task lwIP), letto da tutti.
+static SeqLock<TimeModel> model;
+
+static uint64_t toUs(const struct timeval& tv) { return (uint64_t)tv.tv_sec * 1000000u + (uint64_t)tv.tv_usec; }
+
+static void addSync(uint64_t monoUs, uint64_t utcUs) {
+  TimeModel m;
+  model.read(m);
+  m.sync(monoUs, utcUs);
+  model.write(m);
+  LOGI(SYS, "NTP sync #%u: error %d ms, drift %.1f ppm", (unsigned)m.syncs(), (int)(m.lastErrorUs() / 1000),
+       m.driftPpm());
+}
+
+static void onSync(struct timeval* tv) { addSync(hal::monoUs(), toUs(*tv)); }
+
 void beginNtp() {
+  // Ora già valida (riavvio software, risveglio dal deep sleep): fa da prima sync.
+  if (isTimeValid() && model.version() == 0) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    addSync(hal::monoUs(), toUs(tv));
+  }
+  sntp_set_time_sync_notification_cb(onSync);
   // UTC (0,0). La timezone la gestisci dopo se ti serve.
   configTime(0, 0, "pool.ntp.org", "time.google.com", "time.cloudflare.com");
 }
@@ -19,4 +49,19 @@ uint32_t unixTime() {
   return (uint32_t)time(nullptr);
 }
 
-} // namespace timeutil
\ No newline at end of file
+uint64_t unixUsAt(uint64_t monoUs) {
+  TimeModel m;
+  model.read(m);
+  return m.utcUs(monoUs);
+}
+
+uint32_t unixAt(uint64_t monoUs) { return monoUs ? (uint32_t)(unixUsAt(monoUs) / 1000000u) : unixTime(); }
+
+void printStats(Print& out) {
+  TimeModel m;
+  model.read(m);
+  out.printf("time: syncs=%u drift=%.1fppm last_err=%dms valid=%s\n", (unsigned)m.syncs(), m.driftPpm(),
+             (int)(m.lastErrorUs() / 1000), isTimeValid() ? "Y" : "N");
+}
+
+} // namespace timeutil
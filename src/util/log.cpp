@@ -0,0 +1,451 @@
+#include "util/log.h"
+#include "util/mpsc_ring.h"
+#include <atomic>
+#include <stdio.h>
+
+#if defined(ARDUINO)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+namespace logging {
+
+static constexpr size_t MODS = (size_t)Mod::COUNT;
+static constexpr size_t MAX_FORMATS = 64; // formati con id nel modo binario
+static constexpr size_t LINE_MAX = 192;   // riga di testo con prefisso
+
+// Frame binari (little endian), decodificati da tools/logdecode/logdecode.js:
+//   DEF  A6 len id:u16 fmt...                      primo uso di un formato
+//   MSG  A5 len ms:u32 lvl<<4|mod id:u16 nargs args...   argomenti come nel ring
+//   TEXT A7 len ms:u32 lvl<<4|mod text...          già formattato (tabella piena)
+static constexpr uint8_t FRAME_MSG = 0xA5;
+static constexpr uint8_t FRAME_DEF = 0xA6;
+static constexpr uint8_t FRAME_TEXT = 0xA7;
+
+static MpscRing<Record, LOG_RING_SLOTS> ring;
+static std::atomic<uint8_t> levels[MODS];
+static std::atomic<uint32_t> rate[MODS]; // finestra (16 bit alti) | messaggi nella finestra
+static std::atomic<uint16_t> rateMax{LOG_RATE_MAX};
+static std::atomic<uint32_t> droppedRate{0};
+static std::atomic<uint32_t> truncated{0};
+static std::atomic<bool> binary{LOG_BINARY != 0};
+static std::atomic<bool> formatsSent{false}; // false = ridefinire i formati (nuovo sink)
+static std::atomic_flag draining = ATOMIC_FLAG_INIT;
+static Print* sink = &Serial;
+
+// solo chi scarica (draining)
+static uint32_t written = 0;
+static uint32_t reportedFull = 0;
+static uint32_t reportedRate = 0;
+static const char* formats[MAX_FORMATS];
+static size_t formatCount = 0;
+
+#if defined(ARDUINO)
+static TaskHandle_t task = nullptr;
+
+static void drainTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    flush();
+  }
+}
+#endif
+
+static struct LevelInit {
+  LevelInit() {
+    for (auto& l : levels) l.store(LOG_DEFAULT_LEVEL, std::memory_order_relaxed);
+  }
+} levelInit;
+
+void begin(Print& out) {
+  setSink(out);
+#if defined(ARDUINO)
+  if (!task) xTaskCreatePinnedToCore(drainTask, "log", 3072, nullptr, 1, &task, 0);
+#endif
+}
+
+void setSink(Print& out) {
+  sink = &out;
+  formatsSent.store(false, std::memory_order_relaxed);
+}
+void setLevel(Mod m, Level l) { levels[(size_t)m].store((uint8_t)l, std::memory_order_relaxed); }
+Level level(Mod m) { return (Level)levels[(size_t)m].load(std::memory_order_relaxed); }
+void setBinary(bool on) { binary.store(on, std::memory_order_relaxed); }
+void setRateLimit(uint16_t perWindow) { rateMax.store(perWindow, std::memory_order_relaxed); }
+
+Stats stats() {
+  return {written, ring.dropped(), droppedRate.load(std::memory_order_relaxed),
+          truncated.load(std::memory_order_relaxed)};
+}
+
+void printStats(Print& out) {
+  const Stats s = stats();
+  out.printf("log: written=%u dropped_full=%u dropped_rate=%u truncated=%u pending=%u mode=%s\n",
+             (unsigned)s.written, (unsigned)s.droppedFull, (unsigned)s.droppedRate, (unsigned)s.truncated,
+             (unsigned)ring.size(), binary.load() ? "binary" : "text");
+}
+
+const char* levelName(Level l) {
+  switch (l) {
+  case Level::ERROR:
+    return "E";
+  case Level::WARN:
+    return "W";
+  case Level::INFO:
+    return "I";
+  case Level::DEBUG:
+    return "D";
+  default:
+    return "-";
+  }
+}
+
+const char* modName(Mod m) {
+  static const char* const NAMES[MODS] = {"sys", "sensor", "alarm", "storage", "net", "display"};
+  return (size_t)m < MODS ? NAMES[(size_t)m] : "?";
+}
+
+namespace detail {
+
+bool allow(Level l, Mod m) {
+  if (l == Level::NONE || (uint8_t)l > levels[(size_t)m].load(std::memory_order_relaxed)) return false;
+  const uint16_t max = rateMax.load(std::memory_order_relaxed);
+  if (max == 0) return true;
+  const uint32_t win = (hal::millis() / LOG_RATE_WINDOW_MS) & 0xFFFF;
+  std::atomic<uint32_t>& r = rate[(size_t)m];
+  uint32_t cur = r.load(std::memory_order_relaxed);
+  for (;;) {
+    const uint32_t count = (cur >> 16) == win ? (cur & 0xFFFF) : 0;
+    if (count >= max) {
+      droppedRate.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    if (r.compare_exchange_weak(cur, (win << 16) | (count + 1), std::memory_order_relaxed)) return true;
+  }
+}
+
+static void wake() {
+#if defined(ARDUINO)
+  if (task) {
+    xTaskNotifyGive(task);
+    return;
+  }
+#endif
+  flush(); // nessun task: scarico nel chiamante
+}
+
+void push(Level l, Mod m, const char* fmt, uint8_t nargs, EncodeFn enc, const void* args) {
+  ring.push([&](Record& r) {
+    r.ms = hal::millis();
+    r.fmt = fmt;
+    r.level = (uint8_t)l;
+    r.mod = (uint8_t)m;
+    r.nargs = nargs;
+    Writer w{r.data, r.data + PAYLOAD, false};
+    enc(w, args);
+    r.len = (uint8_t)(w.p - r.data);
+    if (w.cut) truncated.fetch_add(1, std::memory_order_relaxed);
+  });
+  wake();
+}
+
+} // namespace detail
+
+namespace {
+
+struct Arg {
+  uint8_t tag = 0;
+  int64_t i = 0;
+  uint64_t u = 0;
+  double f = 0;
+  const char* s = "";
+  uint8_t slen = 0;
+};
+
+struct Reader {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  bool next(Arg& a) {
+    if (p >= end) return false;
+    a.tag = *p++;
+    size_t n = a.tag == ARG_I64 || a.tag == ARG_U64 ? 8 : 4;
+    if (a.tag == ARG_STR) {
+      if (p >= end) return false;
+      a.slen = *p++;
+      n = a.slen;
+    }
+    if ((size_t)(end - p) < n) return false;
+    int32_t i32;
+    uint32_t u32;
+    float f32;
+    switch (a.tag) {
+    case ARG_I32:
+      memcpy(&i32, p, 4);
+      a.i = i32;
+      a.u = (uint64_t)(int64_t)i32;
+      a.f = i32;
+      break;
+    case ARG_U32:
+      memcpy(&u32, p, 4);
+      a.i = u32;
+      a.u = u32;
+      a.f = u32;
+      break;
+    case ARG_I64:
+      memcpy(&a.i, p, 8);
+      a.u = (uint64_t)a.i;
+      a.f = (double)a.i;
+      break;
+    case ARG_U64:
+      memcpy(&a.u, p, 8);
+      a.i = (int64_t)a.u;
+      a.f = (double)a.u;
+      break;
+    case ARG_F32:
+      memcpy(&f32, p, 4);
+      a.f = f32;
+      a.i = (int64_t)f32;
+      a.u = (uint64_t)a.i;
+      break;
+    case ARG_STR:
+      a.s = reinterpret_cast<const char*>(p);
+      a.i = 0;
+      a.u = 0;
+      a.f = 0;
+      break;
+    default:
+      return false;
+    }
+    p += n;
+    return true;
+  }
+
+  int nextInt() {
+    Arg a;
+    return next(a) ? (int)a.i : 0;
+  }
+};
+
+// Una conversione con i '*' già letti (0, 1 o 2).
+template <typename T>
+int formatOne(char* out, size_t cap, const char* spec, const int* stars, int nstars, T v) {
+  if (nstars == 2) return snprintf(out, cap, spec, stars[0], stars[1], v);
+  if (nstars == 1) return snprintf(out, cap, spec, stars[0], v);
+  return snprintf(out, cap, spec, v);
+}
+
+} // namespace
+
+// Rifà la printf conversione per conversione: i modificatori di lunghezza del
+// formato (l, h, z...) si ignorano, il tipo lo dice il tag dell'argomento.
+size_t formatRecord(const Record& r, char* out, size_t cap) {
+  if (cap == 0) return 0;
+  size_t n = 0;
+  auto emit = [&](const char* s, size_t k) {
+    if (k > cap - 1 - n) k = cap - 1 - n;
+    memcpy(out + n, s, k);
+    n += k;
+  };
+
+  Reader rd{r.data, r.data + r.len};
+  const char* f = r.fmt;
+  while (*f && n < cap - 1) {
+    if (*f != '%') {
+      const char* pct = strchr(f, '%');
+      const size_t k = pct ? (size_t)(pct - f) : strlen(f);
+      emit(f, k);
+      f += k;
+      continue;
+    }
+    if (f[1] == '%') {
+      emit("%", 1);
+      f += 2;
+      continue;
+    }
+
+    char spec[24];
+    size_t sl = 0;
+    int stars[2];
+    int nstars = 0;
+    spec[sl++] = *f++;
+    while (*f && strchr("-+ #0", *f) && sl < 8) spec[sl++] = *f++;
+    if (*f == '*') {
+      stars[nstars++] = rd.nextInt();
+      spec[sl++] = *f++;
+    }
+    while (*f >= '0' && *f <= '9' && sl < 12) spec[sl++] = *f++;
+    if (*f == '.') {
+      spec[sl++] = *f++;
+      if (*f == '*') {
+        stars[nstars++] = rd.nextInt();
+        spec[sl++] = *f++;
+      }
+      while (*f >= '0' && *f <= '9' && sl < 18) spec[sl++] = *f++;
+    }
+    while (*f && strchr("hljztLq", *f)) f++;
+    const char conv = *f;
+    if (!conv) break;
+    f++;
+
+    Arg a;
+    if (!rd.next(a)) {
+      emit("?", 1);
+      continue;
+    }
+    char tmp[LINE_MAX];
+    int k = 0;
+    switch (conv) {
+    case 'd':
+    case 'i':
+      memcpy(spec + sl, "lld", 4);
+      k = formatOne(tmp, sizeof(tmp), spec, stars, nstars, (long long)a.i);
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      spec[sl] = 'l';
+      spec[sl + 1] = 'l';
+      spec[sl + 2] = conv;
+      spec[sl + 3] = '\0';
+      k = formatOne(tmp, sizeof(tmp), spec, stars, nstars, (unsigned long long)a.u);
+      break;
+    case 'c':
+      spec[sl] = 'c';
+      spec[sl + 1] = '\0';
+      k = formatOne(tmp, sizeof(tmp), spec, stars, nstars, (int)a.i);
+      break;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec[sl] = conv;
+      spec[sl + 1] = '\0';
+      k = formatOne(tmp, sizeof(tmp), spec, stars, nstars, a.f);
+      break;
+    case 's': {
+      char str[256];
+      const size_t len = a.tag == ARG_STR ? a.slen : 0;
+      if (len) memcpy(str, a.s, len);
+      str[len] = '\0';
+      spec[sl] = 's';
+      spec[sl + 1] = '\0';
+      k = formatOne(tmp, sizeof(tmp), spec, stars, nstars, (const char*)str);
+      break;
+    }
+    case 'p':
+      k = snprintf(tmp, sizeof(tmp), "0x%llx", (unsigned long long)a.u);
+      break;
+    default:
+      k = 0;
+      break;
+    }
+    if (k > 0) emit(tmp, (size_t)k < sizeof(tmp) ? (size_t)k : sizeof(tmp) - 1);
+  }
+  out[n] = '\0';
+  return n;
+}
+
+size_t formatLine(const Record& r, char* out, size_t cap) {
+  if (cap < 2) return 0;
+  int n = snprintf(out, cap - 1, "[%lu.%03lu] %s %s: ", (unsigned long)(r.ms / 1000), (unsigned long)(r.ms % 1000),
+                   levelName((Level)r.level), modName((Mod)r.mod));
+  if (n < 0) return 0;
+  if ((size_t)n > cap - 2) n = (int)(cap - 2);
+  n += (int)formatRecord(r, out + n, cap - n - 1);
+  out[n++] = '\n';
+  out[n] = '\0';
+  return (size_t)n;
+}
+
+size_t encodeMsg(const Record& r, uint16_t id, uint8_t* out, size_t cap) {
+  if (cap < 8u + r.len) return 0;
+  memcpy(out, &r.ms, 4);
+  out[4] = (uint8_t)(r.level << 4 | r.mod);
+  out[5] = (uint8_t)id;
+  out[6] = (uint8_t)(id >> 8);
+  out[7] = r.nargs;
+  memcpy(out + 8, r.data, r.len);
+  return 8u + r.len;
+}
+
+static void emitText(const Record& r) {
+  char line[LINE_MAX];
+  const size_t n = formatLine(r, line, sizeof(line));
+  if (n > 0) sink->write(reinterpret_cast<const uint8_t*>(line), n);
+}
+
+static void emitFrame(uint8_t type, const uint8_t* body, size_t n) {
+  uint8_t head[2] = {type, (uint8_t)n};
+  sink->write(head, 2);
+  sink->write(body, n);
+}
+
+static void emitBinary(const Record& r) {
+  uint8_t body[8 + PAYLOAD];
+
+  if (!formatsSent.exchange(true, std::memory_order_relaxed)) formatCount = 0;
+  size_t id = 0;
+  while (id < formatCount && formats[id] != r.fmt) id++;
+  if (id == formatCount && formatCount < MAX_FORMATS) {
+    formats[formatCount++] = r.fmt;
+    uint8_t def[2 + 250];
+    size_t len = strlen(r.fmt);
+    if (len > 250) len = 250;
+    def[0] = (uint8_t)id;
+    def[1] = (uint8_t)(id >> 8);
+    memcpy(def + 2, r.fmt, len);
+    emitFrame(FRAME_DEF, def, 2 + len);
+  }
+  if (id == MAX_FORMATS) {
+    // tabella dei formati piena: si formatta qui
+    memcpy(body, &r.ms, 4);
+    body[4] = (uint8_t)(r.level << 4 | r.mod);
+    const size_t n = formatRecord(r, reinterpret_cast<char*>(body + 5), PAYLOAD + 3);
+    emitFrame(FRAME_TEXT, body, 5 + n);
+    return;
+  }
+  emitFrame(FRAME_MSG, body, encodeMsg(r, (uint16_t)id, body, sizeof(body)));
+}
+
+static void emit(const Record& r) {
+  if (binary.load(std::memory_order_relaxed)) {
+    emitBinary(r);
+  } else {
+    emitText(r);
+  }
+  written++;
+}
+
+void flush() {
+  while (draining.test_and_set(std::memory_order_acquire)) hal::delayMs(1); // scarica già il task
+  while (ring.pop(emit)) {
+  }
+
+  // scarti dall'ultimo giro: una riga sola, fuori dal ring (che può essere pieno)
+  const uint32_t full = ring.dropped();
+  const uint32_t rated = droppedRate.load(std::memory_order_relaxed);
+  if (full != reportedFull || rated != reportedRate) {
+    Record r;
+    r.ms = hal::millis();
+    r.fmt = "dropped %u (ring full), %u (rate limit)";
+    r.level = (uint8_t)Level::WARN;
+    r.mod = (uint8_t)Mod::SYS;
+    r.nargs = 2;
+    detail::Writer w{r.data, r.data + PAYLOAD, false};
+    detail::put(w, full - reportedFull);
+    detail::put(w, rated - reportedRate);
+    r.len = (uint8_t)(w.p - r.data);
+    reportedFull = full;
+    reportedRate = rated;
+    emit(r);
+  }
+  draining.clear(std::memory_order_release);
+}
+
+} // namespace logging
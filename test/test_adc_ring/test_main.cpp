@@ -0,0 +1,157 @@
+// Ring SPSC, BufferedAdcSampler, media del drain e finestre ADC di Mq7Sensor.
+#include <unity.h>
+#include <atomic>
+#include <thread>
+
+#include "config.h"
+#include "hal/hal_native.h"
+#include "sensors/adc_sampler.h"
+#include "sensors/mq7_sensor.h"
+#include "util/spsc_ring.h"
+
+void setUp() { hal::native::nvsClear(); }
+void tearDown() {}
+
+static void test_ring_fifo_and_full() {
+  SpscRing<uint16_t, 8> ring;
+  for (uint16_t i = 0; i < 8; i++) TEST_ASSERT_TRUE(ring.push(i));
+  TEST_ASSERT_FALSE(ring.push(99)); // pieno: scartato e contato
+  TEST_ASSERT_EQUAL_UINT32(1, ring.dropped());
+  TEST_ASSERT_EQUAL(8, ring.size());
+
+  uint16_t v;
+  for (uint16_t i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(ring.pop(v));
+    TEST_ASSERT_EQUAL_UINT16(i, v);
+  }
+  TEST_ASSERT_FALSE(ring.pop(v));
+}
+
+// Indici oltre la capacità: l'ordine resta giusto a ogni giro.
+static void test_ring_wraps() {
+  SpscRing<uint16_t, 4> ring;
+  uint16_t v;
+  for (uint16_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_TRUE(ring.push((uint16_t)(i + 1)));
+    TEST_ASSERT_TRUE(ring.pop(v));
+    TEST_ASSERT_EQUAL_UINT16(i, v);
+    TEST_ASSERT_TRUE(ring.pop(v));
+    TEST_ASSERT_EQUAL_UINT16(i + 1, v);
+  }
+  TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+// Produttore e consumatore su thread diversi: sequenza crescente, i buchi
+// sono esattamente i campioni scartati a ring pieno.
+static void test_ring_concurrent() {
+  static SpscRing<uint32_t, 256> ring;
+  static std::atomic<bool> done{false};
+  constexpr uint32_t N = 200000;
+  std::thread producer([] {
+    for (uint32_t i = 1; i <= N; i++) ring.push(i);
+    done.store(true);
+  });
+  uint32_t last = 0, popped = 0, gaps = 0, v;
+  for (;;) {
+    const bool finished = done.load(); // letto prima del pop: dopo, il ring è l'ultimo stato
+    if (!ring.pop(v)) {
+      if (finished) break;
+      continue;
+    }
+    TEST_ASSERT_GREATER_THAN(last, v);
+    gaps += v - last - 1;
+    last = v;
+    popped++;
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL_UINT32(N, popped + ring.dropped());
+  TEST_ASSERT_EQUAL_UINT32(ring.dropped(), gaps + (N - last));
+}
+
+static void test_sampler_feed_drain() {
+  BufferedAdcSampler s;
+  uint16_t in[BufferedAdcSampler::RING_SIZE + 10];
+  for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); i++) in[i] = (uint16_t)i;
+  TEST_ASSERT_EQUAL(BufferedAdcSampler::RING_SIZE, s.feed(in, sizeof(in) / sizeof(in[0])));
+  TEST_ASSERT_EQUAL_UINT32(10, s.dropped());
+  TEST_ASSERT_EQUAL(BufferedAdcSampler::RING_SIZE, s.available());
+
+  uint16_t out[100];
+  TEST_ASSERT_EQUAL(100, s.drain(out, 100));
+  TEST_ASSERT_EQUAL_UINT16(0, out[0]);
+  TEST_ASSERT_EQUAL_UINT16(99, out[99]);
+  TEST_ASSERT_EQUAL(BufferedAdcSampler::RING_SIZE - 100, s.available());
+}
+
+// Un periodo di campioni costanti (250 Hz) -> raw uguale; ring vuoto = lettura invariata.
+static void test_mq7_averages_window() {
+  BufferedAdcSampler s;
+  Mq7Sensor mq7;
+  mq7.setSampler(&s);
+  mq7.begin();
+
+  uint16_t window[250];
+  for (size_t i = 0; i < 250; i++) window[i] = (uint16_t)(i % 2 ? 1201 : 1199);
+  s.feed(window, 250);
+  hal::native::setMillis(mq7.nextDeadlineMs()); // prima lettura (dopo la prima finestra ADC)
+  mq7.update(hal::millis());
+  TEST_ASSERT_EQUAL_UINT16(1200, mq7.get().raw);
+  TEST_ASSERT_EQUAL(0, s.available());
+
+  hal::native::advanceMs(MQ7_PERIOD_MS);
+  mq7.update(hal::millis());
+  TEST_ASSERT_EQUAL_UINT16(1200, mq7.get().raw);
+}
+
+// Sorgente a finestre: registra le richieste di startBurst().
+class BurstSampler : public BufferedAdcSampler {
+public:
+  void startBurst(uint32_t ms) override {
+    bursts++;
+    lastMs = ms;
+  }
+  uint32_t bursts = 0;
+  uint32_t lastMs = 0;
+};
+
+// Con MQ7_ADC_BURST_MS la prima finestra ADC parte in begin() (prima lettura
+// dopo FIRST_SAMPLE_MS, non dopo un periodo), le altre prima di ogni campione
+// e la scadenza del sensore le segue.
+static void test_mq7_starts_burst_before_sample() {
+  if (MQ7_ADC_BURST_MS == 0) return;
+  BurstSampler s;
+  Mq7Sensor mq7;
+  mq7.setSampler(&s);
+  const uint32_t t0 = hal::millis();
+  mq7.begin();
+  TEST_ASSERT_EQUAL_UINT32(1, s.bursts);
+  TEST_ASSERT_EQUAL_UINT32(MQ7_ADC_BURST_MS, s.lastMs);
+  const uint32_t first = mq7.nextDeadlineMs();
+  TEST_ASSERT_EQUAL_UINT32(t0 + Mq7Sensor::FIRST_SAMPLE_MS, first);
+
+  hal::native::setMillis(first);
+  mq7.update(first);
+  TEST_ASSERT_EQUAL_UINT32(1, s.bursts);
+  const uint32_t burstAt = mq7.nextDeadlineMs();
+  TEST_ASSERT_TRUE((int32_t)(burstAt - first) > 0);
+  TEST_ASSERT_TRUE((int32_t)(first + MQ7_PERIOD_MS - MQ7_ADC_BURST_MS - burstAt) >= 0);
+  hal::native::setMillis(burstAt);
+  mq7.update(burstAt);
+  TEST_ASSERT_EQUAL_UINT32(2, s.bursts);
+  TEST_ASSERT_EQUAL_UINT32(first + MQ7_PERIOD_MS, mq7.nextDeadlineMs());
+
+  mq7.update(burstAt + 1); // già partita: niente doppioni
+  TEST_ASSERT_EQUAL_UINT32(2, s.bursts);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_fifo_and_full);
+  RUN_TEST(test_ring_wraps);
+  RUN_TEST(test_ring_concurrent);
+  RUN_TEST(test_sampler_feed_drain);
+  RUN_TEST(test_mq7_averages_window);
+  RUN_TEST(test_mq7_starts_burst_before_sample);
+  return UNITY_END();
+}
@@ -0,0 +1,86 @@
+// Regole d'allarme di default (AlarmEngine) su scenari sintetici.
+#include <unity.h>
+
+#include "config.h"
+#include "app/alarm_rules.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Un campione al secondo; conta i cambi di livello dopo il primo.
+struct AlarmRun {
+  AlarmEngine engine;
+  AlarmInputs in;
+  uint32_t nowMs = 0;
+  uint32_t changes = 0;
+  AlarmLevel level = AlarmLevel::UNKNOWN;
+
+  AlarmRun() { engine.compile(defaultAlarmRules()); }
+  void step(float ratio) {
+    in[AlarmSignal::MQ7_RATIO] = ratio;
+    nowMs += 1000;
+    const AlarmLevel next = engine.evaluate(nowMs, in);
+    if (next != level && level != AlarmLevel::UNKNOWN) changes++;
+    level = next;
+  }
+};
+
+static void test_default_rules_compile() {
+  AlarmEngine engine;
+  TEST_ASSERT_TRUE(engine.compile(defaultAlarmRules()));
+  TEST_ASSERT_GREATER_THAN(0, engine.ruleCount());
+}
+
+// Rumore di +-0.01 attorno alla soglia WARN: una sola transizione.
+static void test_noise_at_threshold_does_not_flap() {
+  AlarmRun run;
+  for (int i = 0; i < 30; i++) run.step(0.95f);
+  for (int i = 0; i < 120; i++) run.step(MQ7_RATIO_WARN_LT + (i & 1 ? 0.01f : -0.01f));
+  TEST_ASSERT_EQUAL_UINT32(1, run.changes);
+  TEST_ASSERT_EQUAL(AlarmLevel::WARN, run.level);
+}
+
+// Discesa rapida ancora sopra soglia: la pendenza anticipa il WARN.
+static void test_fast_drop_warns_before_threshold() {
+  AlarmRun run;
+  for (int i = 0; i < 70; i++) run.step(0.98f);
+  float ratio = 0.98f;
+  for (int i = 0; i < 30 && run.level != AlarmLevel::WARN; i++) {
+    ratio -= 0.004f;
+    run.step(ratio);
+  }
+  TEST_ASSERT_EQUAL(AlarmLevel::WARN, run.level);
+  TEST_ASSERT_GREATER_THAN_FLOAT(MQ7_RATIO_WARN_LT, ratio);
+}
+
+// WARN + caldo -> DANGER.
+static void test_co_with_heat_is_danger() {
+  AlarmRun run;
+  run.in[AlarmSignal::TEMP_C] = ALARM_HEAT_TEMP_C + 10.0f;
+  for (int i = 0; i < 10; i++) run.step(MQ7_RATIO_WARN_LT - 0.05f);
+  TEST_ASSERT_EQUAL(AlarmLevel::DANGER, run.level);
+}
+
+// Rientro: DANGER finché il ratio non resta sopra l'isteresi per ALARM_EXIT_MS.
+static void test_release_after_exit_dwell() {
+  AlarmRun run;
+  for (int i = 0; i < 10; i++) run.step(MQ7_RATIO_DANGER_LT - 0.1f);
+  TEST_ASSERT_EQUAL(AlarmLevel::DANGER, run.level);
+  uint32_t heldMs = 0;
+  while (run.level == AlarmLevel::DANGER && heldMs < 60000) {
+    run.step(0.98f);
+    heldMs += 1000;
+  }
+  TEST_ASSERT_EQUAL(AlarmLevel::OK, run.level);
+  TEST_ASSERT_GREATER_OR_EQUAL(ALARM_EXIT_MS, heldMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_default_rules_compile);
+  RUN_TEST(test_noise_at_threshold_does_not_flap);
+  RUN_TEST(test_fast_drop_warns_before_threshold);
+  RUN_TEST(test_co_with_heat_is_danger);
+  RUN_TEST(test_release_after_exit_dwell);
+  return UNITY_END();
+}
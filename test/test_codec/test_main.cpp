@@ -0,0 +1,72 @@
+// Schema generato dai sensori contro i formati fissi: intestazione CSV,
+// record binario v1 e trailer delle tracce di latenza, byte per byte.
+#include <unity.h>
+#include <string.h>
+
+#include "net/telemetry_codec.h"
+#include "sensors/board_sensors.h"
+#include "source/sd_logger.h"
+#include "storage/log_record.h"
+
+static AppReadings r;
+static net::TelemetryPayload item;
+static uint8_t bin[64];
+
+// Intestazione del frame binario col device id "x": magic + versione, id, ts base.
+static constexpr size_t BIN_HEADER = 5 + 1 + 4;
+
+void setUp() {
+  r = AppReadings{};
+  r.tC = 21.5f;
+  r.rh = 48.25f;
+  r.dhtOk = true;
+  r.mq7Raw = 1800;
+  r.mq7Ratio = 0.8123f;
+  r.mq7Ppm = 12.3f;
+  r.mq7R0 = 10000.0f;
+  r.mq7Ok = r.mq7Calibrated = r.mq7WarmupDone = true;
+  r.mq7Level = 1;
+  r.atUs = 1000;
+  r.alarmUs = 1100;
+  item = net::TelemetryPayload{r, 1700000000u, 2100};
+  memset(bin, 0, sizeof(bin));
+}
+void tearDown() {}
+
+// Con tutti i sensori della board l'intestazione è quella di envlog.
+static void test_csv_header_v1() {
+  char header[160];
+  TEST_ASSERT_TRUE(SdLogger::formatHeader(header, sizeof(header)) > 0);
+  if (READING_FIELDS.size() == WIRE_V1_FIELDS.size()) TEST_ASSERT_EQUAL_STRING(envlog::CSV_HEADER, header);
+}
+
+static void test_binary_record_v1() {
+  static const uint8_t expected[] = {0x00, 0x1F, 0x66, 0x08, 0xD9, 0x12, 0x08, 0x07,
+                                     0xBB, 0x1F, 0x7B, 0x00, 0x90, 0x4E};
+  const size_t n = net::encodeBinaryBatch("x", &item, 1, bin, sizeof(bin));
+  TEST_ASSERT_EQUAL(BIN_HEADER + sizeof(expected), n);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, bin + BIN_HEADER, sizeof(expected));
+}
+
+// atMs 1700000000123, batch precedente 300 us + 45 ms; ritardi 100, 1000, 2900 us
+static void test_trace_trailer() {
+  net::BatchTrace trace;
+  trace.encodeUs = 5000;
+  trace.atMs = 1700000000123ull;
+  trace.prevSendUs = 300;
+  trace.prevAckUs = 45000;
+  static const uint8_t expected[] = {'T',  0x7B, 0x68, 0xE5, 0xCF, 0x8B, 0x01, 0x00, 0x00, 0xAC,
+                                     0x02, 0xC8, 0xDF, 0x02, 0x65, 0xE8, 0x07, 0xD4, 0x16};
+  const size_t n = net::encodeBinaryBatch("x", &item, 1, bin, sizeof(bin));
+  const size_t nt = net::encodeBinaryBatch("x", &item, 1, bin, sizeof(bin), &trace);
+  TEST_ASSERT_EQUAL(n + sizeof(expected), nt);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, bin + n, sizeof(expected));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_csv_header_v1);
+  RUN_TEST(test_binary_record_v1);
+  RUN_TEST(test_trace_trailer);
+  return UNITY_END();
+}
@@ -0,0 +1,62 @@
+// Decoder DHT (dhtproto) sui treni di impulsi registrati e sui casi d'errore.
+#include <unity.h>
+#include <string.h>
+
+#include "sensors/dht_decode.h"
+
+// Treni di impulsi come li consegna l'RMT (1 tick = 1 us, basso per primo,
+// dal resto dello start): DHT11 45.0 %RH 23.4 C, DHT22 61.3 %RH -4.7 C.
+static const uint16_t DHT11_PULSES[] = {
+    14, 31, 81, 84, 53, 24, 54, 28, 48, 68, 56, 23, 53, 72, 48, 72, 51, 23, 49, 71, 54, 23, 51, 23, 56, 26,
+    48, 29, 49, 24, 48, 27, 54, 23, 51, 23, 56, 29, 50, 25, 54, 24, 56, 68, 52, 27, 50, 68, 51, 70, 49, 72,
+    49, 27, 48, 27, 51, 26, 56, 26, 53, 26, 55, 70, 52, 24, 50, 28, 51, 23, 52, 72, 55, 25, 55, 25, 49, 68,
+    56, 26, 50, 29, 53, 24, 53};
+static const uint16_t DHT22_PULSES[] = {
+    14, 31, 81, 84, 54, 23, 49, 29, 56, 27, 53, 25, 53, 27, 55, 27, 55, 68, 49, 25, 55, 28, 49, 68, 52, 73,
+    55, 25, 54, 28, 53, 68, 55, 25, 50, 72, 49, 71, 48, 24, 52, 24, 51, 26, 54, 29, 55, 23, 50, 26, 54, 27,
+    52, 24, 54, 29, 56, 70, 54, 25, 54, 69, 50, 68, 50, 69, 51, 73, 51, 23, 55, 29, 50, 25, 52, 68, 50, 26,
+    56, 70, 53, 69, 56, 27, 55};
+static constexpr size_t DHT_PULSES_N = sizeof(DHT11_PULSES) / sizeof(DHT11_PULSES[0]);
+
+static uint8_t frame[dhtproto::FRAME_BYTES];
+
+void setUp() { memset(frame, 0, sizeof(frame)); }
+void tearDown() {}
+
+static void assertDecodes(const uint16_t* pulses, uint8_t type, float tC, float rh) {
+  TEST_ASSERT_EQUAL(DhtStatus::OK, dhtproto::decode(pulses, DHT_PULSES_N, 0, frame));
+  float t, h;
+  dhtproto::convert(frame, type, t, h);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, tC, t);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, rh, h);
+}
+
+static void test_dht11_frame() { assertDecodes(DHT11_PULSES, 11, 23.4f, 45.0f); }
+
+static void test_dht22_negative_temperature() { assertDecodes(DHT22_PULSES, 22, -4.7f, 61.3f); }
+
+static void test_checksum_mismatch() {
+  uint16_t flipped[DHT_PULSES_N];
+  memcpy(flipped, DHT11_PULSES, sizeof(flipped));
+  flipped[4 + 2 * 8 + 1] = 70; // bit 7 del secondo byte: 0 -> 1
+  TEST_ASSERT_EQUAL(DhtStatus::CHECKSUM, dhtproto::decode(flipped, DHT_PULSES_N, 0, frame));
+}
+
+static void test_truncated_frame() {
+  TEST_ASSERT_EQUAL(DhtStatus::SHORT_FRAME, dhtproto::decode(DHT11_PULSES, 60, 0, frame));
+}
+
+static void test_no_response() {
+  const uint16_t idle[] = {5000};
+  TEST_ASSERT_EQUAL(DhtStatus::NO_RESPONSE, dhtproto::decode(idle, 1, 1, frame));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dht11_frame);
+  RUN_TEST(test_dht22_negative_temperature);
+  RUN_TEST(test_checksum_mismatch);
+  RUN_TEST(test_truncated_frame);
+  RUN_TEST(test_no_response);
+  return UNITY_END();
+}
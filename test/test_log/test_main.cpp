@@ -0,0 +1,73 @@
+// Logger asincrono: il record riformattato dal drain deve dare lo stesso
+// testo di snprintf con gli stessi argomenti, e la riga il prefisso fisso.
+#include <unity.h>
+#include <string.h>
+
+#include "hal/hal_native.h"
+#include "util/log.h"
+
+// Un record del logger come lo riempie una LOGx.
+template <typename... A>
+static void fillRecord(logging::Record& r, const char* fmt, const A&... args) {
+  r.ms = hal::millis();
+  r.fmt = fmt;
+  r.level = (uint8_t)logging::Level::INFO;
+  r.mod = (uint8_t)logging::Mod::SYS;
+  r.nargs = sizeof...(A);
+  logging::detail::Writer w{r.data, r.data + logging::PAYLOAD, false};
+  (logging::detail::put(w, args), ...);
+  r.len = (uint8_t)(w.p - r.data);
+}
+
+template <typename... A>
+static void assertLikePrintf(const char* fmt, const A&... args) {
+  logging::Record r{};
+  fillRecord(r, fmt, args...);
+  char got[128], want[128];
+  logging::formatRecord(r, got, sizeof(got));
+  snprintf(want, sizeof(want), fmt, args...);
+  TEST_ASSERT_EQUAL_STRING_MESSAGE(want, got, fmt);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Formati presi dai messaggi del firmware.
+static void test_firmware_messages() {
+  assertLikePrintf("SD init pins CS=%d SCK=%d MISO=%d MOSI=%d", 5, 18, 19, 23);
+  assertLikePrintf("POST batch %d | %u/%u accepted", 200, 8u, 10u);
+  assertLikePrintf("Local API: http://%s:%u/api/v1/latest", "192.168.1.20", 80u);
+}
+
+static void test_integer_lengths_and_flags() {
+  assertLikePrintf("%ld %lu %lld %llu %zu", -7L, 7UL, -(1LL << 40), 1ULL << 63, (size_t)42);
+  assertLikePrintf("%x %X %#o %c %+d", 0xBEEFu, 0xCAFEu, 8u, 'z', 3);
+}
+
+// float promosso a double come in una varargs vera.
+static void test_floats_and_widths() {
+  assertLikePrintf("%5.1f%% %-8s| %08.3f %e", 3.14159f, "ab", -2.5, 1e-3);
+  assertLikePrintf("%*d|%-*s|%.*f", 6, -42, 5, "x", 2, 1.005);
+}
+
+static void test_strings() { assertLikePrintf("%.3s %s", "truncate", ""); }
+
+// Riga completa: "[s.ms] LIVELLO modulo: testo".
+static void test_line_prefix() {
+  hal::native::setMillis(12345);
+  logging::Record r{};
+  fillRecord(r, "boot %u", 3u);
+  char line[128];
+  logging::formatLine(r, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("[12.345] I sys: boot 3\n", line);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_firmware_messages);
+  RUN_TEST(test_integer_lengths_and_flags);
+  RUN_TEST(test_floats_and_widths);
+  RUN_TEST(test_strings);
+  RUN_TEST(test_line_prefix);
+  return UNITY_END();
+}
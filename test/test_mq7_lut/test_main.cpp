@@ -0,0 +1,50 @@
+// Tabelle MQ-7 (mq7conv::PpmTable) contro il percorso float.
+#include <unity.h>
+#include <math.h>
+
+#include "config.h"
+#include "sensors/mq7_convert.h"
+
+// Tutti i raw Q.4 con ppm nel campo utile del sensore; errore relativo massimo
+// su Rs, ratio e ppm.
+static constexpr float MQ7_LUT_MAX_REL_ERR = 0.005f;
+static constexpr float MQ7_LUT_PPM_MIN = 1.0f;
+static constexpr float MQ7_LUT_PPM_MAX = 10000.0f;
+
+static mq7conv::PpmTable table;
+
+void setUp() { table.rebuild(MQ7_R0_DEFAULT); }
+void tearDown() {}
+
+static float relErr(float got, float ref) {
+  return fabsf(got - ref) / fabsf(ref);
+}
+
+static void test_lut_matches_float() {
+  float rsErr = 0, ratioErr = 0, ppmErr = 0;
+  uint32_t checked = 0;
+  for (uint32_t rawQ4 = 1u << mq7conv::FRAC_BITS; rawQ4 < ((uint32_t)mq7conv::ADC_CODES << mq7conv::FRAC_BITS); rawQ4++) {
+    const float rs = mq7conv::rawToRs(rawQ4 / (float)(1u << mq7conv::FRAC_BITS));
+    const float ratio = rs / MQ7_R0_DEFAULT;
+    const float ppm = mq7conv::ratioToPpm(ratio);
+    if (!(ppm >= MQ7_LUT_PPM_MIN && ppm <= MQ7_LUT_PPM_MAX)) continue;
+
+    uint32_t ratioQ16, ppmQ8;
+    if (!table.lookup(rawQ4, ratioQ16, ppmQ8)) continue; // fuori tabella: percorso float
+    rsErr = fmaxf(rsErr, relErr(mq7conv::rsQ4(rawQ4) / (float)(1u << mq7conv::FRAC_BITS), rs));
+    ratioErr = fmaxf(ratioErr, relErr(ratioQ16 / (float)(1u << mq7conv::RATIO_FRAC_BITS), ratio));
+    ppmErr = fmaxf(ppmErr, relErr(ppmQ8 / (float)(1u << mq7conv::PPM_FRAC_BITS), ppm));
+    checked++;
+  }
+
+  TEST_ASSERT_GREATER_THAN_UINT32(0, checked);
+  TEST_ASSERT_LESS_THAN_FLOAT(MQ7_LUT_MAX_REL_ERR, rsErr);
+  TEST_ASSERT_LESS_THAN_FLOAT(MQ7_LUT_MAX_REL_ERR, ratioErr);
+  TEST_ASSERT_LESS_THAN_FLOAT(MQ7_LUT_MAX_REL_ERR, ppmErr);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lut_matches_float);
+  return UNITY_END();
+}
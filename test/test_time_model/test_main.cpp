@@ -0,0 +1,76 @@
+// Modello del tempo: quarzo a +40 ppm, sync NTP ogni ora per un giorno con
+// ±2 ms di jitter e un salto d'ora di 30 s a metà.
+#include <unity.h>
+
+#include "time/time_model.h"
+
+static constexpr double PPM = 40.0;
+static constexpr uint64_t SEC_US = 1000000u;
+static constexpr uint64_t HOUR_US = 3600ull * SEC_US;
+static constexpr uint64_t UTC0 = 1750000000ull * SEC_US;
+static constexpr uint64_t MONO0 = 20 * SEC_US; // prima sync 20 s dopo il boot
+static constexpr uint64_t PRE_SYNC = 5 * SEC_US; // lettura a 5 s, ts assegnato dopo
+
+static int64_t step = 0;
+
+// UTC vero all'istante monotono mono, con il quarzo che corre di PPM.
+static uint64_t utcOf(uint64_t mono) { return UTC0 + step + (uint64_t)((double)mono * (1.0 + PPM * 1e-6)); }
+static int64_t jitterUs(uint32_t h) { return (int64_t)((h * 7919u) % 5) * 1000 - 2000; }
+static uint64_t monoAt(uint32_t h) { return MONO0 + h * HOUR_US; }
+
+// Un giorno di sync orarie; maxPredictUs = errore peggiore della previsione
+// subito prima di ogni sync, esclusi l'avvio della deriva e il salto d'ora.
+static void runDay(TimeModel& m, int64_t* maxPredictUs) {
+  for (uint32_t h = 0; h <= 24; h++) {
+    const uint64_t mono = monoAt(h);
+    if (h == 12) step = 30 * (int64_t)SEC_US;
+    if (maxPredictUs && h > 2 && h != 12) {
+      int64_t e = (int64_t)(utcOf(mono) - m.utcUs(mono));
+      if (e < 0) e = -e;
+      if (e > *maxPredictUs) *maxPredictUs = e;
+    }
+    m.sync(mono, utcOf(mono) + jitterUs(h));
+  }
+}
+
+void setUp() { step = 0; }
+void tearDown() {}
+
+static void test_no_sync_is_zero() {
+  TimeModel m;
+  TEST_ASSERT_FALSE(m.valid());
+  TEST_ASSERT_EQUAL_UINT64(0, m.utcUs(PRE_SYNC));
+}
+
+// Lettura presa prima della prima sync: il ts arriva con la sync.
+static void test_pre_sync_reading() {
+  TimeModel m;
+  m.sync(MONO0, utcOf(MONO0) + jitterUs(0));
+  TEST_ASSERT_TRUE(m.valid());
+  TEST_ASSERT_INT64_WITHIN(1000, utcOf(PRE_SYNC) + jitterUs(0), m.utcUs(PRE_SYNC));
+}
+
+// Il salto d'ora non entra nella deriva.
+static void test_drift_estimate() {
+  TimeModel m;
+  runDay(m, nullptr);
+  TEST_ASSERT_EQUAL_UINT32(25, m.syncs());
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, (float)PPM, m.driftPpm());
+}
+
+// A un'ora dall'ultima sync la previsione sbaglia di meno di 10 ms.
+static void test_one_hour_prediction() {
+  TimeModel m;
+  int64_t maxPredictUs = 0;
+  runDay(m, &maxPredictUs);
+  TEST_ASSERT_LESS_THAN(10000, maxPredictUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_sync_is_zero);
+  RUN_TEST(test_pre_sync_reading);
+  RUN_TEST(test_drift_estimate);
+  RUN_TEST(test_one_hour_prediction);
+  return UNITY_END();
+}
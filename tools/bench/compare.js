@@ -0,0 +1,79 @@
+#!/usr/bin/env node
+// Confronta due output JSON Lines della suite di benchmark (bench::runAll).
+// Uso: node tools/bench/compare.js base.jsonl new.jsonl [--threshold 10]
+// Exit code 1 se un caso rallenta oltre la soglia (%) o alloca di più.
+'use strict';
+
+const fs = require('fs');
+
+function load(path) {
+  const out = new Map();
+  let meta = null;
+  for (const line of fs.readFileSync(path, 'utf8').split(/\r?\n/)) {
+    const start = line.indexOf('{'); // tollera prefissi del monitor seriale
+    if (start < 0) continue;
+    let row;
+    try {
+      row = JSON.parse(line.slice(start));
+    } catch {
+      continue;
+    }
+    if (row.meta) meta = row;
+    else if (row.bench) out.set(row.bench, row);
+  }
+  return { meta, rows: out };
+}
+
+function pct(a, b) {
+  if (!(a > 0)) return null;
+  return ((b - a) / a) * 100;
+}
+
+function fmt(v, digits = 1) {
+  return v === null || v === undefined ? '-' : Number(v).toFixed(digits);
+}
+
+const args = process.argv.slice(2);
+let threshold = 10;
+const files = [];
+for (let i = 0; i < args.length; i++) {
+  if (args[i] === '--threshold') threshold = Number(args[++i]);
+  else files.push(args[i]);
+}
+if (files.length !== 2 || !Number.isFinite(threshold)) {
+  console.error('usage: compare.js base.jsonl new.jsonl [--threshold PCT]');
+  process.exit(2);
+}
+
+const base = load(files[0]);
+const next = load(files[1]);
+if (base.meta && next.meta && base.meta.target !== next.meta.target) {
+  console.warn(`warning: comparing target ${base.meta.target} with ${next.meta.target}`);
+}
+
+let regressions = 0;
+console.log(
+  'bench'.padEnd(14) + 'ns base'.padStart(12) + 'ns new'.padStart(12) + 'delta%'.padStart(9) +
+    'allocs'.padStart(14) + '  status'
+);
+for (const [name, b] of base.rows) {
+  const n = next.rows.get(name);
+  if (!n) {
+    console.log(name.padEnd(14) + '  (missing in new)');
+    continue;
+  }
+  const d = pct(b.ns, n.ns);
+  const moreAllocs = b.allocs !== null && n.allocs !== null && n.allocs > b.allocs;
+  const slower = d !== null && d > threshold;
+  const status = slower || moreAllocs ? 'REGRESSION' : d !== null && d < -threshold ? 'faster' : 'ok';
+  if (status === 'REGRESSION') regressions++;
+  console.log(
+    name.padEnd(14) + fmt(b.ns).padStart(12) + fmt(n.ns).padStart(12) + fmt(d).padStart(9) +
+      `${fmt(b.allocs, 2)}->${fmt(n.allocs, 2)}`.padStart(14) + '  ' + status
+  );
+}
+for (const name of next.rows.keys()) {
+  if (!base.rows.has(name)) console.log(name.padEnd(14) + '  (new)');
+}
+
+process.exit(regressions ? 1 : 0);
@@ -0,0 +1,116 @@
+// envlog: legge i log binari del firmware (/log/*.bin) su host.
+//
+//   envlog info  FILE...                       record, intervallo ts, entry di indice
+//   envlog csv   [--from TS] [--to TS] FILE... converte in CSV (colonne di SdLogger)
+//   envlog stats [--from TS] [--to TS] FILE... min/media/max per T, RH, ratio, ppm
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "envlog_reader.h"
+
+namespace {
+
+struct Args {
+  std::string cmd;
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  std::vector<std::string> files;
+};
+
+int usage() {
+  fprintf(stderr,
+          "usage: envlog info FILE...\n"
+          "       envlog csv   [--from TS] [--to TS] FILE...\n"
+          "       envlog stats [--from TS] [--to TS] FILE...\n");
+  return 2;
+}
+
+bool parseArgs(int argc, char** argv, Args& a) {
+  if (argc < 3) return false;
+  a.cmd = argv[1];
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--from") && i + 1 < argc) a.from = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--to") && i + 1 < argc) a.to = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    else a.files.push_back(argv[i]);
+  }
+  return !a.files.empty();
+}
+
+struct Agg {
+  uint64_t n = 0;
+  double sum = 0;
+  float mn = INFINITY;
+  float mx = -INFINITY;
+
+  void add(float v) {
+    if (isnan(v)) return;
+    n++;
+    sum += v;
+    if (v < mn) mn = v;
+    if (v > mx) mx = v;
+  }
+  void print(const char* name) const {
+    if (n == 0) printf("%-9s n=0\n", name);
+    else printf("%-9s n=%llu min=%.4f mean=%.4f max=%.4f\n", name, (unsigned long long)n, mn, sum / n, mx);
+  }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Args a;
+  if (!parseArgs(argc, argv, a)) return usage();
+
+  Agg tC, rh, ratio, ppm;
+  uint64_t rows = 0;
+  if (a.cmd == "csv") printf("%s\n", envlog::CSV_HEADER);
+
+  for (const std::string& path : a.files) {
+    envlog::LogFile f;
+    std::string err;
+    if (!f.open(path, &err)) {
+      fprintf(stderr, "envlog: %s\n", err.c_str());
+      return 1;
+    }
+
+    if (a.cmd == "info") {
+      uint32_t first = 0, last = 0;
+      for (size_t i = 0; i < f.size(); i++) {
+        uint32_t ts = f.at(i).ts;
+        if (ts == 0) continue;
+        if (!first) first = ts;
+        last = ts;
+      }
+      printf("%s: records=%zu index=%zu created=%u first=%u last=%u\n", path.c_str(), f.size(), f.indexSize(),
+             f.header().createdTs, first, last);
+    } else if (a.cmd == "csv") {
+      f.forRange(a.from, a.to, [](const envlog::Record& r) {
+        envlog::writeCsvRow(stdout, r);
+        fputc('\n', stdout);
+      });
+    } else if (a.cmd == "stats") {
+      f.forRange(a.from, a.to, [&](const envlog::Record& r) {
+        rows++;
+        tC.add(r.tC);
+        rh.add(r.rh);
+        ratio.add(r.mq7Ratio);
+        ppm.add(r.mq7Ppm);
+      });
+    } else {
+      return usage();
+    }
+  }
+
+  if (a.cmd == "stats") {
+    printf("records   %llu\n", (unsigned long long)rows);
+    tC.print("tC");
+    rh.print("rh");
+    ratio.print("mq7Ratio");
+    ppm.print("mq7Ppm");
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include "envlog_reader.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace envlog {
+
+static const uint8_t* mapFile(const std::string& path, size_t& len) {
+  len = 0;
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return nullptr;
+  }
+  void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return nullptr;
+  len = (size_t)st.st_size;
+  return static_cast<const uint8_t*>(p);
+}
+
+LogFile::~LogFile() {
+  close();
+}
+
+bool LogFile::open(const std::string& binPath, std::string* err) {
+  close();
+  bin_ = mapFile(binPath, binLen_);
+  if (!bin_ || binLen_ < sizeof(FileHeader)) {
+    if (err) *err = "cannot map " + binPath;
+    close();
+    return false;
+  }
+  const FileHeader& h = header();
+  if (h.magic != FILE_MAGIC || h.version != FILE_VERSION || h.recordSize != sizeof(Record)) {
+    if (err) *err = "not an envlog v1 file: " + binPath;
+    close();
+    return false;
+  }
+  records_ = (binLen_ - sizeof(FileHeader)) / sizeof(Record); // record troncato finale ignorato
+
+  std::string idxPath = binPath;
+  if (idxPath.size() > 4 && idxPath.compare(idxPath.size() - 4, 4, ".bin") == 0) {
+    idxPath.replace(idxPath.size() - 4, 4, ".idx");
+    idx_ = mapFile(idxPath, idxLen_);
+    idxEntries_ = idxLen_ / sizeof(IndexEntry);
+  }
+  return true;
+}
+
+void LogFile::close() {
+  if (bin_) munmap(const_cast<uint8_t*>(bin_), binLen_);
+  if (idx_) munmap(const_cast<uint8_t*>(idx_), idxLen_);
+  bin_ = idx_ = nullptr;
+  binLen_ = idxLen_ = records_ = idxEntries_ = 0;
+}
+
+size_t LogFile::lowerBound(uint32_t from) const {
+  // Ultimo entry di indice con ts < from: il primo record utile è dopo di lui.
+  size_t start = 0;
+  size_t lo = 0, hi = idxEntries_;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (idx()[mid].ts < from) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo > 0) start = idx()[lo - 1].recordNo;
+  if (start > records_) start = records_;
+
+  for (size_t i = start; i < records_; i++) {
+    const Record& r = recs()[i];
+    if (r.ts != 0 && r.ts >= from) return i;
+  }
+  return records_;
+}
+
+static void writeCsvFloat(FILE* out, float v, int decimals) {
+  if (!isnan(v)) fprintf(out, "%.*f", decimals, v);
+}
+
+void writeCsvRow(FILE* out, const Record& r) {
+  fprintf(out, "%u,%u,", r.ts, r.millis);
+  writeCsvFloat(out, r.tC, 2);
+  fputc(',', out);
+  writeCsvFloat(out, r.rh, 2);
+  fprintf(out, ",%d,%u,", (r.flags & FLAG_DHT_OK) ? 1 : 0, r.mq7Raw);
+  writeCsvFloat(out, r.mq7Ratio, 4);
+  fputc(',', out);
+  writeCsvFloat(out, r.mq7Ppm, 1);
+  fputc(',', out);
+  writeCsvFloat(out, r.mq7R0, 1);
+  fprintf(out, ",%d,%d,%d,%u", (r.flags & FLAG_MQ7_OK) ? 1 : 0, (r.flags & FLAG_MQ7_CALIBRATED) ? 1 : 0,
+          (r.flags & FLAG_MQ7_WARMUP_DONE) ? 1 : 0, r.mq7Level);
+}
+
+} // namespace envlog
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include "storage/log_record.h"
+
+namespace envlog {
+
+// File di log binario (.bin + .idx opzionale) mappato in memoria, sola lettura.
+class LogFile {
+public:
+  LogFile() = default;
+  ~LogFile();
+  LogFile(const LogFile&) = delete;
+  LogFile& operator=(const LogFile&) = delete;
+
+  bool open(const std::string& binPath, std::string* err = nullptr);
+  void close();
+
+  const FileHeader& header() const { return *reinterpret_cast<const FileHeader*>(bin_); }
+  size_t size() const { return records_; }
+  const Record& at(size_t i) const { return recs()[i]; }
+  size_t indexSize() const { return idxEntries_; }
+
+  // Primo record con ts >= from (record senza ora valida esclusi).
+  // Usa l'indice sparso per il salto, poi scansione lineare al più di INDEX_STRIDE.
+  size_t lowerBound(uint32_t from) const;
+
+  // Chiama fn(const Record&) per i record con from <= ts <= to.
+  template <typename Fn>
+  void forRange(uint32_t from, uint32_t to, Fn fn) const {
+    for (size_t i = lowerBound(from); i < records_; i++) {
+      const Record& r = recs()[i];
+      if (r.ts == 0) continue;
+      if (r.ts > to) break;
+      fn(r);
+    }
+  }
+
+private:
+  const Record* recs() const { return reinterpret_cast<const Record*>(bin_ + sizeof(FileHeader)); }
+  const IndexEntry* idx() const { return reinterpret_cast<const IndexEntry*>(idx_); }
+
+  const uint8_t* bin_ = nullptr;
+  size_t binLen_ = 0;
+  const uint8_t* idx_ = nullptr;
+  size_t idxLen_ = 0;
+  size_t records_ = 0;
+  size_t idxEntries_ = 0;
+};
+
+// Riga CSV con le stesse colonne e precisioni di SdLogger (senza newline).
+void writeCsvRow(FILE* out, const Record& r);
+
+} // namespace envlog
@@ -0,0 +1,146 @@
+#!/usr/bin/env node
+// Decodifica il log binario (LOG_BINARY 1 o logging::setBinary(true)) in righe
+// di testo come quelle del modo testo. Il resto dello stream (dump 's'/'m',
+// help del setup) passa invariato.
+// Uso: node tools/logdecode/logdecode.js capture.bin   (oppure da stdin)
+'use strict';
+
+const fs = require('fs');
+
+const FRAME_MSG = 0xa5;
+const FRAME_DEF = 0xa6;
+const FRAME_TEXT = 0xa7;
+const LEVELS = ['-', 'E', 'W', 'I', 'D'];
+const MODS = ['sys', 'sensor', 'alarm', 'storage', 'net', 'display'];
+const ARG_I32 = 0;
+const ARG_U32 = 1;
+const ARG_I64 = 2;
+const ARG_U64 = 3;
+const ARG_F32 = 4;
+const ARG_STR = 5;
+
+function readArgs(buf) {
+  const args = [];
+  let p = 0;
+  while (p < buf.length) {
+    const tag = buf[p++];
+    if (tag === ARG_I32) args.push(buf.readInt32LE(p)), (p += 4);
+    else if (tag === ARG_U32) args.push(buf.readUInt32LE(p)), (p += 4);
+    else if (tag === ARG_I64) args.push(buf.readBigInt64LE(p)), (p += 8);
+    else if (tag === ARG_U64) args.push(buf.readBigUInt64LE(p)), (p += 8);
+    else if (tag === ARG_F32) args.push(buf.readFloatLE(p)), (p += 4);
+    else if (tag === ARG_STR) {
+      const n = buf[p++];
+      args.push(buf.toString('latin1', p, p + n));
+      p += n;
+    } else break;
+  }
+  return args;
+}
+
+function pad(s, flags, width) {
+  if (s.length >= width) return s;
+  if (flags.includes('-')) return s + ' '.repeat(width - s.length);
+  if (flags.includes('0') && /^[-+ ]?[0-9a-fA-F.]/.test(s)) {
+    const sign = /^[-+ ]/.test(s) ? s[0] : '';
+    return sign + '0'.repeat(width - s.length) + s.slice(sign.length);
+  }
+  return ' '.repeat(width - s.length) + s;
+}
+
+// Sottoinsieme di printf che basta ai formati del firmware.
+function format(fmt, args) {
+  let i = 0;
+  const next = () => (i < args.length ? args[i++] : undefined);
+  return fmt.replace(/%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?[hljztLq]*([diouxXeEfFgGcsp%])/g, (m, flags, w, pr, conv) => {
+    if (conv === '%') return '%';
+    const width = w === '*' ? Number(next()) : Number(w || 0);
+    const prec = pr === '*' ? Number(next()) : pr === undefined ? undefined : Number(pr);
+    const v = next();
+    if (v === undefined) return '?';
+    let s;
+    switch (conv) {
+      case 'd':
+      case 'i':
+      case 'u':
+        s = typeof v === 'bigint' ? v.toString() : String(Math.trunc(v));
+        if (flags.includes('+') && !s.startsWith('-')) s = '+' + s;
+        break;
+      case 'o':
+      case 'x':
+      case 'X':
+        s = BigInt.asUintN(64, BigInt(v)).toString(conv === 'o' ? 8 : 16);
+        if (conv === 'X') s = s.toUpperCase();
+        break;
+      case 'f':
+      case 'F':
+        s = Number(v).toFixed(prec === undefined ? 6 : prec);
+        break;
+      case 'e':
+      case 'E':
+        s = Number(v)
+          .toExponential(prec === undefined ? 6 : prec)
+          .replace(/e([+-])(\d)$/, 'e$10$2');
+        if (conv === 'E') s = s.toUpperCase();
+        break;
+      case 'g':
+      case 'G':
+        s = String(Number(Number(v).toPrecision(prec === undefined ? 6 : prec || 1)));
+        break;
+      case 'c':
+        s = String.fromCharCode(Number(v));
+        break;
+      case 's':
+        s = String(v);
+        if (prec !== undefined) s = s.slice(0, prec);
+        break;
+      case 'p':
+        s = '0x' + BigInt(v).toString(16);
+        break;
+    }
+    if (flags.includes('+') && /[fFeEgG]/.test(conv) && !s.startsWith('-')) s = '+' + s;
+    return pad(s, flags, width);
+  });
+}
+
+function prefix(ms, lm) {
+  const level = LEVELS[lm >> 4] || '?';
+  const mod = MODS[lm & 0x0f] || '?';
+  return `[${Math.floor(ms / 1000)}.${String(ms % 1000).padStart(3, '0')}] ${level} ${mod}: `;
+}
+
+function decode(buf, out) {
+  const formats = new Map();
+  let raw = [];
+  const flushRaw = () => {
+    if (raw.length) out.write(Buffer.from(raw));
+    raw = [];
+  };
+  let p = 0;
+  while (p < buf.length) {
+    const type = buf[p];
+    const len = buf[p + 1];
+    const isFrame = type === FRAME_MSG || type === FRAME_DEF || type === FRAME_TEXT;
+    if (!isFrame || p + 2 + len > buf.length) {
+      raw.push(buf[p++]);
+      continue;
+    }
+    const body = buf.subarray(p + 2, p + 2 + len);
+    p += 2 + len;
+    flushRaw();
+    if (type === FRAME_DEF) {
+      formats.set(body.readUInt16LE(0), body.toString('latin1', 2));
+    } else if (type === FRAME_TEXT) {
+      out.write(prefix(body.readUInt32LE(0), body[4]) + body.toString('latin1', 5) + '\n');
+    } else {
+      const id = body.readUInt16LE(5);
+      const fmt = formats.get(id);
+      const text = fmt === undefined ? `<format ${id}?>` : format(fmt, readArgs(body.subarray(8)));
+      out.write(prefix(body.readUInt32LE(0), body[4]) + text + '\n');
+    }
+  }
+  flushRaw();
+}
+
+const input = process.argv[2] ? fs.readFileSync(process.argv[2]) : fs.readFileSync(0);
+decode(input, process.stdout);